@@ -0,0 +1,75 @@
+#!/bin/bash
+
+#   ---------------------------------------------------------------------- copyright and license ---
+#
+#   File: bin/bench-x-listeners.sh
+#
+#   Copyright 🄯 2014, 2016—2017, 2019—2023 Van de Bugger.
+#
+#   This file is part of Tapper.
+#
+#   Tapper is free software: you can redistribute it and/or modify it under the terms of the GNU
+#   General Public License as published by the Free Software Foundation, either version 3 of the
+#   License, or (at your option) any later version.
+#
+#   Tapper is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+#   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+#   General Public License for more details.
+#
+#   You should have received a copy of the GNU General Public License along with Tapper.  If not,
+#   see <https://www.gnu.org/licenses/>.
+#
+#   SPDX-License-Identifier: GPL-3.0-or-later
+#
+#   ---------------------------------------------------------------------- copyright and license ---
+
+#   Compares the XRecord and XInput2 listeners. Starts a private X server, runs Tapper with every
+#   listener in turn, types the same keys through XTest, and reports CPU time consumed by Tapper
+#   and by the X server (XRecord makes the server copy every event to the second connection), and
+#   listener latency reported by Tapper.
+#
+#   Usage: bench-x-listeners.sh [keys]
+#
+#   `keys` is number of typed keys, 2000 by default.
+
+eval "$PROLOGUE"
+
+[[ $# -le 1 ]] || die "Too many arguments"
+keys=${1:-2000}
+
+xvfb
+
+ticks=$( getconf CLK_TCK )
+
+# Prints CPU time (user and system) consumed by the process, in milliseconds.
+cpu() {
+    local stat
+    read -r -a stat < /proc/$1/stat
+    echo $(( ( stat[13] + stat[14] ) * 1000 / ticks ))
+}
+
+# Typing: mostly letters, every fourth key is a tap.
+text=()
+for (( i = 0; i < keys; i = i + 4 )); do
+    text+=( a s d Control_L )
+done
+
+printf "%-10s %10s %10s  %s\n" "listener" "tapper, ms" "X, ms" "listener latency, µs"
+for listener in xrecord xi2; do
+    ./tapper --no-load-settings --quiet --show-taps --$listener \
+        --layouter=dummy --emitter=dummy > $tmpfile.$listener 2>&1 &
+    tapper=$!
+    sleep 1
+    tapper_cpu=$( cpu $tapper )
+    x_cpu=$( cpu $xvfb )
+    xdotool key --delay 5 "${text[@]}"
+    sleep 1
+    tapper_cpu=$(( $( cpu $tapper ) - tapper_cpu ))
+    x_cpu=$(( $( cpu $xvfb ) - x_cpu ))
+    kill -s INT $tapper
+    wait $tapper || die "Tapper with $listener listener exited with status $?."
+    latency=$( egrep -e '^ +listener: ' $tmpfile.$listener | sed -e 's/^ *listener: //' )
+    printf "%-10s %10d %10d  %s\n" $listener $tapper_cpu $x_cpu "$latency"
+done
+
+# end of file #
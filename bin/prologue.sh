@@ -169,6 +169,35 @@ vle() {
     return $status
 }
 
+#   ------------------------------------------------------------------------------------------------
+#   Name:
+#       xvfb — start a private X server
+#   Usage:
+#       xvfb
+#   Description:
+#       Starts Xvfb on a free display, waits until it accepts connections, exports `DISPLAY` and
+#       `XDG_SESSION_TYPE`, and sets `xvfb` variable to the server pid. The server is killed on
+#       exit. Input events are injected into the server by xdotool through XTest extension. If
+#       either Xvfb or xdotool is not installed, the function calls `skip`.
+#
+xvfb() {
+    local display=99 i
+    command -v Xvfb > /dev/null || skip "Xvfb is not installed."
+    command -v xdotool > /dev/null || skip "xdotool is not installed."
+    while [[ -e /tmp/.X$display-lock ]]; do
+        display=$(( display + 1 ))
+    done
+    Xvfb :$display -nolisten tcp > /dev/null 2>&1 &
+    xvfb=$!
+    trap 'kill $xvfb 2> /dev/null; cleanup' EXIT
+    export DISPLAY=:$display XDG_SESSION_TYPE=x11
+    for (( i = 0; i < 50; i = i + 1 )); do
+        xdotool getmouselocation > /dev/null 2>&1 && return 0
+        sleep 0.1
+    done
+    die "Xvfb does not accept connections."
+};
+
 is_x_session() {
     if [[ $XDG_SESSION_TYPE == "x11" && -n $DISPLAY ]]; then
         return 0
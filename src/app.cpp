@@ -38,8 +38,14 @@
     #include <giomm/init.h>
 #endif // WITH_GLIB
 
+#include "flight.hpp"
+#include "latency.hpp"
+#include "listener-replay.h"
+#include "listener-replay.hpp"
+#include "metrics.hpp"
 #include "posix.hpp"
 #include "privileges.hpp"
+#include "reactor.hpp"
 #include "string.hpp"
 #include "tapper.hpp"
 #include "xdg.hpp"
@@ -73,10 +79,6 @@ namespace tapper {
 // app_t
 // -------------------------------------------------------------------------------------------------
 
-static void handler( int signal ) {
-    DBG( "Signal " << signal );
-};
-
 static assignments_t const default_assignments {
     { key_t( 29 ), { action_t::activate_layout( layout_t( 1 ) ) } }, // Left Ctrl activates the 1st layout.
     { key_t( 97 ), { action_t::activate_layout( layout_t( 2 ) ) } }, // Right Ctrl activates the 2nd layout.
@@ -92,6 +94,7 @@ app_t::app_t(
 
     set_locale();
     privileges().init();
+    privileges_t::tuning_guard_t tuning;
 
     #if WITH_GLIB
         /*
@@ -103,14 +106,26 @@ app_t::app_t(
     #endif // WITH_GLIB
 
     parse_cmdline( argc, argv );
+    if (
+        ( _mode != mode_t::run and _mode != mode_t::show_taps )
+            or ( _sched.is_default() and not _lock_memory )
+    ) {
+        // Tuning is not requested, drop the capabilities before any thread is started.
+        privileges().drop_tuning();
+    };
     if ( _syslog ) {
         set_syslog_min_priority( priority_t::warning );
     };
 
-    posix::signal::set_t    set( { SIGINT, SIGTERM } );
-    posix::signal::action_t action( handler, set );
-    posix::signal::action( SIGINT,  action );
-    posix::signal::action( SIGTERM, action );
+    /*
+        `SIGINT` and `SIGTERM` stop the reactor, `SIGUSR1` prints latency statistics, `SIGUSR2`
+        dumps the flight recorder. The signals are blocked here, before any thread is started, so
+        all the threads inherit the mask, and the signals are read by the reactor from a signalfd.
+    */
+    reactor().signals(
+        posix::signal::set_t( { SIGINT, SIGTERM, SIGUSR1, SIGUSR2 } ),
+        reactor_t::on_signal_t::make< app_t, & app_t::on_signal >( this )
+    );
 
     switch ( _mode ) {
         case mode_t::autostart: {
@@ -171,9 +186,14 @@ enum opt_t {
     // Long options:
     opt_autostart = 1000,
     opt_bell,
+    opt_bell_always,
+    opt_cpus,
     opt_dconf_editor,
     opt_emitter,
+    opt_evdev,
+    opt_fast,
     opt_gnome,
+    opt_ignore_device,
     opt_kde,
     opt_lay_off,
     opt_layouter,
@@ -183,15 +203,24 @@ enum opt_t {
     opt_list_keys,
     opt_list_layouts,
     opt_load_settings,
+    opt_lock_memory,
+    opt_metrics,
+    opt_nice,
     opt_no_autostart,
     opt_no_bell,
     opt_no_default_assignments,
     opt_no_load_settings,
     opt_quiet,
+    opt_record,
+    opt_replay,
     opt_reset_settings,
     opt_save_settings,
+    opt_sched,
     opt_show_taps,
+    opt_state_only_device,
     opt_syslog,
+    opt_trace,
+    opt_xi2,
     opt_xkb,
     opt_xrecord,
     opt_xtest,
@@ -224,7 +253,7 @@ app_t::parse_opt_or_arg(
 
             case ARGP_KEY_INIT: {
                 DBG( "ARGP_KEY_INIT " << state->next << " " << state->argc );
-                app->_used_keys.reset( new keys_t );
+                app->_used_triggers.reset( new triggers_t );
             } break;
 
             case opt_autostart: {
@@ -235,6 +264,14 @@ app_t::parse_opt_or_arg(
                 app->set_bell( settings_t::bell_t::enabled );
             } break;
 
+            case opt_bell_always: {
+                app->set_bell( settings_t::bell_t::always );
+            } break;
+
+            case opt_cpus: {
+                app->_sched.cpus = app->parse_cpus( arg );
+            } break;
+
             case opt_dconf_editor: {
                 if ( not WITH_GLIB ) {
                     ERR( "Program is built without GLib." );
@@ -246,6 +283,17 @@ app_t::parse_opt_or_arg(
                 app->set_emitter( val< settings_t::emitter_t >( arg ) );
             } break;
 
+            case opt_evdev: {
+                if ( not WITH_LIBINPUT ) {
+                    ERR( "Program is built without libinput." );
+                };
+                app->set_listener( settings_t::listener_t::evdev );
+            } break;
+
+            case opt_fast: {
+                app->_fast = true;
+            } break;
+
             case opt_gnome: {
                 // cppcheck-suppress unknownMacro; cppchek 2.3 complains on 'not'!?
                 if ( not ENABLE_GNOME ) {
@@ -254,6 +302,10 @@ app_t::parse_opt_or_arg(
                 app->set_layouter( settings_t::layouter_t::gnome );
             } break;
 
+            case opt_ignore_device: {
+                app->_device_policies[ arg ] = listener_t::device_policy_t::ignore;
+            } break;
+
             case opt_kde: {
                 // cppcheck-suppress unknownMacro; cppchek 2.3 complains on 'not'!?
                 if ( not ENABLE_KDE ) {
@@ -303,6 +355,18 @@ app_t::parse_opt_or_arg(
                 app->_load_settings = true;
             } break;
 
+            case opt_lock_memory: {
+                app->_lock_memory = true;
+            } break;
+
+            case opt_metrics: {
+                app->_metrics = arg;
+            } break;
+
+            case opt_nice: {
+                app->_sched.nice = app->parse_nice( arg );
+            } break;
+
             case opt_no_autostart: {
                 app->set_mode( mode_t::no_autostart );
             } break;
@@ -323,6 +387,24 @@ app_t::parse_opt_or_arg(
                 app->_quiet = true;
             } break;
 
+            case opt_record: {
+                app->_record = arg;
+            } break;
+
+            case opt_replay: {
+                app->_replay = arg;
+                /*
+                    Replay is an offline activity, so let's use the dummy layouter and emitter,
+                    unless the user explicitly selected others.
+                */
+                if ( app->_settings.layouter == settings_t::layouter_t::unset ) {
+                    app->set_layouter( settings_t::layouter_t::dummy );
+                };
+                if ( app->_settings.emitter == settings_t::emitter_t::unset ) {
+                    app->set_emitter( settings_t::emitter_t::dummy );
+                };
+            } break;
+
             case opt_reset_settings: {
                 if ( not WITH_GLIB ) {
                     ERR( "Program is built without GLib." );
@@ -337,9 +419,24 @@ app_t::parse_opt_or_arg(
                 app->set_mode( mode_t::save_settings );
             } break;
 
+            case opt_sched: {
+                app->parse_sched( arg );
+            } break;
+
             case opt_show_taps: {
                 app->set_mode( mode_t::show_taps );
-                app->set_emitter( settings_t::emitter_t::dummy );
+                if ( app->_settings.emitter != settings_t::emitter_t::dummy ) {
+                    // The emitter could be set to dummy by `--replay`.
+                    app->set_emitter( settings_t::emitter_t::dummy );
+                };
+            } break;
+
+            case opt_state_only_device: {
+                app->_device_policies[ arg ] = listener_t::device_policy_t::state_only;
+            } break;
+
+            case opt_trace: {
+                app->_trace = arg;
             } break;
 
             case opt_syslog: {
@@ -355,6 +452,13 @@ app_t::parse_opt_or_arg(
                 app->set_emitter( settings_t::emitter_t::xtest );
             } break;
 
+            case opt_xi2: {
+                if ( not WITH_X ) {
+                    ERR( "Program is built without X Window System." );
+                };
+                app->set_listener( settings_t::listener_t::xi2 );
+            } break;
+
             case opt_xkb: {
                 if ( not WITH_X ) {
                     ERR( "Program is built without X Window System." );
@@ -394,6 +498,7 @@ app_t::parse_opt_or_arg(
                 if ( state->arg_num == 0 ) {
                     if ( not (
                         app->_mode == mode_t::run or
+                        app->_mode == mode_t::show_taps or
                         app->_mode == mode_t::lay_off or
                         app->_mode == mode_t::save_settings
                     ) ) {
@@ -422,10 +527,10 @@ app_t::parse_opt_or_arg(
             case ARGP_KEY_END: {
                 DBG( "ARGP_KEY_END " << state->next << " " << state->argc );
                 /*
-                    Command line parsing ends, I don't need _used_keys any more. Let's free a bit
-                    of memory.
+                    Command line parsing ends, I don't need _used_triggers any more. Let's free a
+                    bit of memory.
                 */
-                app->_used_keys.reset();
+                app->_used_triggers.reset();
             } break;
 
             case ARGP_KEY_FINI: {
@@ -502,6 +607,18 @@ app_t::parse_cmdline(
         { "xrecord",                opt_xrecord,                nullptr,    x_opt,
             "Same as --listener=xrecord",
             103 },
+        { "evdev",                  opt_evdev,                  nullptr,    libinput_opt,
+            "Same as --listener=evdev",
+            104 },
+        { "xi2",                    opt_xi2,                    nullptr,    x_opt,
+            "Same as --listener=xi2",
+            105 },
+        { "ignore-device",          opt_ignore_device,          "NAME",     0,
+            "Ignore input events of device NAME",
+            106 },
+        { "state-only-device",      opt_state_only_device,      "NAME",     0,
+            "Track keys held on device NAME, but never detect taps on it",
+            107 },
 
         { "Layouter selection:",    0,                          nullptr,    doc_opt,
             "",
@@ -538,9 +655,12 @@ app_t::parse_cmdline(
         { "bell",                   opt_bell,                   nullptr,    0,
             "Ring a bell when a layout is activated",
             401 },
+        { "bell-always",            opt_bell_always,            nullptr,    0,
+            "Ring a bell even if the layout is already active",
+            402 },
         { "no-bell",                opt_no_bell,                nullptr,    0,
             "Do not ring a bell when a layout is activated",
-            402 },
+            403 },
         /*
             cppcheck warns:
 
@@ -593,6 +713,48 @@ app_t::parse_cmdline(
             "Same as --xrecord --xkb --xtest",
             606 },
 
+        { "Recording and replay:",  0,                          nullptr,    doc_opt,
+            "",
+            700 },
+        { "record",                 opt_record,                 "FILE",     0,
+            "Record input events to FILE",
+            701 },
+        { "replay",                 opt_replay,                 "FILE",     0,
+            "Replay input events from FILE instead of listening and exit",
+            702 },
+        { "fast",                   opt_fast,                   nullptr,    0,
+            "Replay input events as fast as possible, not in real time",
+            703 },
+
+        { "Performance tuning:",    0,                          nullptr,    doc_opt,
+            "",
+            800 },
+        { "sched",                  opt_sched,                  "POLICY[:PRIORITY]", 0,
+            "Run listener and executor threads with real-time POLICY (fifo or rr) "
+                "and PRIORITY (1…99, default 10), or with the default policy (other)",
+            801 },
+        { "nice",                   opt_nice,                   "NICE",     0,
+            "Run listener and executor threads with nice level NICE (-20…19) "
+                "if the policy is the default one",
+            802 },
+        { "cpus",                   opt_cpus,                   "LIST",     0,
+            "Run listener and executor threads on the listed CPUs only, e. g. 0,2-3",
+            803 },
+        { "lock-memory",            opt_lock_memory,            nullptr,    0,
+            "Lock memory after start-up to avoid page faults",
+            804 },
+
+        { "Monitoring:",            0,                          nullptr,    doc_opt,
+            "",
+            900 },
+        { "metrics",                opt_metrics,                "SOCKET",   0,
+            "Serve statistics in Prometheus text format on UNIX SOCKET",
+            901 },
+        { "trace",                  opt_trace,                  "FILE",     0,
+            "Dump recent input events, taps and actions to FILE in Chrome trace format "
+                "on SIGUSR2 (default: $XDG_RUNTIME_DIR/tapper-trace.json)",
+            902 },
+
         { "Help options:",          0,                          nullptr,    doc_opt,
             "",
             -2  },
@@ -649,6 +811,9 @@ app_t::parse_cmdline(
         "If the key is released slowly, "
         "or pressed/released in a combination with other key(s) and/or button(s), it is not a tap."
         "\n\n"
+        "KEY+KEY... is a chord: the keys are pressed together and quickly released. "
+        "A chord tap is not a tap of its keys."
+        "\n\n"
         "ACTION is either: "
         "@LAYOUT — command to activate the given layout or "
         "KEY — command to simulate tap on the given key."
@@ -714,7 +879,7 @@ app_t::parse_cmdline(
         )
     );
 
-    argp parser = { opts, parse_opt_or_arg, "[KEY=[ACTION,...]...]", doc.c_str() };
+    argp parser = { opts, parse_opt_or_arg, "[KEY[+KEY...]=[ACTION,...]...]", doc.c_str() };
     auto error = argp_parse( & parser, argc, argv, 0, 0, this );
     if ( error ) {
         // Actually, this does not work, since `argp_parse` calls `exit` internally.
@@ -733,21 +898,40 @@ app_t::parse_assignment(
 ) {
     TRACE();
     auto parts   = split( '=', string, 2 );
-    auto key     = parse_key( trim( parts[ 0 ] ) );
+    auto trigger = parse_trigger( trim( parts[ 0 ] ) );
+    if ( _mode == mode_t::show_taps and not trigger.is_chord() ) {
+        // Every key tap is shown anyway, assignments are needed only to detect chords.
+        ERR( "Only chords can be assigned in \"show taps\" mode." );
+    };
     auto actions = parts.size() > 1 ? parse_actions( parts[ 1 ] ) : actions_t();
     // Check if the key is already assigned:
-    auto inserted = _used_keys->insert( key );
+    auto inserted = _used_triggers->insert( trigger );
     if ( not inserted.second ) {    // key was not inserted because it already is in the set.
-        ERR( "Key " << key_name( key ) << " has been already assigned." );
+        ERR(
+            ( trigger.is_chord() ? "Chord " : "Key " ) << trigger_name( trigger )
+                << " has been already assigned."
+        );
     }; // if
     // Save the assignment in the settings:
     if ( actions.empty() ) {
-        _settings.assignments.erase( key );     // Cancel key assignment, if any.
+        _settings.assignments.erase( trigger ); // Cancel key assignment, if any.
     } else {
-        _settings.assignments[ key ] = actions;
+        _settings.assignments[ trigger ] = actions;
     };
 }; // parse_assignment
 
+/** Parses trigger: a key, or a chord — keys joined with `+`. **/
+trigger_t
+app_t::parse_trigger(
+    string_t const & string
+) {
+    keys_t keys;
+    for ( auto const & key: split( '+', string ) ) {
+        keys.insert( parse_key( trim( key ) ) );
+    };
+    return trigger_t( keys );
+}; // parse_trigger
+
 /** Parses key, which can be either key name or key code. **/
 key_t
 app_t::parse_key(
@@ -850,6 +1034,82 @@ app_t::parse_layout(
     };
 }; // parse_layout
 
+/**
+    Parses scheduling policy and priority: `fifo`, `rr`, `fifo:PRIORITY`, `rr:PRIORITY`, or
+    `other`.
+**/
+void
+app_t::parse_sched(
+    string_t const & string
+) {
+    using error_t = val_error_t;
+    using policy_t = posix::sched_t::policy_t;
+    try {
+        auto const parts = split( ':', string, 2 );
+        auto const & policy = parts.at( 0 );
+        if ( policy == "fifo" ) {
+            _sched.policy = policy_t::fifo;
+        } else if ( policy == "rr" ) {
+            _sched.policy = policy_t::rr;
+        } else if ( policy == "other" ) {
+            _sched.policy = policy_t::other;
+        } else {
+            ERR( "Unknown policy " << q( policy ) << "." );
+        };
+        if ( _sched.policy == policy_t::other ) {
+            if ( parts.size() > 1 ) {
+                ERR( "Policy " << q( policy ) << " does not have priority." );
+            };
+            _sched.priority = 0;
+        } else {
+            _sched.priority = parts.size() > 1 ? val< int_t >( parts.at( 1 ) ) : 10;
+            t::range_t< int_t >( 1, 99 ).check( _sched.priority );
+        };
+    } catch ( error_t const & ex ) {
+        ERR( "Bad scheduling policy " << q( string ) << ": " << ex.what() );
+    };
+}; // parse_sched
+
+/** Parses nice level. **/
+int
+app_t::parse_nice(
+    string_t const & string
+) {
+    using error_t = val_error_t;
+    try {
+        auto const nice = val< int_t >( string );
+        t::range_t< int_t >( -20, 19 ).check( nice );
+        return nice;
+    } catch ( error_t const & ex ) {
+        ERR( "Bad nice level " << q( string ) << ": " << ex.what() );
+    };
+}; // parse_nice
+
+/** Parses list of CPUs, e. g. `0,2-3`. **/
+posix::cpus_t
+app_t::parse_cpus(
+    string_t const & string
+) {
+    using error_t = val_error_t;
+    try {
+        posix::cpus_t cpus;
+        for ( auto const & item: split( ',', string ) ) {
+            auto const bounds = split( '-', item, 2 );
+            auto const first  = val< uint_t >( bounds.at( 0 ) );
+            auto const last   = bounds.size() > 1 ? val< uint_t >( bounds.at( 1 ) ) : first;
+            if ( last < first or last >= CPU_SETSIZE ) {
+                ERR( "Bad CPU range " << q( item ) << "." );
+            };
+            for ( auto cpu = first; cpu <= last; ++ cpu ) {
+                cpus.insert( cpu );
+            };
+        };
+        return cpus;
+    } catch ( error_t const & ex ) {
+        ERR( "Bad CPU list " << q( string ) << ": " << ex.what() );
+    };
+}; // parse_cpus
+
 void
 app_t::set_listener(
     settings_t::listener_t listener
@@ -1049,15 +1309,110 @@ app_t::run(
                 WRN( "Dummy emitter will not emit keys." );
             };
         };
-        auto _bell = _settings.bell == settings_t::bell_t::enabled;
         tapper_t tapper( listener(), layouter(), emitter() );
-        tapper.start( _settings.assignments, _bell, show_taps );
+        if ( not _record.empty() ) {
+            tapper.record( _record );
+        };
+        /*
+            Scheduling parameters are applied to the current thread, which runs the reactor (and
+            so the listener), before the tapper starts the executor threads: new threads inherit
+            them. Memory is locked when everything is started and allocated: stacks of threads
+            started later would count against `RLIMIT_MEMLOCK`. Capabilities are per-thread, so
+            dropping them here does not affect threads already started, but these threads drop
+            their capabilities by themselves at start.
+        */
+        privileges().do_as_tuner( [ this ] () {
+            if ( not _sched.is_default() ) {
+                auto what = CATCH_ALL( posix::set_sched( posix::get_tid(), _sched ) );
+                if ( what.empty() ) {
+                    INF( "Scheduling: " << _sched << "." );
+                };
+            };
+        } );
+        tapper.start( _settings.assignments, bell(), show_taps );
+        privileges().do_as_tuner( [ this ] () {
+            if ( _lock_memory ) {
+                CATCH_ALL( posix::lock_memory() );
+            };
+        } );
+        privileges().drop_tuning();
         privileges().show();
-        posix::sleep();
+        /*
+            From now on, the listener and executor threads must not wait for a terminal or syslog.
+            The printer thread is started when capabilities are dropped, so it has none, and it
+            resets the scheduling parameters inherited from this thread.
+        */
+        set_async_print( true );
+        if ( not _replay.empty() ) {
+            // The replay listener stops the reactor when all the events are delivered.
+            auto & replay = dynamic_cast< listener::replay_t & >( listener() );
+            auto const start  = latency_t::now();
+            replay.schedule( not _fast );
+            reactor().run();
+            auto const events = replay.played();
+            auto const time   = latency_t::now() - start;
+            if ( not _quiet ) {
+                OUT(
+                    "Replayed " << events << " events in " << time << " µs"
+                        << ( time > 0 ? STR( ", " << events * 1000000 / time << " events/s" ) : "" )
+                        << "."
+                );
+            };
+        } else {
+            if ( not _metrics.empty() ) {
+                metrics().serve( _metrics );
+            };
+            reactor().run();
+            metrics().close();
+        };
+        flight().wait();
         tapper.stop();
+        set_async_print( false );
     };
 };
 
+/**
+    Handles signals read by the reactor: `SIGUSR1` prints latency statistics, `SIGUSR2` dumps the
+    flight recorder, other signals stop the reactor.
+**/
+void
+app_t::on_signal(
+    int signal
+) {
+    if ( signal == SIGUSR1 ) {
+        for ( auto const & line: latency().report() ) {
+            OUT( line );
+        };
+    } else if ( signal == SIGUSR2 ) {
+        auto const path =
+            _trace.empty() ?
+                posix::get_env( "XDG_RUNTIME_DIR", posix::get_home() ) + "/tapper-trace.json" :
+                _trace;
+        /*
+            Formatting and writing the trace takes a while, it is done in background, so the
+            reactor does not stall the listener.
+        */
+        CATCH_ALL(
+            flight().dump( path, flight_t::on_dumped_t::make< app_t, & app_t::on_dumped >( this ) )
+        );
+    } else {
+        reactor().stop();
+    };
+}; // on_signal
+
+/** Reports completion of the flight recorder dump. Called from the dumper thread. **/
+void
+app_t::on_dumped(
+    string_t const & path,
+    string_t const & error
+) {
+    if ( error.empty() ) {
+        OUT( "Flight recorder dumped to " << q( path ) << "." );
+    } else {
+        WRN( "Can't dump flight recorder to " << q( path ) << ": " << error );
+    };
+}; // on_dumped
+
 void
 app_t::print_intro(
 ) {
@@ -1083,7 +1438,8 @@ app_t::print_intro(
             OUT( "Bell is " << bell() << "." );
             for ( auto const & assignment: _settings.assignments ) {
                 OUT(
-                    "Tap on key " << key_name( assignment.first ) << " " <<
+                    "Tap on " << ( assignment.first.is_chord() ? "chord " : "key " )
+                        << trigger_name( assignment.first ) << " " <<
                         to_string( assignment.second ) << "."
                 );
             };
@@ -1136,6 +1492,18 @@ app_t::key_name(
     return listener().key_full_name( key );
 }; // key_name
 
+/** Returns full names of the trigger keys joined with `+`. **/
+string_t
+app_t::trigger_name(
+    trigger_t const & trigger
+) {
+    strings_t names;
+    for ( auto const key: trigger.keys() ) {
+        names.push_back( key_name( key ) );
+    };
+    return join( "+", names );
+}; // trigger_name
+
 /**
     Returns `true` if X Window System session detected, and `false` otherwise.
 **/
@@ -1184,6 +1552,12 @@ is_kde_desktop(
 listener_t &
 app_t::listener(
 ) {
+    if ( not _listener and not _replay.empty() ) {
+        INF( "Selected listener: replay" );
+        privileges().drop_input_group();
+        _listener.reset( listener_replay_create( _replay.c_str() ) );
+        _listener->set_device_policies( _device_policies );
+    };
     if ( not _listener ) {
         if ( _settings.listener <= settings_t::listener_t::Auto ) {
             if ( is_x_session() and WITH_X ) {
@@ -1197,18 +1571,34 @@ app_t::listener(
             };
         };
         INF( "Selected listener: " << _settings.listener );
-        if ( _settings.listener != settings_t::listener_t::libinput ) {
+        if (
+            _settings.listener != settings_t::listener_t::libinput
+            and _settings.listener != settings_t::listener_t::evdev
+        ) {
             // We can drop "input" group now.
             privileges().drop_input_group();
         };
-        if ( _settings.listener == settings_t::listener_t::xrecord and not is_x_session() ) {
+        if (
+            (
+                _settings.listener == settings_t::listener_t::xrecord
+                or _settings.listener == settings_t::listener_t::xi2
+            )
+            and not is_x_session()
+        ) {
             WRN(
                 _settings.listener << " listener selected, "
                     << "but X Window System session is not detected, "
                     << "Tapper will likely fail."
             );
         };
+        if (
+            _settings.listener == settings_t::listener_t::xrecord
+            and not _device_policies.empty()
+        ) {
+            WRN( "XRecord listener can't tell input devices apart, device policies ignored." );
+        };
         _listener.reset( listener_t::create( _settings.listener ) );
+        _listener->set_device_policies( _device_policies );
     };
     return * _listener.get();
 };
@@ -37,6 +37,7 @@
 #include "emitter.hpp"
 #include "layouter.hpp"
 #include "listener.hpp"
+#include "posix.hpp"
 #include "settings.hpp"
 #include "types.hpp"
 
@@ -103,10 +104,14 @@ class app_t: public object_t {
         void             parse_cmdline( int argc, char * argv[] );
         static ::error_t parse_opt_or_arg( int key, char * _arg, argp_state * state );
         void             parse_assignment( string_t const & string );
+        trigger_t        parse_trigger( string_t const & string );
         key_t            parse_key( string_t const & string );
         actions_t        parse_actions( string_t const & string );
         actions_t        parse_action( string_t const & string );
         layout_t         parse_layout( string_t const & string );
+        void             parse_sched( string_t const & string );
+        int              parse_nice( string_t const & string );
+        posix::cpus_t    parse_cpus( string_t const & string );
 
         // Low-level actions, called from parsing routines:
         void set_listener( settings_t::listener_t listener );
@@ -126,12 +131,15 @@ class app_t: public object_t {
         void list_layouts();
         void run();
 
+        void on_signal( int signal );
+        void on_dumped( string_t const & path, string_t const & error );
         void print_intro();
 
         string_t to_string( actions_t const & actions );
 
         string_t layout_name( layout_t layout );
         string_t key_name( key_t key );
+        string_t trigger_name( trigger_t const & trigger );
 
         listener_t &        listener();
         layouter_t &        layouter();
@@ -154,9 +162,25 @@ class app_t: public object_t {
         mode_t              _mode { mode_t::dflt };         ///< Working mode.
         bool                _cmdline_parsed { false };
             ///< `true`, if `parse_cmdline()` has finished, `false` otherwise.
-
-        keys_p              _used_keys;
-            ///< Set of keys used in the command line to detect keys assigned more than once.
+        string_t            _record;
+            ///< If not empty, input events will be recorded to this file.
+        string_t            _replay;
+            ///< If not empty, input events will be replayed from this file instead of listening.
+        bool                _fast { false };
+            ///< If true, input events will be replayed as fast as possible, not in real time.
+        posix::sched_t      _sched;
+            ///< Scheduling parameters of the listener and executor threads.
+        bool                _lock_memory { false };
+            ///< If true, memory will be locked after start-up.
+        string_t            _metrics;
+            ///< If not empty, metrics will be served on this UNIX socket.
+        string_t            _trace;
+            ///< File to dump the flight recorder to on `SIGUSR2`, empty means default.
+        listener_t::device_policies_t _device_policies;
+            ///< Policies of input devices set in the command line, by device name.
+
+        triggers_p          _used_triggers;
+            ///< Keys and chords used in the command line to detect ones assigned more than once.
 
         listener_p          _listener;
         layouter_p          _layouter;
@@ -29,6 +29,7 @@
 
 #include "base.hpp"
 
+#include <atomic>
 #include <iostream>
 #include <map>
 #include <mutex>
@@ -332,7 +333,35 @@ namespace _guts {
 
 #endif // ENABLE_DEBUG
 
-void eprint( priority_t priority, string_t const & message ) {
+bool
+enabled(
+    priority_t priority
+) {
+    return priority <= stderr_min_priority() or priority <= syslog_min_priority;
+}; // enabled
+
+/** Stream a message is printed to. **/
+enum class sink_t {
+    err,    ///< `stderr` (and syslog, if the priority is high enough).
+    out,    ///< `stdout`.
+};
+
+/** Prints the message synchronously. **/
+static
+void
+print(
+    sink_t              sink,
+    priority_t          priority,
+    string_t const &    message
+) {
+    if ( sink == sink_t::out ) {
+        /*
+            Do not use `std::cout <<`! See comment below.
+        */
+        auto buffer = message + "\n";
+        std::cout.write( DATA( buffer ) );
+        return;
+    };
     string_t prefix = "?";
     switch ( priority ) {
         case priority_t::error: {
@@ -367,14 +396,122 @@ void eprint( priority_t priority, string_t const & message ) {
         );
         std::cerr.write( DATA( buffer ) );
     };
+}; // print
+
+/**
+    Background printer of messages.
+
+    Messages are linked into an intrusive lock-free multiple-producer single-consumer queue (the
+    one described by Dmitry Vyukov): a producer appends a message by a single atomic exchange, so
+    it never waits for other producers or the printer, and messages are printed in order of
+    appending. The queue always contains at least one (already printed) message, so producers and
+    the printer never touch the same pointer.
+**/
+class printer_t: public posix::thread_t {
+
+    public:
+
+        struct message_t {
+            std::atomic< message_t * >  next     { nullptr };
+            sink_t                      sink     { sink_t::err };
+            priority_t                  priority { priority_t::error };
+            string_t                    text;
+        };
+
+        printer_t():
+            posix::thread_t( "printer" ),
+            _head( new message_t ),
+            _tail( _head.load() )
+        {
+        };
+
+        /** Appends a message to the queue. Can be called from any thread, does not block. **/
+        void push( sink_t sink, priority_t priority, string_t const & text ) {
+            auto message = new message_t;
+            message->sink     = sink;
+            message->priority = priority;
+            message->text     = text;
+            auto prev = _head.exchange( message, std::memory_order_acq_rel );
+            prev->next.store( message, std::memory_order_release );
+            _semaphore.post();
+        };
+
+        /**
+            Prints all the queued messages. Must not be called concurrently with itself, i. e. it
+            is called either by the printer thread, or when the thread is stopped.
+        **/
+        void drain() {
+            for (
+                auto next = _tail->next.load( std::memory_order_acquire );
+                next;
+                next = _tail->next.load( std::memory_order_acquire )
+            ) {
+                delete _tail;
+                _tail = next;
+                print( _tail->sink, _tail->priority, _tail->text );
+                _tail->text.clear();
+            };
+        };
+
+        void start() {
+            _done = false;
+            posix::thread_t::start();
+        };
+
+        /** Stops the thread. Messages queued before the call are printed. **/
+        void join() {
+            _done = true;
+            _semaphore.post();
+            posix::thread_t::join();
+            drain();
+        };
+
+    protected:
+
+        virtual void body() override {
+            /*
+                Printing may wait for a terminal or syslog, it must not compete with real-time
+                threads, so do not keep the policy inherited from the thread which started printer.
+            */
+            CATCH_ALL( posix::reset_sched() );
+            while ( not _done ) {
+                _semaphore.wait();
+                drain();
+            };
+        };
+
+    private:
+
+        std::atomic< message_t * >  _head;      ///< The last appended message.
+        message_t *                 _tail;      ///< The last printed message.
+        posix::semaphore_t          _semaphore;
+        std::atomic< bool >         _done { false };
+
+}; // class printer_t
+
+/**
+    The printer. It is created once and never destroyed: a message may be printed from any
+    thread at any moment, including static destruction.
+**/
+static printer_t * printer = nullptr;
+
+/** `true` if messages go to the printer, `false` if they are printed synchronously. **/
+static std::atomic< bool > async { false };
+
+void eprint( priority_t priority, string_t const & message ) {
+    if ( async.load( std::memory_order_acquire ) ) {
+        printer->push( sink_t::err, priority, message );
+    } else {
+        print( sink_t::err, priority, message );
+    };
 }; // eprint
 
 void oprint( string_t const & message ) {
-    /*
-        Do not use `std::cout <<`! See comment above.
-    */
-    auto buffer = message + "\n";
-    std::cout.write( DATA( buffer ) );
+    if ( async.load( std::memory_order_acquire ) ) {
+        printer->push( sink_t::out, priority_t::info, message );
+    } else {
+        print( sink_t::out, priority_t::info, message );
+    };
 }; // oprint
 
 }; // namespace _guts
@@ -385,6 +522,26 @@ void set_syslog_min_priority( priority_t priority ) {
         // Never sent trace messages to syslog.
 };
 
+void set_async_print( bool enable ) {
+    using namespace _guts;
+    static std::mutex mutex;
+    std::lock_guard< std::mutex > lock( mutex );
+    if ( enable == async.load( std::memory_order_relaxed ) ) {
+        return;
+    };
+    if ( enable ) {
+        if ( not printer ) {
+            printer = new printer_t();
+            std::atexit( [] () { set_async_print( false ); } );
+        };
+        printer->start();
+        async.store( true, std::memory_order_release );
+    } else {
+        async.store( false, std::memory_order_release );
+        CATCH_ALL( printer->join() );
+    };
+}; // set_async_print
+
 // -------------------------------------------------------------------------------------------------
 // _tracer_t
 // -------------------------------------------------------------------------------------------------
@@ -404,15 +561,19 @@ tracer_t::tracer_t(
     _line( line ),
     _func( func )
 {
-    dprint( _obj, _file, _line, priority_t::trace, STR( func << " {" ) );
+    if ( enabled( priority_t::trace ) ) {
+        dprint( _obj, _file, _line, priority_t::trace, STR( func << " {" ) );
+    };
     ++ _level;
 }; // ctor
 
 tracer_t::~tracer_t(
 ) {
     -- _level;
-    dprint( nullptr, _file, _line, priority_t::trace, "}" );
-    //      ^^^^^^^ Do not prefix "}" with object id.
+    if ( enabled( priority_t::trace ) ) {
+        dprint( nullptr, _file, _line, priority_t::trace, "}" );
+        //      ^^^^^^^ Do not prefix "}" with object id.
+    };
 }; // dtor
 
 }; // namespace _guts
@@ -397,6 +397,12 @@ namespace _guts {
 /// `INF()`, `WRN()`, and `ERR()` guts. Do not use it directly.
 void eprint( priority_t priority, string_t const & message );
 
+/**
+    Returns `true` if messages of the given priority are printed to `stderr` or sent to syslog.
+    Message macros check it before building the message, so a suppressed message costs nothing.
+**/
+bool enabled( priority_t priority );
+
 /// `OUT()` guts. Do not use it directly.
 void oprint( string_t const & message );
 
@@ -408,6 +414,15 @@ void oprint( string_t const & message );
 **/
 void set_syslog_min_priority( priority_t priority );
 
+/**
+    Enables or disables asynchronous printing. If enabled, messages (including `OUT()` ones) are
+    appended to a lock-free queue and printed in order by a background thread, so a slow terminal
+    or syslog never stalls the caller. Disabling prints all the queued messages and stops the
+    thread; it is also done at exit. Enable it when privileges are dropped: the thread inherits
+    capabilities of the calling thread.
+**/
+void set_async_print( bool async );
+
 /**
     Prints debug message.
 
@@ -443,10 +458,22 @@ void set_syslog_min_priority( priority_t priority );
 #define DBG( ARGS ) \
     DBG_( _this_(), ARGS )
 
+/**
+    Evaluates `PRINT` (which builds and prints a message) only if messages of `PRIORITY` are
+    printed. Do not use it directly.
+**/
+#define IF_ENABLED_( PRIORITY, PRINT ) \
+    ( tapper::_guts::enabled( PRIORITY ) ? PRINT : void( 0 ) )
+
 /// `DBG()` guts. Do not use it directly, use `DBG()` instead.
 #if ENABLE_DEBUG
-    #define DBG_( OBJ, ARGS ) \
-        tapper::_guts::dprint( OBJ, __FILE__, __LINE__, tapper::priority_t::debug, STR( ARGS ) )
+    #define DBG_( OBJ, ARGS )                                                                      \
+        IF_ENABLED_(                                                                               \
+            tapper::priority_t::debug,                                                             \
+            tapper::_guts::dprint(                                                                 \
+                OBJ, __FILE__, __LINE__, tapper::priority_t::debug, STR( ARGS )                    \
+            )                                                                                      \
+        )
 #else
     #define DBG_( OBJ, ARGS ) void( 0 )
 #endif
@@ -460,10 +487,18 @@ void set_syslog_min_priority( priority_t priority );
 /// `INF()` guts. Do not use it directly, use `INF()` instead.
 #if ENABLE_DEBUG
     #define INF_( OBJ, ARGS )                                                                      \
-        tapper::_guts::dprint( OBJ, __FILE__, __LINE__, tapper::priority_t::info, STR( ARGS ) )
+        IF_ENABLED_(                                                                               \
+            tapper::priority_t::info,                                                              \
+            tapper::_guts::dprint(                                                                 \
+                OBJ, __FILE__, __LINE__, tapper::priority_t::info, STR( ARGS )                     \
+            )                                                                                      \
+        )
 #else
     #define INF_( OBJ, ARGS )                                                                      \
-        tapper::_guts::eprint( priority_t::info, STR( ARGS ) )
+        IF_ENABLED_(                                                                               \
+            tapper::priority_t::info,                                                              \
+            tapper::_guts::eprint( tapper::priority_t::info, STR( ARGS ) )                         \
+        )
 #endif // ENABLE_DEBUG
 
 /**
@@ -475,10 +510,18 @@ void set_syslog_min_priority( priority_t priority );
 /// `WRN()` guts. Do not use it directly, use `WRN()` instead.
 #if ENABLE_DEBUG
     #define WRN_( OBJ, ARGS )                                                                      \
-        tapper::_guts::dprint( OBJ, __FILE__, __LINE__, tapper::priority_t::warning, STR( ARGS ) )
+        IF_ENABLED_(                                                                               \
+            tapper::priority_t::warning,                                                           \
+            tapper::_guts::dprint(                                                                 \
+                OBJ, __FILE__, __LINE__, tapper::priority_t::warning, STR( ARGS )                  \
+            )                                                                                      \
+        )
 #else
     #define WRN_( OBJ, ARGS )                                                                      \
-        tapper::_guts::eprint( priority_t::warning, STR( ARGS ) )
+        IF_ENABLED_(                                                                               \
+            tapper::priority_t::warning,                                                           \
+            tapper::_guts::eprint( tapper::priority_t::warning, STR( ARGS ) )                      \
+        )
 #endif // ENABLE_DEBUG
 
 /**
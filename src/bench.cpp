@@ -0,0 +1,690 @@
+/*
+    ---------------------------------------------------------------------- copyright and license ---
+
+    File: src/bench.cpp
+
+    Copyright 🄯 2014, 2016—2017, 2019—2023 Van de Bugger.
+
+    This file is part of Tapper.
+
+    Tapper is free software: you can redistribute it and/or modify it under the terms of the GNU
+    General Public License as published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    Tapper is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+    even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along with Tapper.  If not,
+    see <https://www.gnu.org/licenses/>.
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+
+    ---------------------------------------------------------------------- copyright and license ---
+*/
+
+/** @file
+    Tapper benchmark.
+
+    `tapper-bench` feeds generated input events to `tapper_t` and measures how fast the tapper
+    processes them. Events are generated in advance, so only event processing is measured: tap
+    detection, dispatching assigned actions to the executor, and latency statistics. Layouter and
+    emitter are stubs which do nothing, so the benchmark does not depend on a desktop session.
+    Instead of generated events, an input event log recorded by `tapper --record` can be replayed.
+
+    With `--check-allocations` option the benchmark fails if event processing allocates memory,
+    `test/allocations.test` uses it.
+
+    Events are fed much faster than a human can type, so the executor queues may overflow and some
+    actions may be dropped. Warnings about dropped actions are not printed unless `TAPPER_VERBOSITY`
+    environment variable is set.
+
+    Note that debug builds (`--enable-debug`) are much slower: they format debug messages even if
+    the messages are not printed.
+**/
+
+#include "base.hpp"
+
+#include <argp.h>
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include <random>
+
+#include "latency.hpp"
+#include "listener-replay.hpp"
+#include "string.hpp"
+#include "tapper.hpp"
+
+// -------------------------------------------------------------------------------------------------
+// Allocation counting
+// -------------------------------------------------------------------------------------------------
+
+/*
+    Replacement of the global allocation functions. They count allocations made by all the
+    threads; the benchmark reports the number of allocations per event.
+*/
+
+static std::atomic< std::uint64_t > allocations { 0 };
+
+void *
+operator new(
+    std::size_t size
+) {
+    allocations.fetch_add( 1, std::memory_order_relaxed );
+    void * ptr = std::malloc( size ? size : 1 );
+    if ( not ptr ) {
+        throw std::bad_alloc();
+    };
+    return ptr;
+};
+
+void *
+operator new[](
+    std::size_t size
+) {
+    return operator new( size );
+};
+
+void
+operator delete(
+    void * ptr
+) noexcept {
+    std::free( ptr );
+};
+
+void
+operator delete[](
+    void * ptr
+) noexcept {
+    std::free( ptr );
+};
+
+void
+operator delete(
+    void *      ptr,
+    std::size_t
+) noexcept {
+    std::free( ptr );
+};
+
+void
+operator delete[](
+    void *      ptr,
+    std::size_t
+) noexcept {
+    std::free( ptr );
+};
+
+namespace tapper {
+namespace bench {
+
+using event_t  = listener_t::event_t;
+using events_t = std::vector< event_t >;
+
+// -------------------------------------------------------------------------------------------------
+// Stubs
+// -------------------------------------------------------------------------------------------------
+
+/**
+    Listener which does not listen anything, but delivers events given to `feed()`.
+**/
+class listener_t: public object_t, public tapper::listener_t {
+    public:
+        listener_t(): OBJECT_T() {};
+        virtual string_t       type()                   override { return "bench"; };
+        virtual key_t::range_t key_range()              override { return key_t::range_t(); };
+        virtual keys_t         keys()                   override { return keys_t(); };
+        virtual key_t          key( string_t const & )  override { return key_t(); };
+        virtual string_t       key_name( key_t )        override { return ""; };
+        virtual strings_t      key_names( key_t )       override { return strings_t(); };
+        void                   feed( event_t const & event ) { _on_events( & event, 1 ); };
+        /** Registers a device with the given policy, returns its index. **/
+        device_t               add_device( string_t const & name, device_policy_t policy ) {
+            _devices.set_policies( { { name, policy } } );
+            return _devices.add( name );
+        };
+    protected:
+        virtual void           _start()                 override {};
+        virtual void           _stop()                  override {};
+};
+
+/** Layouter which does nothing. **/
+class layouter_t: public object_t, public tapper::layouter_t {
+    public:
+        layouter_t(): OBJECT_T() {};
+        virtual string_t       type()                   override { return "bench"; };
+    protected:
+        virtual void           _activate( layout_t )    override {};
+        virtual time_t         _get_repeat_delay()      override { return 500; };
+};
+
+/** Emitter which does nothing. **/
+class emitter_t: public object_t, public tapper::emitter_t {
+    public:
+        emitter_t(): OBJECT_T() {};
+        virtual string_t       type()                   override { return "bench"; };
+        virtual void           start( keys_t const & )  override {};
+        virtual void           emit( events_t const & ) override {};
+        virtual void           stop()                   override {};
+};
+
+// -------------------------------------------------------------------------------------------------
+// generator_t
+// -------------------------------------------------------------------------------------------------
+
+/** Distribution of intervals between key presses and of key hold durations. **/
+enum class distribution_t {
+    normal,
+    exponential,
+    lognormal,
+};
+
+/** Keys used by the generated workloads. **/
+namespace keys {
+    static key_t const left_ctrl   = key_t(  29 );
+    static key_t const left_shift  = key_t(  42 );
+    static key_t const left_alt    = key_t(  56 );
+    static key_t const right_ctrl  = key_t(  97 );
+    static key_t const left_meta   = key_t( 125 );
+    static key_t const enter       = key_t(  28 );
+    static key_t const modifiers[] = { left_ctrl, left_shift, left_alt, right_ctrl, left_meta };
+    static key_t const letters[]   = {
+        key_t( 16 ), key_t( 17 ), key_t( 18 ), key_t( 19 ), key_t( 20 ),   // Q … T.
+        key_t( 21 ), key_t( 22 ), key_t( 23 ), key_t( 24 ), key_t( 25 ),   // Y … P.
+        key_t( 30 ), key_t( 31 ), key_t( 32 ), key_t( 33 ), key_t( 34 ),   // A … G.
+        key_t( 35 ), key_t( 36 ), key_t( 37 ), key_t( 38 ),                 // H … L.
+        key_t( 44 ), key_t( 45 ), key_t( 46 ), key_t( 47 ), key_t( 48 ),   // Z … B.
+        key_t( 49 ), key_t( 50 ), key_t( 57 ),                              // N, M, Space.
+    };
+    static key_t const digits[]    = {
+        key_t(  2 ), key_t(  3 ), key_t(  4 ), key_t(  5 ), key_t(  6 ),   // 1 … 5.
+        key_t(  7 ), key_t(  8 ), key_t(  9 ), key_t( 10 ), key_t( 11 ),   // 6 … 0.
+    };
+}; // namespace keys
+
+/**
+    Generates input events. Event time starts from 1 second and advances as events are added.
+**/
+class generator_t {
+
+    public:
+
+        struct options_t {
+            distribution_t distribution = distribution_t::lognormal;
+            double         interval     = 150;  ///< Mean interval between key presses, ms.
+            double         jitter       = 60;   ///< Standard deviation of the interval, ms.
+            double         hold         = 90;   ///< Mean key hold duration, ms.
+            uint_t         seed         = 1;
+        };
+
+        explicit generator_t( options_t const & options ):
+            _options( options ),
+            _random( options.seed )
+        {
+        };
+
+        /** Returns random duration, in milliseconds, with the given mean. **/
+        time_t duration( double mean ) {
+            double const stddev = _options.jitter * mean / _options.interval;
+            double value = mean;
+            switch ( _options.distribution ) {
+                case distribution_t::normal: {
+                    value = std::normal_distribution< double >( mean, stddev )( _random );
+                } break;
+                case distribution_t::exponential: {
+                    value = std::exponential_distribution< double >( 1 / mean )( _random );
+                } break;
+                case distribution_t::lognormal: {
+                    double const s2 = std::log( 1 + stddev * stddev / ( mean * mean ) );
+                    double const m  = std::log( mean ) - s2 / 2;
+                    value = std::lognormal_distribution< double >( m, std::sqrt( s2 ) )( _random );
+                } break;
+            };
+            return time_t( std::max( value, 1.0 ) );
+        };
+
+        /** Returns `true` with the given probability. **/
+        bool chance( double probability ) {
+            return std::bernoulli_distribution( probability )( _random );
+        };
+
+        /** Returns random element of the array. **/
+        template< size_t size >
+        key_t any( key_t const ( & keys )[ size ] ) {
+            return keys[ std::uniform_int_distribution< size_t >( 0, size - 1 )( _random ) ];
+        };
+
+        void wait( time_t duration ) {
+            _time += stamp_t( duration ) * 1000;
+        };
+
+        void press( key_t key ) {
+            _events.push_back( { _time, key, key_state_t::pressed } );
+        };
+
+        void release( key_t key ) {
+            _events.push_back( { _time, key, key_state_t::released } );
+        };
+
+        /** Presses and releases the key. **/
+        void tap( key_t key, time_t hold ) {
+            press( key );
+            wait( hold );
+            release( key );
+        };
+
+        double mean_interval() const { return _options.interval; };
+        double mean_hold()     const { return _options.hold; };
+        size_t size()          const { return _events.size(); };
+        events_t & events()          { return _events; };
+
+    private:
+
+        options_t      _options;
+        std::mt19937   _random;
+        stamp_t        _time { 1000000 };    ///< Current time, in microseconds.
+        events_t       _events;
+
+}; // class generator_t
+
+// -------------------------------------------------------------------------------------------------
+// Workloads
+// -------------------------------------------------------------------------------------------------
+
+/**
+    Realistic typing: letters with random intervals and hold durations, sometimes with rollover
+    (the next key is pressed before the previous one is released), sometimes capitalized with
+    Shift, and rare taps on Left Ctrl (an assigned key).
+**/
+static
+void
+typing(
+    generator_t & gen
+) {
+    auto const key = gen.any( keys::letters );
+    gen.wait( gen.duration( gen.mean_interval() ) );
+    if ( gen.chance( 0.02 ) ) {
+        gen.tap( keys::left_ctrl, gen.duration( gen.mean_hold() ) );
+    } else if ( gen.chance( 0.05 ) ) {
+        gen.press( keys::left_shift );
+        gen.wait( gen.duration( gen.mean_hold() ) );
+        gen.tap( key, gen.duration( gen.mean_hold() ) );
+        gen.wait( gen.duration( gen.mean_hold() / 2 ) );
+        gen.release( keys::left_shift );
+    } else if ( gen.chance( 0.15 ) ) {
+        auto const next = gen.any( keys::letters );
+        gen.press( key );
+        gen.wait( gen.duration( gen.mean_hold() / 2 ) );
+        gen.press( next );
+        gen.wait( gen.duration( gen.mean_hold() / 2 ) );
+        gen.release( key );
+        gen.wait( gen.duration( gen.mean_hold() / 2 ) );
+        gen.release( next );
+    } else {
+        gen.tap( key, gen.duration( gen.mean_hold() ) );
+    };
+};
+
+/**
+    Modifier-heavy work: shortcuts with one or two modifiers, and frequent taps on modifiers alone
+    (which are taps Tapper is waiting for).
+**/
+static
+void
+shortcuts(
+    generator_t & gen
+) {
+    gen.wait( gen.duration( gen.mean_interval() ) );
+    auto const first = gen.any( keys::modifiers );
+    if ( gen.chance( 0.3 ) ) {
+        gen.tap( first, gen.duration( gen.mean_hold() ) );
+        return;
+    };
+    auto const second = gen.any( keys::modifiers );
+    bool const two    = not ( second == first ) and gen.chance( 0.3 );
+    gen.press( first );
+    if ( two ) {
+        gen.wait( gen.duration( gen.mean_hold() / 2 ) );
+        gen.press( second );
+    };
+    gen.wait( gen.duration( gen.mean_hold() ) );
+    gen.tap( gen.any( keys::letters ), gen.duration( gen.mean_hold() ) );
+    gen.wait( gen.duration( gen.mean_hold() / 2 ) );
+    if ( two ) {
+        gen.release( second );
+    };
+    gen.release( first );
+};
+
+/**
+    Barcode scanner: 13 digits and Enter, each key is pressed for at most one millisecond, then a
+    pause before the next scan.
+**/
+static
+void
+scanner(
+    generator_t & gen
+) {
+    for ( int i = 0; i < 13; ++ i ) {
+        gen.tap( gen.any( keys::digits ), gen.chance( 0.5 ) ? 1 : 0 );
+        gen.wait( 1 );
+    };
+    gen.tap( keys::enter, 1 );
+    gen.wait( 500 );
+};
+
+/**
+    Pathological long holds: a key (often an assigned one) is held for 2…10 seconds while the
+    kernel autorepeats it every 33 ms after 500 ms delay.
+**/
+static
+void
+holds(
+    generator_t & gen
+) {
+    auto const key = gen.chance( 0.3 ) ? keys::right_ctrl : gen.any( keys::letters );
+    auto const hold = 2000 + gen.duration( 4000 ) % 8000;
+    gen.wait( gen.duration( gen.mean_interval() ) );
+    gen.press( key );
+    for ( time_t held = 500; held < hold; held += 33 ) {
+        gen.wait( held == 500 ? 500 : 33 );
+        gen.press( key );               // Autorepeat.
+    };
+    gen.wait( 33 );
+    gen.release( key );
+};
+
+using workload_t = void ( * )( generator_t & gen );
+
+using policy_t = tapper::listener_t::device_policy_t;
+
+struct workload_info_t {
+    char const * name;
+    workload_t   workload;
+    policy_t     policy;        ///< Policy of the device which sends the events.
+};
+
+static workload_info_t const workloads[] = {
+    { "typing",    typing,    policy_t::normal     },
+    { "shortcuts", shortcuts, policy_t::normal     },
+    { "scanner",   scanner,   policy_t::normal     },
+    { "holds",     holds,     policy_t::normal     },
+    { "isolated",  scanner,   policy_t::state_only },   // Scanner in state-only mode.
+};
+
+// -------------------------------------------------------------------------------------------------
+// Running
+// -------------------------------------------------------------------------------------------------
+
+struct options_t {
+    size_t                  events = 1000000;       ///< Number of events per workload.
+    generator_t::options_t  generator;
+    strings_t               workloads;              ///< Workloads to run.
+    string_t                replay;                 ///< Input event log to replay.
+    bool                    check = false;          ///< Fail if event processing allocates.
+    settings_t::layouter_t  layouter = settings_t::layouter_t::unset;   ///< Real layouter.
+};
+
+/**
+    Assignments used by the benchmark: the default ones (Left and Right Ctrl activate the first and
+    the second layouts), plus a tap on Left Meta emits a keystroke.
+**/
+static assignments_t const assignments {
+    { keys::left_ctrl,  { action_t::activate_layout( layout_t( 1 ) ) } },
+    { keys::right_ctrl, { action_t::activate_layout( layout_t( 2 ) ) } },
+    { keys::left_meta,  { action_t::emit_key_tap( key_t( 183 ) ) } },     // F13.
+};
+
+/**
+    Starts a new tapper, calls `feed` twice, stops the tapper and prints the results. `feed` should
+    deliver events to the listener and return the number of delivered events. The first call warms
+    up (it lets the tapper and the executor threads allocate everything they need lazily), only
+    the second call is measured.
+
+    @return Number of allocations made during the measured call.
+**/
+static
+uint64_t
+measure(
+    char const *                        name,
+    tapper::listener_t &                listener,
+    std::function< size_t() > const &   feed,
+    options_t const &                   options
+) {
+    layouter_t stub;
+    ptr_t< tapper::layouter_t > real;
+    if ( options.layouter != settings_t::layouter_t::unset ) {
+        real.reset( tapper::layouter_t::create( options.layouter ) );
+    };
+    tapper::layouter_t & layouter = real ? * real : stub;
+    emitter_t  emitter;
+    tapper_t   tapper( listener, layouter, emitter );
+    tapper.start( assignments );
+    feed();
+
+    auto const & detector = latency().histogram( latency_t::stage_t::detector );
+    auto const taps  = detector.count();
+    auto const alloc = allocations.load();
+    auto const start = std::chrono::steady_clock::now();
+    auto const count = feed();
+    auto const finish = std::chrono::steady_clock::now();
+    auto const allocs = allocations.load() - alloc;
+    tapper.stop();
+
+    double const ns = std::chrono::duration< double, std::nano >( finish - start ).count();
+    double const n  = double( std::max< size_t >( count, 1 ) );
+    char line[ 200 ];
+    snprintf(
+        line, sizeof( line ), "%-10s %10zu %12.0f %10.1f %12.3f %10llu",
+        name, count, n / ns * 1e9, ns / n, double( allocs ) / n,
+        static_cast< unsigned long long >( detector.count() - taps )
+    );
+    OUT( line );
+    return allocs;
+}; // measure
+
+/** Generates events of the workload and feeds them to a new tapper. **/
+static
+uint64_t
+run(
+    workload_info_t const & info,
+    options_t const &       options
+) {
+    generator_t gen( options.generator );
+    while ( gen.size() < options.events ) {
+        info.workload( gen );
+    };
+    auto & events = gen.events();
+    events.resize( options.events );
+    listener_t listener;
+    if ( info.policy != policy_t::normal ) {
+        auto const device = listener.add_device( info.name, info.policy );
+        for ( auto & event: events ) {
+            event.device = device;
+        };
+    };
+    return measure(
+        info.name,
+        listener,
+        [ & ] () {
+            for ( auto const & event: events ) {
+                listener.feed( event );
+            };
+            return events.size();
+        },
+        options
+    );
+}; // run
+
+/**
+    Replays the input event log (as fast as possible, repeatedly, until the requested number of
+    events is reached) to a new tapper.
+**/
+static
+uint64_t
+replay(
+    options_t const & options
+) {
+    listener::replay_t listener( options.replay );
+    return measure(
+        "replay",
+        listener,
+        [ & ] () {
+            size_t count = 0;
+            while ( count < options.events ) {
+                auto const played = listener.play();
+                if ( played == 0 ) {
+                    break;
+                };
+                count += played;
+            };
+            return count;
+        },
+        options
+    );
+}; // replay
+
+static
+::error_t
+parse_opt(
+    int          key,
+    char *       arg,
+    argp_state * state
+) {
+    auto & options = * static_cast< options_t * >( state->input );
+    try {
+        switch ( key ) {
+            case 'n': {
+                options.events = val< uint_t >( arg );
+            } break;
+            case 'd': {
+                string_t const name = arg;
+                if ( name == "normal" ) {
+                    options.generator.distribution = distribution_t::normal;
+                } else if ( name == "exponential" ) {
+                    options.generator.distribution = distribution_t::exponential;
+                } else if ( name == "lognormal" ) {
+                    options.generator.distribution = distribution_t::lognormal;
+                } else {
+                    argp_error( state, "Unknown distribution %s.", q( name ).c_str() );
+                };
+            } break;
+            case 'i': {
+                options.generator.interval = val< uint_t >( arg );
+            } break;
+            case 'j': {
+                options.generator.jitter = val< uint_t >( arg );
+            } break;
+            case 'h': {
+                options.generator.hold = val< uint_t >( arg );
+            } break;
+            case 's': {
+                options.generator.seed = val< uint_t >( arg );
+            } break;
+            case 'r': {
+                options.replay = arg;
+            } break;
+            case 'c': {
+                options.check = true;
+            } break;
+            case 'l': {
+                options.layouter = val< settings_t::layouter_t >( arg );
+                if ( options.layouter <= settings_t::layouter_t::Auto ) {
+                    argp_error( state, "Layouter should be specified explicitly." );
+                };
+            } break;
+            case ARGP_KEY_ARG: {
+                string_t const name = arg;
+                bool found = false;
+                for ( auto const & info: workloads ) {
+                    found = found or name == info.name;
+                };
+                if ( not found ) {
+                    argp_error( state, "Unknown workload %s.", q( name ).c_str() );
+                };
+                options.workloads.push_back( name );
+            } break;
+            default: {
+                return ARGP_ERR_UNKNOWN;
+            } break;
+        };
+    } catch ( std::exception const & ex ) {
+        argp_error( state, "Bad option %s: %s", q( state->argv[ state->next - 1 ] ).c_str(), ex.what() );
+    };
+    return 0;
+};
+
+}; // namespace bench
+}; // namespace tapper
+
+using namespace tapper;
+
+int
+main(
+    int     argc,
+    char *  argv[]
+) {
+    static argp_option const opts[] = {
+        { "events",       'n', "N",    0, "Number of events per workload (default: 1000000)" },
+        { "distribution", 'd', "DIST", 0,
+            "Distribution of intervals and hold durations: normal, exponential, or lognormal "
+                "(default)" },
+        { "interval",     'i', "MS",   0, "Mean interval between key presses (default: 150)" },
+        { "jitter",       'j', "MS",   0, "Standard deviation of the interval (default: 60)" },
+        { "hold",         'h', "MS",   0, "Mean key hold duration (default: 90)" },
+        { "seed",         's', "N",    0, "Random seed (default: 1)" },
+        { "replay",       'r', "FILE", 0,
+            "Replay input event log FILE (see `tapper --record`) instead of generated workloads" },
+        { "check-allocations", 'c', nullptr, 0,
+            "Fail if processing events allocates memory (warm-up is not checked)" },
+        { "layouter",     'l', "LAYOUTER", 0,
+            "Activate layouts with a real layouter (e. g. gnome or kde) to measure activation "
+                "latency; by default a stub which does nothing is used" },
+        { 0 }
+    };
+    static char const doc[] =
+        "Feeds generated input events to the tapper and measures the performance."
+        "\v"
+        "Workloads: typing, shortcuts, scanner, holds, isolated (the scanner as a state-only "
+        "device). All the workloads are run by default, unless a log is replayed.";
+    argp parser = { opts, bench::parse_opt, "[WORKLOAD...]", doc };
+    setenv( "TAPPER_VERBOSITY", "3", 0 );     // Errors only, if not set by user.
+    bench::options_t options;
+    argp_parse( & parser, argc, argv, 0, nullptr, & options );
+
+    int status = 0;
+    auto what = CATCH_ALL(
+        uint64_t allocs = 0;
+        OUT( "workload       events     events/s   ns/event allocs/event       taps" );
+        for ( auto const & info: bench::workloads ) {
+            if (
+                ( options.workloads.empty() and options.replay.empty() )
+                or find( info.name, options.workloads ) != npos
+            ) {
+                allocs += bench::run( info, options );
+            };
+        };
+        if ( not options.replay.empty() ) {
+            allocs += bench::replay( options );
+        };
+        for ( auto const & line: latency().report() ) {
+            OUT( line );
+        };
+        if ( options.check and allocs != 0 ) {
+            using error_t = std::runtime_error;
+            ERR( "Event processing made " << allocs << " memory allocations." );
+        };
+    );
+    if ( not what.empty() ) {
+        _guts::eprint( priority_t::error, what );
+        status = 1;
+    };
+    return status;
+};
+
+// end of file //
@@ -0,0 +1,107 @@
+/*
+    ---------------------------------------------------------------------- copyright and license ---
+
+    File: src/callback.hpp
+
+    Copyright 🄯 2014, 2016—2017, 2019—2023 Van de Bugger.
+
+    This file is part of Tapper.
+
+    Tapper is free software: you can redistribute it and/or modify it under the terms of the GNU
+    General Public License as published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    Tapper is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+    even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along with Tapper.  If not,
+    see <https://www.gnu.org/licenses/>.
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+
+    ---------------------------------------------------------------------- copyright and license ---
+*/
+
+/** @file
+    `callback_t` template defined here.
+**/
+
+#ifndef _TAPPER_CALLBACK_HPP_
+#define _TAPPER_CALLBACK_HPP_
+
+#include "base.hpp"
+
+#include <cstddef>          // std::nullptr_t
+
+namespace tapper {
+namespace t {
+
+/**
+    Callback: a pointer to an object and its method, called with arguments `args_t`.
+
+    Unlike `std::function` built with `std::bind`, a callback never allocates memory, it is just a
+    pair of pointers, so it can be copied and called freely on hot paths (e. g. on every input
+    event).
+
+    Usage:
+    @code
+        using on_event_t = t::callback_t< event_t const & >;
+        on_event_t on_event = on_event_t::make< tapper_t, & tapper_t::_on_event >( this );
+        ...
+        if ( on_event ) {
+            on_event( event );
+        };
+    @endcode
+**/
+template< typename ... args_t >
+class callback_t {
+
+    public:
+
+        /** Constructs an empty callback. **/
+        callback_t( std::nullptr_t = nullptr ) {};
+
+        /** Constructs a callback which calls the `method` of the `object`. **/
+        template< typename class_t, void ( class_t::* method )( args_t ... ) >
+        static callback_t make( class_t * object ) {
+            return callback_t( object, & _invoke< class_t, method > );
+        };
+
+        /** Calls the callback. The callback must not be empty. **/
+        void operator ()( args_t ... args ) const {
+            assert( _function );
+            _function( _object, args ... );
+        };
+
+        /** Returns `true` if the callback is not empty. **/
+        explicit operator bool() const {
+            return _function != nullptr;
+        };
+
+    private:
+
+        using function_t = void ( * )( void *, args_t ... );
+
+        callback_t( void * object, function_t function ):
+            _object( object ),
+            _function( function )
+        {
+        };
+
+        template< typename class_t, void ( class_t::* method )( args_t ... ) >
+        static void _invoke( void * object, args_t ... args ) {
+            ( static_cast< class_t * >( object )->*method )( args ... );
+        };
+
+        void *      _object   { nullptr };
+        function_t  _function { nullptr };
+
+}; // class callback_t
+
+}; // namespace t
+}; // namespace tapper
+
+#endif // _TAPPER_CALLBACK_HPP_
+
+// end of file //
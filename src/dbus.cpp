@@ -29,20 +29,54 @@
 
 #include "dbus.hpp"
 
+#include <algorithm>
 #include <atomic>
+#include <future>
+#include <memory>
 
 #include <glibmm/error.h>
 #include <glibmm/main.h>
 
+#include <giomm/asyncresult.h>
 #include <giomm/dbusconnection.h>
+#include <giomm/dbusintrospection.h>
 #include <giomm/dbusproxy.h>
 #include <giomm/dbuswatchname.h>
 
+#include "flight.hpp"
+#include "metrics.hpp"
 #include "posix.hpp"
 #include "string.hpp"
 
 namespace tapper {
 
+/** Counts a failed call in `metrics()` statistics. **/
+static
+void
+count_failure(
+    std::exception_ptr error
+) {
+    auto kind = metrics_t::dbus_error_t::other;
+    try {
+        std::rethrow_exception( error );
+    } catch ( dbus_t::error_t const & ex ) {
+        if ( ex.code() == dbus_t::error_t::no_such_bus ) {
+            kind = metrics_t::dbus_error_t::no_such_bus;
+        } else if ( ex.code() == dbus_t::error_t::bad_result_type ) {
+            kind = metrics_t::dbus_error_t::bad_result_type;
+        };
+    } catch ( Glib::Error const & ex ) {
+        if ( ex.matches( G_IO_ERROR, G_IO_ERROR_TIMED_OUT ) ) {
+            kind = metrics_t::dbus_error_t::timeout;
+        };
+    } catch ( ... ) {
+    };
+    metrics().dbus_error( kind );
+};
+
+stamp_t constexpr dbus_t::min_deadline;
+stamp_t constexpr dbus_t::max_deadline;
+
 // -------------------------------------------------------------------------------------------------
 // dbus_t::error_t
 // -------------------------------------------------------------------------------------------------
@@ -107,15 +141,17 @@ class dbus_t::thread_t: public posix::thread_t {
 // -------------------------------------------------------------------------------------------------
 
 dbus_t::dbus_t(
-    string_t const & name,
-    string_t const & path,
-    string_t const & face
+    string_t const &    name,
+    string_t const &    path,
+    string_t const &    face,
+    methods_t const &   methods
 ):
     OBJECT_T(),
     _name( name ),
     _path( path ),
     _face( face ),
-    _thread( new thread_t() )
+    _thread( new thread_t() ),
+    _expected( methods )
 {
     TRACE();
     _thread->start();
@@ -128,10 +164,18 @@ dbus_t::dbus_t(
             string_t,
             string_t const &
         ) {
-            lock_t  lock( _mutex );
             DBG( "Name " << q( _name ) << " appeared in the session bus." );
-            _conn  = connection;
-            _proxy = Gio::DBus::Proxy::create_sync( _conn, _name, _path, _face );
+            /*
+                Prepare everything before publishing the connection, so callers never meet a
+                half-initialized object. Callers do not wait: a call made meanwhile fails with
+                `no_such_bus` error, like a call made before the name appeared.
+            */
+            auto proxy   = Gio::DBus::Proxy::create_sync( connection, _name, _path, _face );
+            auto methods = _prewarm( connection );
+            lock_t  lock( _mutex );
+            _conn    = connection;
+            _proxy   = proxy;
+            _methods = methods;
             _cvar.notify_all();
         },
         [ this ](
@@ -172,59 +216,277 @@ dbus_t::face(
     return _face;
 };
 
-Glib::VariantContainerBase
+void
 dbus_t::call(
     string_t const &                    method,
-    Glib::VariantContainerBase const &  args,
+    reply_t const &                     args,
+    string_t const &                    expected_result_type,
+    on_reply_t                          on_reply
+) {
+    TRACE();
+    metrics().dbus_call();
+    proxy_t       proxy;
+    std::uint64_t seq;
+    {
+        lock_t lock( _mutex );
+        proxy = _proxy;
+        seq   = ++ _calls[ method ];
+    }
+    if ( not proxy ) {
+        std::exception_ptr error;
+        try {
+            ERR( "There is no " << q( _name ) << " session bus.", error_t::no_such_bus );
+        } catch ( ... ) {
+            error = std::current_exception();
+        };
+        count_failure( error );
+        stamp_t const now = latency_t::now();
+        flight().record( flight_t::kind_t::dbus, now, now, 0, true );
+        on_reply( reply_t(), error );
+        return;
+    };
+    _call( proxy, method, args, expected_result_type, on_reply, seq, false );
+}; // call
+
+dbus_t::reply_t
+dbus_t::call(
+    string_t const &                    method,
+    reply_t const &                     args,
     string_t const &                    expected_result_type,
     std::chrono::milliseconds           timeout
 ) {
     TRACE();
-    Glib::VariantContainerBase reply;
-    lock_t lock( _mutex );
-    auto ok = _cvar.wait_for(
-        lock,
-        timeout,
-        [ this ] () {
-            return !! _conn;
+    {
+        lock_t lock( _mutex );
+        _cvar.wait_for(
+            lock,
+            timeout.count() ? timeout : deadline(),
+            [ this ] () {
+                return !! _conn;
+            }
+        );
+    }
+    auto promise = std::make_shared< std::promise< reply_t > >();
+    call(
+        method,
+        args,
+        expected_result_type,
+        [ promise ]( reply_t const & reply, std::exception_ptr error ) {
+            if ( error ) {
+                promise->set_exception( error );
+            } else {
+                promise->set_value( reply );
+            };
         }
     );
-    if ( not ok ) {
-        ERR( "There is no " << q( _name ) << " session bus.", error_t::no_such_bus );
+    return promise->get_future().get();
+}; // call
+
+std::chrono::milliseconds
+dbus_t::deadline(
+) const {
+    stamp_t const srtt = _srtt;
+    if ( not srtt ) {
+        return std::chrono::milliseconds( max_deadline / 1000 );
     };
-    DBG( "call: " << q( method ) << "." );
-    reply = _proxy->call_sync( method, args );
-    DBG( "repl: " << reply.print() );
-    if ( _methods.find( method ) == _methods.end() ) {
-        //~ try {
-        //~ } catch ( Glib::Error const & ex ) {
-            /*
-                When GNOME Shell is restarted, it takes some time to restart all extensions.
-                During this time method call may fail. Do not throw error if Gnome appeared
-                less than few seconds ago.
-            */
-            //~ if ( ex.matches( G_DBUS_ERROR, G_DBUS_ERROR_UNKNOWN_METHOD ) ) {
-                //~ WRN( ex.what() );
-                //~ ok = false;
-            //~ } else {
-                //~ ERR( ex.what() );
-            //~ };
-        //~ } catch ( Glib::Exception const & ex ) {
-            //~ ERR( ex.what() );
-        //~ };
-        string_t const actual_result_type = reply.get_type().get_string();
-        auto eq = actual_result_type == expected_result_type;
-        if ( not eq ) {
-            ERR(
-                q( method ) << " method "
-                    << "is expected to return " << q( expected_result_type )
-                    << " but actually it returned " << q( actual_result_type ),
-                error_t::bad_result_type
-            );
+    stamp_t const rto = std::max( srtt + 4 * _rttvar, min_deadline ) << _backoff;
+    return std::chrono::milliseconds( std::min( rto, max_deadline ) / 1000 );
+}; // deadline
+
+/**
+    Issues an asynchronous call. If the call times out, the deadline is backed off and the call is
+    retried once — unless a newer call to the same method has been issued meanwhile: retrying a
+    stale call would undo the newer one (e. g. activate a layout the user has already switched
+    from). As in Karn's algorithm, the round-trip time of a retried call is not sampled: the reply
+    may be late because of the first attempt. Thus, the backed-off deadline remains until a not
+    retried call completes.
+**/
+void
+dbus_t::_call(
+    proxy_t const &                     proxy,
+    string_t const &                    method,
+    reply_t const &                     args,
+    string_t const &                    expected_result_type,
+    on_reply_t                          on_reply,
+    std::uint64_t                       seq,
+    bool                                retry
+) {
+    DBG( ( retry ? "retry: " : "call: " ) << q( method ) << "." );
+    auto const start = latency_t::now();
+    proxy->call(
+        method,
+        [ this, proxy, method, args, expected_result_type, on_reply, seq, retry, start ](
+            Glib::RefPtr< Gio::AsyncResult > & result
+        ) {
+            reply_t            reply;
+            std::exception_ptr error;
+            bool               timeout = false;
+            try {
+                reply = proxy->call_finish( result );
+                if ( not retry ) {
+                    _update_rtt( latency_t::now() - start );
+                };
+                DBG( "repl: " << reply.print() );
+                _check( method, reply, expected_result_type );
+            } catch ( Glib::Error const & ex ) {
+                timeout = ex.matches( G_IO_ERROR, G_IO_ERROR_TIMED_OUT );
+                reply = reply_t();
+                error = std::current_exception();
+                count_failure( error );
+            } catch ( ... ) {
+                reply = reply_t();
+                error = std::current_exception();
+                count_failure( error );
+            };
+            flight().record( flight_t::kind_t::dbus, start, latency_t::now(), 0, bool( error ) );
+            if ( timeout ) {
+                _back_off();
+                if ( not retry and not _superseded( method, seq ) ) {
+                    _call( proxy, method, args, expected_result_type, on_reply, seq, true );
+                    return;
+                };
+            };
+            on_reply( reply, error );
+        },
+        args,
+        int( deadline().count() )
+    );
+}; // _call
+
+/** Returns `true` if a call to the method has been issued after the call number `seq`. **/
+bool
+dbus_t::_superseded(
+    string_t const &    method,
+    std::uint64_t       seq
+) {
+    lock_t lock( _mutex );
+    return _calls[ method ] != seq;
+}; // _superseded
+
+/**
+    Makes sure the method returned the result of expected type. Every method is checked only once,
+    the first time it returns.
+**/
+void
+dbus_t::_check(
+    string_t const &    method,
+    reply_t const &     reply,
+    string_t const &    expected
+) {
+    lock_t lock( _mutex );
+    if ( _methods.find( method ) != _methods.end() ) {
+        return;
+    };
+    string_t const actual = reply.get_type().get_string();
+    if ( actual != expected ) {
+        ERR(
+            q( method ) << " method "
+                << "is expected to return " << q( expected )
+                << " but actually it returned " << q( actual ),
+            error_t::bad_result_type
+        );
+    };
+    _methods.insert( method );
+}; // _check
+
+/**
+    Validates result types of the expected methods by introspecting the remote object. Returns the
+    set of methods which are found and return the expected types. Methods which are not found (e.
+    g. GNOME Shell extension is not loaded yet) will be validated by the first call.
+**/
+std::set< string_t >
+dbus_t::_prewarm(
+    connection_t const & connection
+) {
+    std::set< string_t > methods;
+    if ( _expected.empty() ) {
+        return methods;
+    };
+    try {
+        auto const reply = connection->call_sync(
+            _path,
+            "org.freedesktop.DBus.Introspectable",
+            "Introspect",
+            Glib::VariantContainerBase(),
+            _name,
+            int( deadline().count() )
+        );
+        auto const xml   = CAST_DYNAMIC( Variant< string_t >, reply.get_child( 0 ) ).get();
+        auto const node  = Gio::DBus::NodeInfo::create_for_xml( xml );
+        auto const iface = node->lookup_interface( _face );
+        if ( not iface ) {
+            INF( "Interface " << q( _face ) << " not found at " << q( _path ) << "." );
+            return methods;
+        };
+        for ( auto const & method: _expected ) {
+            auto const info = iface->lookup_method( method.first );
+            if ( not info ) {
+                INF( "Method " << q( method.first ) << " not found in " << q( _face ) << "." );
+                continue;
+            };
+            string_t actual = "(";
+            for ( auto arg = info->gobj()->out_args; arg and * arg; ++ arg ) {
+                actual += ( * arg )->signature;
+            };
+            actual += ")";
+            if ( actual != method.second ) {
+                WRN(
+                    q( method.first ) << " method "
+                        << "is expected to return " << q( method.second )
+                        << " but actually it returns " << q( actual )
+                );
+                continue;
+            };
+            DBG( "Method " << q( method.first ) << " validated." );
+            methods.insert( method.first );
         };
-        _methods.insert( method );
+    } catch ( Glib::Error const & ex ) {
+        INF( "Can't introspect " << q( _path ) << " of " << q( _name ) << ": " << ex.what() );
+    };
+    return methods;
+}; // _prewarm
+
+/**
+    Updates round-trip time estimations with a new sample, as described in RFC 6298. Called from
+    the D-Bus thread only, so there are no concurrent updates.
+**/
+void
+dbus_t::_update_rtt(
+    stamp_t rtt
+) {
+    stamp_t const srtt = _srtt;
+    if ( not srtt ) {
+        _srtt   = rtt;
+        _rttvar = rtt / 2;
+    } else {
+        stamp_t const diff = srtt > rtt ? srtt - rtt : rtt - srtt;
+        _rttvar = ( 3 * _rttvar + diff ) / 4;
+        _srtt   = ( 7 * srtt + rtt ) / 8;
+    };
+    _backoff = 0;
+}; // _update_rtt
+
+/**
+    Doubles the deadline after a timeout (RFC 6298, section 5.5). The deadline never exceeds
+    `max_deadline`, so there is no point to double it further. Called from the D-Bus thread only.
+**/
+void
+dbus_t::_back_off(
+) {
+    stamp_t const srtt = _srtt;
+    if ( srtt and ( std::max( srtt + 4 * _rttvar, min_deadline ) << _backoff ) < max_deadline ) {
+        ++ _backoff;
     };
-    return reply;
+    DBG( "D-Bus call deadline backed off to " << deadline().count() << " ms." );
+}; // _back_off
+
+bool
+dbus_t::boolean(
+    Glib::VariantContainerBase const & reply
+) {
+    gboolean value = FALSE;
+    g_variant_get( const_cast< GVariant * >( reply.gobj() ), "(b)", & value );
+    return value;
 };
 
 }; // namespace tapper
@@ -30,7 +30,13 @@
 #ifndef _TAPPER_DBUS_HPP_
 #define _TAPPER_DBUS_HPP_
 
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <map>
 #include <mutex>
 #include <set>
 
@@ -38,6 +44,7 @@
 #include <glibmm/variant.h>
 
 #include "base.hpp"
+#include "latency.hpp"
 
 namespace Gio {
     namespace DBus {
@@ -77,10 +84,28 @@ class dbus_t: public object_t {
                 code_t _code;
         };
 
+        using reply_t = Glib::VariantContainerBase;
+
+        /**
+            Completion callback of an asynchronous call. If the call failed, `error` holds the
+            exception (`error_t` or `Glib::Error`), and `reply` is empty.
+        **/
+        using on_reply_t = std::function< void( reply_t const & reply, std::exception_ptr error ) >;
+
+        /** Methods to validate in advance: method name → expected result type. **/
+        using methods_t = std::map< string_t, string_t >;
+
+        /**
+            Starts watching the bus name. When the name appears, the object creates the proxy and
+            validates result types of the given `methods` by introspecting the remote object, so
+            the first call of a method does not pay for it. The name is reported as present only
+            when it is done.
+        **/
         dbus_t(
-            string_t const & name,
-            string_t const & path,
-            string_t const & face
+            string_t const &    name,
+            string_t const &    path,
+            string_t const &    face,
+            methods_t const &   methods = methods_t()
         );
         ~dbus_t();
 
@@ -88,14 +113,56 @@ class dbus_t: public object_t {
         string_t path() const;
         string_t face() const;
 
-        Glib::VariantContainerBase
+        /**
+            Calls the method asynchronously and returns immediately. `on_reply` is called from the
+            D-Bus thread when the reply arrives, the call fails, or the deadline (see `deadline()`)
+            expires. If the bus name is not present at the moment, `on_reply` is called with
+            `no_such_bus` error before the function returns. Any number of calls may be in flight
+            at once.
+
+            A call which times out is retried once, with the backed-off deadline, unless a newer
+            call to the same method has been issued meanwhile: a stale retry must not override the
+            newer call. The timed out attempt may have been executed anyway, so the called methods
+            must be idempotent (activating a layout or querying layouts is). Because of retries,
+            replies may come out of order of calls.
+        **/
+        void
+        call(
+            string_t const &                    method,
+            reply_t const &                     args,
+            string_t const &                    expected_result_type,
+            on_reply_t                          on_reply
+        );
+
+        /**
+            Calls the method and waits for the reply. If the bus name is not present yet, waits
+            for it not longer than `timeout`; zero timeout means `deadline()`. Must not be called
+            from the D-Bus thread (e. g. from a completion callback), because the reply is
+            delivered by that thread.
+        **/
+        reply_t
         call(
             string_t const &                    method,
-            Glib::VariantContainerBase const &  args,
+            reply_t const &                     args,
             string_t const &                    expected_result_type,
             std::chrono::milliseconds           timeout = std::chrono::milliseconds( 0 )
         );
 
+        /**
+            Returns the current call deadline computed from the observed round-trip times, like TCP
+            retransmission timeout: smoothed round-trip time plus four its deviations, but not less
+            than `min_deadline` and not more than `max_deadline`. Until the first reply arrives,
+            `max_deadline` is returned. Every timed out call doubles the deadline (up to
+            `max_deadline`) until a reply to a not retried call brings a new round-trip time sample.
+        **/
+        std::chrono::milliseconds deadline() const;
+
+        /**
+            Returns value of a reply of type `(b)`. `call()` checks reply type, so the function
+            does not check it again and does not create intermediate variants.
+        **/
+        static bool boolean( Glib::VariantContainerBase const & reply );
+
     private:
 
         class thread_t;
@@ -107,6 +174,24 @@ class dbus_t: public object_t {
         using connection_t = Glib::RefPtr< Gio::DBus::Connection >;
         using proxy_t      = Glib::RefPtr< Gio::DBus::Proxy >;
 
+    private:
+
+        void
+        _call(
+            proxy_t const &                     proxy,
+            string_t const &                    method,
+            reply_t const &                     args,
+            string_t const &                    expected_result_type,
+            on_reply_t                          on_reply,
+            std::uint64_t                       seq,
+            bool                                retry
+        );
+        bool _superseded( string_t const & method, std::uint64_t seq );
+        void _check( string_t const & method, reply_t const & reply, string_t const & expected );
+        std::set< string_t > _prewarm( connection_t const & connection );
+        void _update_rtt( stamp_t rtt );
+        void _back_off();
+
     private:
 
         string_t const          _name;
@@ -119,7 +204,15 @@ class dbus_t: public object_t {
         guint                   _id;
         connection_t            _conn;
         proxy_t                 _proxy;
-        std::set< string_t >    _methods;
+        methods_t const         _expected;      ///< Methods to validate when the name appears.
+        std::set< string_t >    _methods;       ///< Methods with validated result types.
+        std::map< string_t, std::uint64_t > _calls; ///< Number of issued calls, by method.
+        std::atomic< stamp_t >  _srtt   { 0 };      ///< Smoothed round-trip time, µs.
+        std::atomic< stamp_t >  _rttvar { 0 };      ///< Round-trip time deviation, µs.
+        std::atomic< unsigned > _backoff { 0 };     ///< Number of deadline doublings.
+
+        static stamp_t constexpr min_deadline =  100000;   ///< Lower bound of deadline, µs.
+        static stamp_t constexpr max_deadline = 5000000;   ///< Upper bound of deadline, µs.
 
 }; // class dbus_t
 
@@ -47,10 +47,13 @@ namespace emitter {
 // libevdev_t
 // -------------------------------------------------------------------------------------------------
 
+size_t constexpr libevdev_t::batch;
+
 libevdev_t::libevdev_t(
 ):
     OBJECT_T()
 {
+    _frames.reserve( 2 * batch );
 }; // ctor
 
 string_t
@@ -91,22 +94,32 @@ libevdev_t::stop(
     _uinput.reset();
 }; // stop
 
+/**
+    Every key event is reported in its own frame, like a real keyboard does, so press and release
+    of the same key never meet in one frame. All the frames are written at once, so a sequence
+    costs one system call rather than two per key.
+**/
 void
 libevdev_t::emit(
     events_t const & events
 ) {
+    using uinput_t = libevdev::uinput_t;
+    _frames.clear();
     for (auto & event: events) {
         if ( event.key.code() ) {
             DBG(
                 "Emitting " << event.key << " " <<
                     ( event.state == key_state_t::pressed ? "press" : "release" ) << "…"
             );
-            _uinput->write_event(
-                linux::ev_key, event.key.code(), event.state == key_state_t::pressed
+            uinput_t::add_event(
+                _frames, linux::ev_key, event.key.code(), event.state == key_state_t::pressed
             );
+            uinput_t::add_event( _frames, linux::ev_syn, linux::syn_report, 0 );
         };
     };
-    _uinput->write_event( linux::ev_syn, linux::syn_report, 0 );
+    if ( not _frames.empty() ) {
+        _uinput->write_events( _frames );
+    };
 }; // emit
 
 }; // namespace emitter
@@ -57,8 +57,12 @@ class libevdev_t: public object_t, public emitter_t {
 
     private:
 
-        libevdev::uinput_p  _uinput;
-        keys_t              _keys;
+        /** Usual number of events in a sequence, `_frames` is preallocated for it. **/
+        static size_t constexpr batch = 8;
+
+        libevdev::uinput_p              _uinput;
+        keys_t                          _keys;
+        libevdev::uinput_t::events_t    _frames;    ///< Events being emitted, with `SYN_REPORT`s.
 
 }; // class libevdev_t
 
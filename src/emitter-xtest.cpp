@@ -50,7 +50,8 @@ namespace emitter {
 xtest_t::xtest_t(
 ):
     OBJECT_T(),
-    _test( _display )
+    _display( x::shared_display() ),
+    _test( * _display )
 {
 }; // ctor
 
@@ -72,6 +73,10 @@ xtest_t::stop(
 ) {
 };
 
+/**
+    XTest requests do not have replies, so the events are just flushed to the server. An error, if
+    any, is thrown by a later call.
+**/
 void
 xtest_t::emit(
     events_t const & events
@@ -89,7 +94,7 @@ xtest_t::emit(
             };
         };
     };
-    _display.sync();
+    _display->flush();
 };
 
 }; // namespace emitter
@@ -57,7 +57,7 @@ class xtest_t: public object_t, public emitter_t {
 
     private:
 
-        x::display_t    _display;
+        x::display_s    _display;   ///< Shared with the Xkb layouter.
         x::test_t       _test;
 
 }; // class xtest_t
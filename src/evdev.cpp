@@ -0,0 +1,517 @@
+/*
+    ---------------------------------------------------------------------- copyright and license ---
+
+    File: src/evdev.cpp
+
+    Copyright 🄯 2014, 2016—2017, 2019—2023 Van de Bugger.
+
+    This file is part of Tapper.
+
+    Tapper is free software: you can redistribute it and/or modify it under the terms of the GNU
+    General Public License as published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    Tapper is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+    even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along with Tapper.  If not,
+    see <https://www.gnu.org/licenses/>.
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+
+    ---------------------------------------------------------------------- copyright and license ---
+*/
+
+/** @file
+    evdev wrappers implementation.
+**/
+
+#include "evdev.hpp"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <libudev.h>
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "latency.hpp"
+#include "privileges.hpp"
+#include "reactor.hpp"
+#include "string.hpp"
+
+namespace tapper {
+namespace evdev {
+
+using bits_t = unsigned long;
+
+/** Number of bits in one `bits_t` item. **/
+static size_t constexpr bits_per_item = 8 * sizeof( bits_t );
+
+/** Returns `true` if bit `bit` is set in the bit array. **/
+static
+bool
+test_bit(
+    bits_t const *  bits,
+    uint_t          bit
+) {
+    return bits[ bit / bits_per_item ] & ( 1UL << ( bit % bits_per_item ) );
+};
+
+/** Sets bit `bit` in the bit array. **/
+static
+void
+set_bit(
+    bits_t *        bits,
+    uint_t          bit
+) {
+    bits[ bit / bits_per_item ] |= 1UL << ( bit % bits_per_item );
+};
+
+/** Returns seat the udev device is assigned to. **/
+static
+string_t
+seat(
+    udev_device * device
+) {
+    auto seat = udev_device_get_property_value( device, "ID_SEAT" );
+    return seat ? seat : "seat0";
+};
+
+/**
+    Returns device node of the udev device if it is an evdev device on the given seat, or empty
+    string otherwise.
+**/
+static
+string_t
+evdev_node(
+    udev_device *       device,
+    string_t const &    wanted
+) {
+    auto node = udev_device_get_devnode( device );
+    if ( not node or not has_prefix( node, "/dev/input/event" ) ) {
+        return "";
+    };
+    if ( seat( device ) != wanted ) {
+        return "";
+    };
+    return node;
+};
+
+// -------------------------------------------------------------------------------------------------
+// context_t
+// -------------------------------------------------------------------------------------------------
+
+context_t::context_t(
+    string_t const &    seat
+):
+    OBJECT_T(),
+    _seat( seat )
+{
+}; // ctor
+
+context_t::~context_t(
+) {
+    CATCH_ALL( disable() );
+    _devices.clear();
+    if ( _epoll != -1 ) {
+        ::close( _epoll );
+    };
+    if ( _monitor ) {
+        udev_monitor_unref( _monitor );
+    };
+    if ( _udev ) {
+        udev_unref( _udev );
+    };
+}; // dtor
+
+void
+context_t::enable(
+    on_events_t     on_events,
+    registry_t &    registry
+) {
+    _batch    = batch_t( on_events );
+    _registry = & registry;
+    _epoll = epoll_create1( EPOLL_CLOEXEC );
+    if ( _epoll == -1 ) {
+        int error = errno;
+        ERR( "Failed to create epoll instance: " << posix::syserrmsg( error ) << "." );
+    };
+    _udev = udev_new();
+    if ( not _udev ) {
+        ERR( "Failed to initialize udev." );
+    };
+    /*
+        Start monitoring before enumerating existing devices, otherwise a device plugged in between
+        enumeration and monitor creation would be lost.
+    */
+    _monitor = udev_monitor_new_from_netlink( _udev, "udev" );
+    if ( not _monitor ) {
+        ERR( "Failed to create udev monitor." );
+    };
+    udev_monitor_filter_add_match_subsystem_devtype( _monitor, "input", nullptr );
+    if ( udev_monitor_enable_receiving( _monitor ) < 0 ) {
+        ERR( "Failed to enable udev monitor." );
+    };
+    _watch( udev_monitor_get_fd( _monitor ), nullptr );
+    auto enumerate = udev_enumerate_new( _udev );
+    if ( not enumerate ) {
+        ERR( "Failed to enumerate input devices." );
+    };
+    udev_enumerate_add_match_subsystem( enumerate, "input" );
+    udev_enumerate_add_match_sysname( enumerate, "event*" );
+    udev_enumerate_scan_devices( enumerate );
+    udev_list_entry * entry = nullptr;
+    udev_list_entry_foreach( entry, udev_enumerate_get_list_entry( enumerate ) ) {
+        auto device = udev_device_new_from_syspath( _udev, udev_list_entry_get_name( entry ) );
+        if ( device ) {
+            auto path = evdev_node( device, _seat );
+            if ( not path.empty() ) {
+                CATCH_ALL( _add( path ) );
+            };
+            udev_device_unref( device );
+        };
+    };
+    udev_enumerate_unref( enumerate );
+    reactor().watch(
+        _epoll, reactor_t::on_ready_t::make< context_t, & context_t::_dispatch >( this )
+    );
+    _state = state_t::enabled;
+}; // enable
+
+void
+context_t::disable(
+) {
+    switch ( _state ) {
+        case state_t::inited: {
+            // Not enabled — nothing to do.
+        } break;
+        case state_t::enabled: {
+            reactor().unwatch( _epoll );
+            _state = state_t::disabled;
+        } break;
+        case state_t::disabled: {
+            // Already disabled — nothing to do.
+        } break;
+    };
+}; // disable
+
+/**
+    Adds file descriptor to the epoll set. `ptr` is either a device or `nullptr` for the udev
+    monitor.
+**/
+void
+context_t::_watch(
+    int     fd,
+    void *  ptr
+) {
+    epoll_event event {
+        .events = EPOLLIN,
+        .data   = { .ptr = ptr },
+    };
+    if ( epoll_ctl( _epoll, EPOLL_CTL_ADD, fd, & event ) ) {
+        int error = errno;
+        ERR( "Failed to watch fd #" << fd << ": " << posix::syserrmsg( error ) << "." );
+    };
+}; // _watch
+
+/**
+    Opens the device and starts watching it, if the device can produce key events. Devices which
+    can't (accelerometers, lid switches, etc) and ignored devices are closed immediately.
+**/
+void
+context_t::_add(
+    string_t const & path
+) {
+    /*
+        A device removed and plugged again within one dispatch is already moved to `_removed`, so
+        its path is free: the new device is opened, the old one is purged as usual.
+    */
+    if ( _devices.count( path ) ) {
+        return;
+    };
+    device_p device( new device_t );
+    device->path = path;
+    auto & file = device->file;
+    privileges().do_as_input( [ & file, & path ] () {
+        file.open( path, O_RDONLY | O_NONBLOCK | O_CLOEXEC );
+    } );
+    bits_t types[ EV_CNT / bits_per_item + 1 ] = { 0 };
+    if ( ioctl( file.fd(), EVIOCGBIT( 0, sizeof( types ) ), types ) < 0 ) {
+        int error = errno;
+        ERR( "Can't query event types of " << q( path ) << ": " << posix::syserrmsg( error ) );
+    };
+    if ( not test_bit( types, EV_KEY ) ) {
+        DBG( "Device " << q( path ) << " does not report keys, skipped." );
+        return;
+    };
+    char name[ 256 ] = { 0 };
+    if ( ioctl( file.fd(), EVIOCGNAME( sizeof( name ) - 1 ), name ) < 0 ) {
+        int error = errno;
+        WRN( "Can't query name of " << q( path ) << ": " << posix::syserrmsg( error ) );
+    };
+    device->index = _registry->add( name );
+    if ( _registry->policy( device->index ) == listener_t::device_policy_t::ignore ) {
+        DBG( "Device " << q( path ) << " is ignored, skipped." );
+        _registry->remove( device->index );
+        return;
+    };
+    #ifdef EVIOCSMASK
+        /*
+            Mask for `EV_SYN` type is actually a mask of event types. Let the kernel deliver key
+            events only. Empty `SYN_REPORT`s are not delivered, so pointer motions do not wake us
+            up.
+        */
+        bits_t mask[ EV_CNT / bits_per_item + 1 ] = { 0 };
+        set_bit( mask, EV_KEY );
+        input_mask imask {
+            .type       = EV_SYN,
+            .codes_size = sizeof( mask ),
+            .codes_ptr  = reinterpret_cast< uintptr_t >( mask ),
+        };
+        if ( ioctl( file.fd(), EVIOCSMASK, & imask ) < 0 ) {
+            int error = errno;
+            INF(
+                "Can't set event mask for " << q( path ) << ": " << posix::syserrmsg( error )
+                    << "; all events will be delivered."
+            );
+        };
+    #endif // EVIOCSMASK
+    #ifdef EVIOCSCLOCKID
+        /*
+            Kernel stamps events with the real-time clock by default. Let it use the monotonic
+            clock, like libinput does, so event times can be compared with the monotonic time.
+        */
+        int clock = CLOCK_MONOTONIC;
+        if ( ioctl( file.fd(), EVIOCSCLOCKID, & clock ) < 0 ) {
+            int error = errno;
+            INF(
+                "Can't set clock for " << q( path ) << ": " << posix::syserrmsg( error )
+                    << "; event latency will not be measured."
+            );
+        };
+    #endif // EVIOCSCLOCKID
+    try {
+        _watch( file.fd(), device.get() );
+    } catch ( ... ) {
+        _registry->remove( device->index );
+        throw;
+    };
+    DBG( "Device " << q( path ) << " added." );
+    _devices[ path ] = std::move( device );
+}; // _add
+
+/**
+    Schedules the device for removing. The device is not closed immediately, since the pending
+    epoll events may refer it, but its path is released, so a new device with the same path can be
+    added.
+**/
+void
+context_t::_remove(
+    device_t & device
+) {
+    auto const it = _devices.find( device.path );
+    if ( it != _devices.end() and it->second.get() == & device ) {
+        _removed.push_back( std::move( it->second ) );
+        _devices.erase( it );
+    };
+}; // _remove
+
+/**
+    Closes the devices scheduled for removing. Releases of keys held on a device and the device
+    removal are reported to the handler.
+**/
+void
+context_t::_purge(
+) {
+    stamp_t const now = latency_t::now();
+    for ( auto & device: _removed ) {
+        _release( * device, now );
+        _batch.remove( * _registry, device->index, now );
+        DBG( "Device " << q( device->path ) << " removed." );
+    };
+    _removed.clear();
+}; // _purge
+
+/** Reports releases of all the keys held on the device. **/
+void
+context_t::_release(
+    device_t &  device,
+    stamp_t     time
+) {
+    for ( size_t code = 0; device.held.any() and code < KEY_CNT; ++ code ) {
+        if ( device.held[ code ] ) {
+            DBG( "Key " << code << " of " << q( device.path ) << " released." );
+            _batch.push( {
+                .time   = time,
+                .key    = key_t( code ),
+                .state  = key_state_t::released,
+                .device = device.index,
+            } );
+            device.held.reset( code );
+        };
+    };
+}; // _release
+
+/**
+    Brings the key state in sync with the kernel after dropped events: queries keys which are down
+    now, and reports releases of held keys which are not down any more. Keys pressed during the
+    overflow are not reported: a made up press could make a false tap.
+**/
+void
+context_t::_resync(
+    device_t &  device,
+    stamp_t     time
+) {
+    bits_t down[ KEY_CNT / bits_per_item + 1 ] = { 0 };
+    if ( ioctl( device.file.fd(), EVIOCGKEY( sizeof( down ) ), down ) < 0 ) {
+        int error = errno;
+        WRN( "Can't query keys of " << q( device.path ) << ": " << posix::syserrmsg( error ) );
+        _release( device, time );
+        return;
+    };
+    for ( size_t code = 0; device.held.any() and code < KEY_CNT; ++ code ) {
+        if ( device.held[ code ] and not test_bit( down, uint_t( code ) ) ) {
+            DBG( "Key " << code << " of " << q( device.path ) << " released while dropped." );
+            _batch.push( {
+                .time   = time,
+                .key    = key_t( code ),
+                .state  = key_state_t::released,
+                .device = device.index,
+            } );
+            device.held.reset( code );
+        };
+    };
+}; // _resync
+
+/**
+    Reads all the available events from the device.
+**/
+void
+context_t::_read(
+    device_t & device
+) {
+    for ( ; ; ) {
+        auto size = ::read( device.file.fd(), _buffer, sizeof( _buffer ) );
+        if ( size < 0 ) {
+            int error = errno;
+            if ( error == EAGAIN or error == EINTR ) {
+                break;
+            };
+            if ( error != ENODEV ) {
+                WRN( "Failed to read " << q( device.path ) << ": " << posix::syserrmsg( error ) );
+            };
+            _remove( device );
+            break;
+        };
+        auto count = size_t( size ) / sizeof( _buffer[ 0 ] );
+        for ( size_t i = 0; i < count; ++ i ) {
+            auto const & event = _buffer[ i ];
+            switch ( event.type ) {
+                case EV_SYN: {
+                    if ( event.code == SYN_DROPPED ) {
+                        /*
+                            Kernel buffer overflowed. Events up to and including the next
+                            `SYN_REPORT` are incomplete, ignore them, then query the key state.
+                        */
+                        DBG( "Events dropped by " << q( device.path ) << "." );
+                        device.dropped = true;
+                    } else if ( event.code == SYN_REPORT and device.dropped ) {
+                        device.dropped = false;
+                        _resync(
+                            device,
+                            stamp_t( event.input_event_sec ) * 1000000 + event.input_event_usec
+                        );
+                    };
+                } break;
+                case EV_KEY: {
+                    /*
+                        Value 0 means key release, 1 — key press, 2 — autorepeat. Autorepeat is
+                        reported as one more press, `tapper_t` knows the key is already pressed
+                        and will not consider it a tap.
+                    */
+                    if ( not device.dropped and event.code < KEY_CNT ) {
+                        device.held[ event.code ] = event.value != 0;
+                        _batch.push( {
+                            .time   = stamp_t(
+                                stamp_t( event.input_event_sec ) * 1000000
+                                    + event.input_event_usec
+                            ),
+                            .key    = key_t( event.code ),
+                            .state  = event.value ? key_state_t::pressed : key_state_t::released,
+                            .device = device.index,
+                        } );
+                    };
+                } break;
+                default: {
+                    // Kernel does not support `EVIOCSMASK`, ignore unwanted events.
+                } break;
+            };
+        };
+        if ( count < buffer_size ) {
+            break;      // Nothing more to read now.
+        };
+    };
+}; // _read
+
+/**
+    Handles an udev event: adds a new device or removes an unplugged one.
+**/
+void
+context_t::_on_udev(
+) {
+    auto device = udev_monitor_receive_device( _monitor );
+    if ( not device ) {
+        return;
+    };
+    auto action = udev_device_get_action( device );
+    auto path   = evdev_node( device, _seat );
+    if ( action and not path.empty() ) {
+        if ( string_t( action ) == "add" ) {
+            CATCH_ALL( _add( path ) );
+        } else if ( string_t( action ) == "remove" ) {
+            auto const it = _devices.find( path );
+            if ( it != _devices.end() ) {
+                _remove( * it->second );
+            };
+        };
+    };
+    udev_device_unref( device );
+}; // _on_udev
+
+/**
+    Reads events of all the ready devices and the udev monitor. Called by the reactor when the
+    epoll fd is ready for reading, so `epoll_wait` does not wait. Key events of all the devices are
+    delivered to the handler by one batch.
+**/
+void
+context_t::_dispatch(
+) {
+    int const   size = 16;
+    epoll_event events[ size ];
+    int count = epoll_wait( _epoll, events, size, 0 );
+    if ( count < 0 ) {
+        int error = errno;
+        if ( error == EINTR ) {
+            return;
+        };
+        ERR( "Failed to wait for input events: " << posix::syserrmsg( error ) << "." );
+    };
+    for ( int i = 0; i < count; ++ i ) {
+        auto device = reinterpret_cast< device_t * >( events[ i ].data.ptr );
+        if ( device ) {
+            _read( * device );
+        } else {
+            _on_udev();
+        };
+    };
+    _batch.flush();
+    _purge();
+}; // _dispatch
+
+}; // namespace evdev
+}; // namespace tapper
+
+// end of file //
@@ -0,0 +1,165 @@
+/*
+    ---------------------------------------------------------------------- copyright and license ---
+
+    File: src/evdev.hpp
+
+    Copyright 🄯 2014, 2016—2017, 2019—2023 Van de Bugger.
+
+    This file is part of Tapper.
+
+    Tapper is free software: you can redistribute it and/or modify it under the terms of the GNU
+    General Public License as published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    Tapper is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+    even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along with Tapper.  If not,
+    see <https://www.gnu.org/licenses/>.
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+
+    ---------------------------------------------------------------------- copyright and license ---
+*/
+
+/** @file
+    evdev wrappers interface.
+
+    @sa evdev.cpp
+**/
+
+#ifndef _TAPPER_EVDEV_HPP_
+#define _TAPPER_EVDEV_HPP_
+
+#include "base.hpp"
+
+#include <bitset>
+#include <map>
+#include <vector>
+
+#include <linux/input.h>
+
+#include "listener.hpp"
+#include "posix.hpp"
+#include "types.hpp"
+
+struct udev;
+struct udev_monitor;
+
+namespace tapper {
+/// evdev wrappers.
+namespace evdev {
+
+    // ---------------------------------------------------------------------------------------------
+    // error_t
+    // ---------------------------------------------------------------------------------------------
+
+    class error_t: public std::runtime_error {
+        public:
+            using std::runtime_error::runtime_error;
+    }; // class error_t
+
+    // ---------------------------------------------------------------------------------------------
+    // context_t
+    // ---------------------------------------------------------------------------------------------
+
+    /**
+        Reads key events directly from `/dev/input/event*` devices of the given seat.
+
+        Only devices which report key events are opened. If the kernel supports `EVIOCSMASK`, the
+        context asks the kernel to deliver `EV_KEY` events only, so pointer motions, touchpad and
+        tablet events do not even wake the reactor. All the devices and the udev monitor are
+        collected in an `epoll` set, and the epoll fd is watched by the reactor, so events are read
+        in bulk by the reactor thread. Devices are added and removed on the fly, as udev reports
+        them.
+
+        Key events are converted to `listener_t::event_t`, collected in a batch, and delivered by
+        the reactor thread directly to the listener's event handler after all the ready devices
+        are read, so a burst of input events costs only one indirect call on its way to the
+        tapper.
+
+        Every opened device is registered in the listener's devices table by the device name, and
+        its events are marked with the device index. Ignored devices are not opened at all.
+
+        Keys held on every device are tracked, so no key stays pressed forever: if the kernel
+        drops events, the key state is queried and releases lost in the overflow are reported;
+        when a device is removed, releases of its held keys are reported before the removal.
+    **/
+    class context_t: public object_t {
+
+        public:
+
+            using on_events_t = listener_t::on_events_t;
+            using batch_t     = listener_t::batch_t;
+            using registry_t  = listener_t::devices_t;
+
+        public:
+
+            explicit context_t( string_t const & seat );
+            ~context_t();
+            void enable( on_events_t on_events, registry_t & registry );
+            void disable();
+
+        private:
+
+            enum class state_t {
+                inited,
+                enabled,
+                disabled
+            }; // enum state_t
+
+            using index_t = listener_t::device_t;
+
+            /** Opened input device. **/
+            struct device_t {
+                string_t        path;
+                posix::file_t   file;
+                bool            dropped { false };  ///< Events dropped, wait for `SYN_REPORT`.
+                index_t         index { 0 };        ///< Index in the listener's devices table.
+                std::bitset< KEY_CNT > held;        ///< Keys reported pressed and not released.
+            }; // struct device_t
+
+            using device_p  = ptr_t< device_t >;
+            using devices_t = std::map< string_t, device_p >;
+            using removed_t = std::vector< device_p >;
+
+            /**
+                Max number of events read by one `read` call. Keyboards rarely report more than 3
+                events (`EV_MSC`, `EV_KEY`, `EV_SYN`) at once, so it is more than enough.
+            **/
+            static size_t constexpr buffer_size = 64;
+
+        private:
+
+            void _watch( int fd, void * ptr );
+            void _add( string_t const & path );
+            void _remove( device_t & device );
+            void _purge();
+            void _release( device_t & device, stamp_t time );
+            void _resync( device_t & device, stamp_t time );
+            void _read( device_t & device );
+            void _on_udev();
+            void _dispatch();
+
+        private:
+
+            batch_t         _batch;
+            string_t        _seat;
+            state_t         _state { state_t::inited };
+            ::udev *        _udev { nullptr };
+            udev_monitor *  _monitor { nullptr };
+            int             _epoll { -1 };
+            devices_t       _devices;
+            registry_t *    _registry { nullptr };
+            removed_t       _removed;       ///< Devices to close after processing current events.
+            input_event     _buffer[ buffer_size ];
+
+    }; // class context_t
+
+}; // namespace evdev
+}; // namespace tapper
+
+#endif // _TAPPER_EVDEV_HPP_
+
+// end of file //
@@ -0,0 +1,274 @@
+/*
+    ---------------------------------------------------------------------- copyright and license ---
+
+    File: src/executor.cpp
+
+    Copyright 🄯 2014, 2016—2017, 2019—2023 Van de Bugger.
+
+    This file is part of Tapper.
+
+    Tapper is free software: you can redistribute it and/or modify it under the terms of the GNU
+    General Public License as published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    Tapper is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+    even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along with Tapper.  If not,
+    see <https://www.gnu.org/licenses/>.
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+
+    ---------------------------------------------------------------------- copyright and license ---
+*/
+
+/** @file
+    `executor_t` class implementation.
+**/
+
+#include "executor.hpp"
+
+#include <atomic>
+#include <functional>
+
+#include "flight.hpp"
+#include "metrics.hpp"
+#include "posix.hpp"
+#include "test.hpp"
+
+namespace tapper {
+
+// -------------------------------------------------------------------------------------------------
+// queue_t
+// -------------------------------------------------------------------------------------------------
+
+TEST(
+    t::queue_t< uint_t, 4 > queue;
+    uint_t value = 0;
+    ASSERT( queue.empty() );
+    ASSERT( not queue.pop( value ) );
+    ASSERT( queue.push( 1 ) );
+    ASSERT( queue.push( 2 ) );
+    ASSERT( queue.push( 3 ) );
+    ASSERT( queue.push( 4 ) );
+    ASSERT( not queue.push( 5 ) );          // The queue is full.
+    ASSERT( queue.pop( value ) );
+    ASSERT_EQ( value, 1U );
+    ASSERT( queue.push( 5 ) );              // The queue wraps around.
+    ASSERT( queue.pop( value ) );
+    ASSERT_EQ( value, 2U );
+    ASSERT( queue.pop( value ) );
+    ASSERT_EQ( value, 3U );
+    ASSERT( queue.pop( value ) );
+    ASSERT_EQ( value, 4U );
+    ASSERT( queue.pop( value ) );
+    ASSERT_EQ( value, 5U );
+    ASSERT( not queue.pop( value ) );
+    ASSERT( queue.empty() );
+);
+
+// -------------------------------------------------------------------------------------------------
+// executor_t::worker_t
+// -------------------------------------------------------------------------------------------------
+
+/**
+    Worker thread. It sleeps until woken up, then calls the drain function, which should process
+    all the items in the corresponding queue.
+**/
+class executor_t::worker_t: public posix::thread_t {
+    public:
+        using myself_t = worker_t;
+        using parent_t = posix::thread_t;
+        using drain_t  = std::function< void() >;
+        explicit worker_t( string_t const & name, drain_t const & drain ):
+            parent_t( name ),
+            _drain( drain )
+        {
+        };
+        /** Wakes up the worker. Does not block, so can be called from the listener thread. **/
+        void wake() {
+            _semaphore.post();
+        };
+        void join() {
+            _done = true;
+            _semaphore.post();
+            parent_t::join();
+        };
+    protected:
+        virtual void body() override {
+            for ( ; ; ) {
+                _semaphore.wait();
+                if ( _done ) {
+                    break;
+                };
+                _drain();
+            };
+        };
+    private:
+        drain_t                 _drain;
+        posix::semaphore_t      _semaphore;
+        std::atomic< bool >     _done { false };
+};
+
+// -------------------------------------------------------------------------------------------------
+// executor_t
+// -------------------------------------------------------------------------------------------------
+
+executor_t::executor_t(
+    layouter_t &    layouter,
+    emitter_t &     emitter
+):
+    OBJECT_T(),
+    _layouter( layouter ),
+    _emitter( emitter ),
+    _layouter_worker( new worker_t( "layouter", [ this ] () { _activate_layouts(); } ) ),
+    _emitter_worker( new worker_t( "emitter", [ this ] () { _emit_keys(); } ) ),
+    _events( {
+        { key_t(), key_state_t::pressed  },
+        { key_t(), key_state_t::released },
+    } )
+{
+}; // ctor
+
+executor_t::~executor_t(
+) {
+    CATCH_ALL( stop() );
+}; // dtor
+
+void
+executor_t::start(
+) {
+    TRACE();
+    _layouter.set_on_activated(
+        layouter_t::on_activated_t::make< executor_t, & executor_t::_on_activated >( this )
+    );
+    _layouter_worker->start();
+    _emitter_worker->start();
+}; // start
+
+void
+executor_t::execute(
+    program_t const & program,
+    stamp_t           event
+) {
+    TRACE();
+    stamp_t const scheduled = latency_t::now();
+    if ( program.layout.index != 0 ) {
+        DBG( "Scheduling layout " << program.layout << " activation…" );
+        if ( _layouts.push( { program.layout, event, scheduled } ) ) {
+            _layouter_worker->wake();
+        } else {
+            _drop();
+        };
+    };
+    bool keys = false;
+    for ( uint_t i = 0; i < program.size; ++ i ) {
+        DBG( "Scheduling key " << program.keys[ i ] << " tap…" );
+        if ( _keys.push( { program.keys[ i ], event, scheduled } ) ) {
+            keys = true;
+        } else {
+            _drop();
+        };
+    };
+    if ( keys ) {
+        _emitter_worker->wake();
+    };
+}; // execute
+
+void
+executor_t::stop(
+) {
+    TRACE();
+    _layouter_worker->join();
+    _emitter_worker->join();
+    _layouter.set_on_activated( nullptr );
+    if ( _dropped > 1 ) {
+        WRN( "Total " << _dropped << " actions dropped." );
+    };
+    _dropped = 0;
+}; // stop
+
+/**
+    Counts a dropped action. Only the first drop is reported immediately: drops happen when actions
+    come faster than they are executed, reporting every drop would make things even worse.
+**/
+void
+executor_t::_drop(
+) {
+    metrics().dropped();
+    stamp_t const now = latency_t::now();
+    flight().record( flight_t::kind_t::drop, now, now );
+    if ( _dropped ++ == 0 ) {
+        WRN( "Too many pending actions, action dropped. Further drops will not be reported." );
+    };
+}; // _drop
+
+/**
+    Drains the layouts queue and activates the last layout only. The activation is recorded by
+    `_on_activated()`.
+**/
+void
+executor_t::_activate_layouts(
+) {
+    TRACE();
+    job_t< layout_t > job { layout_t(), 0, 0 };
+    uint_t            count = 0;
+    for ( job_t< layout_t > next; _layouts.pop( next ); ++ count ) {
+        job = next;
+    };
+    if ( count > 1 ) {
+        DBG( "Coalesced " << count << " layout activations." );
+    };
+    if ( count > 0 ) {
+        stamp_t const started = latency_t::now();
+        latency().record( latency_t::stage_t::queue, job.scheduled, started );
+        CATCH_ALL( _layouter.activate( job.value, { job.event, started } ) );
+    };
+}; // _activate_layouts
+
+/**
+    Records a completed layout activation. Called by the layouter: from the layouter worker if the
+    layouter is synchronous, or from the thread receiving replies if it is not.
+**/
+void
+executor_t::_on_activated(
+    layout_t                layout,
+    layouter_t::ticket_t    ticket,
+    bool                    failed
+) {
+    metrics().action( action_t::type_t::activate_layout, failed );
+    stamp_t const finished = latency_t::now();
+    auto & stats = latency();
+    stats.record( latency_t::stage_t::layouter, ticket.started, finished );
+    flight().record( flight_t::kind_t::layout, ticket.started, finished, layout.index, failed );
+    stats.record( latency_t::stage_t::total, ticket.event, finished );
+}; // _on_activated
+
+/**
+    Drains the keys queue and emits a tap for every key in order.
+**/
+void
+executor_t::_emit_keys(
+) {
+    TRACE();
+    auto & stats = latency();
+    for ( job_t< key_t > job; _keys.pop( job ); ) {
+        stamp_t const started = latency_t::now();
+        stats.record( latency_t::stage_t::queue, job.scheduled, started );
+        _events[ 0 ].key = job.value;
+        _events[ 1 ].key = job.value;
+        auto const what = CATCH_ALL( _emitter.emit( _events ) );
+        metrics().action( action_t::type_t::emit_key_tap, not what.empty() );
+        stamp_t const finished = latency_t::now();
+        stats.record( latency_t::stage_t::emitter, started, finished );
+        flight().record(
+            flight_t::kind_t::emit, started, finished, job.value.code(), not what.empty()
+        );
+        stats.record( latency_t::stage_t::total, job.event, finished );
+    };
+}; // _emit_keys
+
+}; // namespace tapper
+
+// end of file //
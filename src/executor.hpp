@@ -0,0 +1,168 @@
+/*
+    ---------------------------------------------------------------------- copyright and license ---
+
+    File: src/executor.hpp
+
+    Copyright 🄯 2014, 2016—2017, 2019—2023 Van de Bugger.
+
+    This file is part of Tapper.
+
+    Tapper is free software: you can redistribute it and/or modify it under the terms of the GNU
+    General Public License as published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    Tapper is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+    even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along with Tapper.  If not,
+    see <https://www.gnu.org/licenses/>.
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+
+    ---------------------------------------------------------------------- copyright and license ---
+*/
+
+/** @file
+    `executor_t` class interface.
+
+    @sa executor.cpp
+**/
+
+#ifndef _TAPPER_EXECUTOR_HPP_
+#define _TAPPER_EXECUTOR_HPP_
+
+#include "base.hpp"
+
+#include "emitter.hpp"
+#include "latency.hpp"
+#include "layouter.hpp"
+#include "queue.hpp"
+#include "types.hpp"
+
+namespace tapper {
+
+// -------------------------------------------------------------------------------------------------
+// executor_t
+// -------------------------------------------------------------------------------------------------
+
+/**
+    A component that executes actions on behalf of the tapper, so the listener thread never waits
+    for a layouter or an emitter.
+
+    Layout activations and key taps go to separate lock-free queues, each queue is drained by its
+    own worker thread. Thus, layout activation and keystroke emulation (requested by the same
+    assignment) run concurrently. Keystrokes are emitted in order, while layout activations are
+    coalesced: if the layouter is busy (e. g. GNOME Shell responds slowly) and few activations are
+    queued, only the last one is performed, since the earlier ones would be overridden anyway.
+
+    Every queued action carries time stamps of the input event and of scheduling, so the executor
+    feeds queue, backend and total stages of `latency()` statistics. Layout activation may be
+    asynchronous, so the layouter stage, the total stage and the outcome of an activation are
+    recorded when the layouter reports completion, not when the request is sent.
+
+    Usage:
+
+    @code
+    executor_t executor( layouter, emitter );
+    // Layouter and emitter should be started before the executor.
+    executor.start();
+    ...
+    executor.execute( actions );    // Called from the listener thread.
+    ...
+    executor.stop();
+    @endcode
+**/
+class executor_t: public object_t {
+
+    public:         // types
+
+        /**
+            Actions compiled for execution, so executing a program does not require examining
+            actions. The executor coalesces layout activations anyway, so a program activates at
+            most one layout: the last one. Keys to emit are not owned by the program, they are
+            stored in an array owned by the program creator.
+        **/
+        struct program_t {
+            layout_t        layout;             ///< Layout to activate, `layout_t()` if none.
+            uint_t          size { 0 };         ///< Number of keys to emit.
+            key_t const *   keys { nullptr };   ///< Keys to emit.
+        };
+
+    public:         // methods
+
+        explicit executor_t(
+            layouter_t &    layouter,
+            emitter_t &     emitter
+        );
+
+        ~executor_t();
+
+        /** Starts worker threads. **/
+        void start();
+
+        /**
+            Schedules the program for execution and returns immediately. Must be called by a single
+            thread (the listener thread). `event` is time stamp of the input event which caused the
+            program execution (0 if unknown).
+        **/
+        void execute( program_t const & program, stamp_t event = 0 );
+
+        /**
+            Stops worker threads. Actions which are still in the queues are discarded. Layout
+            activations still in flight complete, but are not recorded any more.
+        **/
+        void stop();
+
+    private:        // types
+
+        class worker_t;
+        using worker_p = ptr_t< worker_t >;
+
+        /**
+            Queue length. It is much more than a human can tap while a layouter is performing one
+            activation.
+        **/
+        static size_t constexpr queue_size = 64;
+
+        /** Queued action: a layout or a key accompanied with time stamps. **/
+        template< typename value_t >
+        struct job_t {
+            value_t value;
+            stamp_t event;      ///< Time stamp of the input event.
+            stamp_t scheduled;  ///< Time stamp of scheduling.
+        };
+
+        using layouts_queue_t = t::queue_t< job_t< layout_t >, queue_size >;
+        using keys_queue_t    = t::queue_t< job_t< key_t >,    queue_size >;
+
+    private:        // methods
+
+        void _activate_layouts();
+        void _on_activated( layout_t layout, layouter_t::ticket_t ticket, bool failed );
+        void _emit_keys();
+        void _drop();
+
+    private:        // data
+
+        layouter_t &        _layouter;
+        emitter_t &         _emitter;
+        layouts_queue_t     _layouts;
+        keys_queue_t        _keys;
+        worker_p            _layouter_worker;
+        worker_p            _emitter_worker;
+        uint_t              _dropped { 0 };     ///< Number of dropped actions.
+
+        /**
+            Events to emit a key tap. Allocated once, only keys are updated, so emitting does not
+            allocate memory.
+        **/
+        emitter_t::events_t _events;
+
+}; // class executor_t
+
+}; // namespace tapper
+
+#endif // _TAPPER_EXECUTOR_HPP_
+
+// end of file //
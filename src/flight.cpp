@@ -0,0 +1,360 @@
+/*
+    ---------------------------------------------------------------------- copyright and license ---
+
+    File: src/flight.cpp
+
+    Copyright 🄯 2014, 2016—2017, 2019—2023 Van de Bugger.
+
+    This file is part of Tapper.
+
+    Tapper is free software: you can redistribute it and/or modify it under the terms of the GNU
+    General Public License as published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    Tapper is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+    even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along with Tapper.  If not,
+    see <https://www.gnu.org/licenses/>.
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+
+    ---------------------------------------------------------------------- copyright and license ---
+*/
+
+/** @file
+    `flight_t` class implementation.
+**/
+
+#include "flight.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "posix.hpp"
+#include "test.hpp"
+
+namespace tapper {
+
+// -------------------------------------------------------------------------------------------------
+// flight_t
+// -------------------------------------------------------------------------------------------------
+
+size_t constexpr flight_t::capacity;
+
+flight_t &
+flight(
+) {
+    static flight_t flight;
+    return flight;
+};
+
+flight_t::flight_t(
+) {
+    _next.store( 0, std::memory_order_relaxed );
+    for ( auto & slot: _slots ) {
+        slot.seq.store( 0, std::memory_order_relaxed );
+    };
+}; // ctor
+
+flight_t::~flight_t(
+) {
+    CATCH_ALL( wait() );
+}; // dtor
+
+void
+flight_t::record(
+    kind_t          kind,
+    stamp_t         start,
+    stamp_t         finish,
+    std::uint16_t   arg,
+    std::uint8_t    value
+) {
+    static thread_local std::uint32_t tid = 0;
+    if ( not tid ) {
+        tid = std::uint32_t( posix::get_tid() );
+    };
+    auto const number = _next.fetch_add( 1, std::memory_order_relaxed );
+    auto & slot = _slots[ number % capacity ];
+    slot.seq.store( 2 * number + 1, std::memory_order_relaxed );
+    std::atomic_thread_fence( std::memory_order_release );
+    slot.time.store( start, std::memory_order_relaxed );
+    slot.duration.store( finish > start ? finish - start : 0, std::memory_order_relaxed );
+    slot.info.store(
+        std::uint64_t( kind ) | std::uint64_t( value ) << 8 | std::uint64_t( arg ) << 16
+            | std::uint64_t( tid ) << 32,
+        std::memory_order_relaxed
+    );
+    slot.seq.store( 2 * number + 2, std::memory_order_release );
+}; // record
+
+flight_t::records_t
+flight_t::records(
+) const {
+    records_t records;
+    auto const next  = _next.load( std::memory_order_acquire );
+    auto const first = next > capacity ? next - capacity : 0;
+    records.reserve( size_t( next - first ) );
+    for ( auto number = first; number < next; ++ number ) {
+        auto const & slot = _slots[ number % capacity ];
+        auto const   seq  = slot.seq.load( std::memory_order_acquire );
+        if ( seq != 2 * number + 2 ) {
+            continue;       // Being written, or already overwritten by a newer record.
+        };
+        record_t record;
+        record.time     = slot.time.load( std::memory_order_relaxed );
+        record.duration = slot.duration.load( std::memory_order_relaxed );
+        auto const info = slot.info.load( std::memory_order_relaxed );
+        std::atomic_thread_fence( std::memory_order_acquire );
+        if ( slot.seq.load( std::memory_order_relaxed ) != seq ) {
+            continue;       // Overwritten while being read.
+        };
+        record.kind  = kind_t( info & 0xFF );
+        record.value = std::uint8_t( info >> 8 );
+        record.arg   = std::uint16_t( info >> 16 );
+        record.tid   = std::uint32_t( info >> 32 );
+        records.push_back( record );
+    };
+    return records;
+}; // records
+
+/** Returns `args` object of a trace event. **/
+static
+string_t
+args(
+    flight_t::record_t const & record
+) {
+    using kind_t = flight_t::kind_t;
+    auto const failed = string_t( "\"failed\":" ) + ( record.value ? "true" : "false" );
+    switch ( record.kind ) {
+        case kind_t::event: {
+            return STR(
+                "\"key\":" << uint_t( record.arg ) << ",\"state\":"
+                    << ( key_state_t( record.value ) == key_state_t::pressed ?
+                        "\"pressed\"" : "\"released\"" )
+            );
+        };
+        case kind_t::tap:
+        case kind_t::chord: {
+            return STR(
+                "\"key\":" << uint_t( record.arg ) << ",\"active\":"
+                    << ( record.value ? "true" : "false" )
+            );
+        };
+        case kind_t::skip: {
+            return STR(
+                "\"key\":" << uint_t( record.arg ) << ",\"reason\":"
+                    << ( flight_t::skip_t( record.value ) == flight_t::skip_t::chord ?
+                        "\"chord\"" : "\"held\"" )
+            );
+        };
+        case kind_t::drop: {
+            return "";
+        };
+        case kind_t::layout: {
+            return STR( "\"layout\":" << uint_t( record.arg ) << "," << failed );
+        };
+        case kind_t::emit: {
+            return STR( "\"key\":" << uint_t( record.arg ) << "," << failed );
+        };
+        case kind_t::dbus: {
+            return failed;
+        };
+    };
+    return "";
+};
+
+/**
+    Returns records in Chrome trace event format (JSON). Spans are "complete" events (phase `X`),
+    instant records are thread-scoped instant events (phase `i`). Time is in microseconds, as the
+    format requires.
+**/
+static
+string_t
+json(
+    flight_t::records_t const & records
+) {
+    using kind_t = flight_t::kind_t;
+    auto const pid = ::getpid();
+    string_t json = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    for ( auto const & record: records ) {
+        bool const span =
+            record.kind != kind_t::tap and record.kind != kind_t::chord
+                and record.kind != kind_t::skip and record.kind != kind_t::drop;
+        json += STR(
+            ( first ? "\n" : ",\n" )
+                << "{\"name\":\"" << record.kind << "\",\"cat\":\"tapper\""
+                << ",\"ph\":\"" << ( span ? "X" : "i" ) << "\""
+                << ",\"ts\":" << record.time
+                << ( span ? STR( ",\"dur\":" << record.duration ) : string_t( ",\"s\":\"t\"" ) )
+                << ",\"pid\":" << pid << ",\"tid\":" << record.tid
+                << ",\"args\":{" << args( record ) << "}}"
+        );
+        first = false;
+    };
+    json += "\n]}\n";
+    return json;
+}; // json
+
+/** Writes the text to the file. **/
+static
+void
+write(
+    string_t const & path,
+    string_t const & text
+) {
+    posix::file_t file;
+    file.open( path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600 );
+    file.write( text.data(), text.size() );
+    file.close();
+}; // write
+
+string_t
+flight_t::json(
+) const {
+    return tapper::json( records() );
+}; // json
+
+void
+flight_t::dump(
+    string_t const & path
+) const {
+    write( path, json() );
+}; // dump
+
+// -------------------------------------------------------------------------------------------------
+// flight_t::dumper_t
+// -------------------------------------------------------------------------------------------------
+
+/** Background thread which formats and writes records taken by `dump()`. **/
+class flight_t::dumper_t: public posix::thread_t {
+
+    public:
+
+        dumper_t( records_t && records, string_t const & path, on_dumped_t on_dumped ):
+            posix::thread_t( "dumper" ),
+            _records( std::move( records ) ),
+            _path( path ),
+            _on_dumped( on_dumped )
+        {
+        };
+
+        /** `true` when the dump is completed and the thread can be joined without waiting. **/
+        std::atomic< bool > done { false };
+
+    protected:
+
+        virtual void body() override {
+            // Writing a file must not compete with the real-time threads.
+            CATCH_ALL( posix::reset_sched() );
+            auto const error = CATCH_ALL( write( _path, tapper::json( _records ) ) );
+            if ( _on_dumped ) {
+                _on_dumped( _path, error );
+            };
+            done = true;
+        };
+
+    private:
+
+        records_t   _records;
+        string_t    _path;
+        on_dumped_t _on_dumped;
+
+}; // class flight_t::dumper_t
+
+void
+flight_t::dump(
+    string_t const & path,
+    on_dumped_t      on_dumped
+) {
+    if ( _dumper ) {
+        if ( not _dumper->done ) {
+            ERR( "Previous dump of the flight recorder is not yet completed." );
+        };
+        wait();
+    };
+    /*
+        Taking the records is the only work done by the caller: it is a copy of the ring, bounded
+        by the capacity.
+    */
+    _dumper.reset( new dumper_t( records(), path, on_dumped ) );
+    _dumper->start();
+}; // dump
+
+void
+flight_t::wait(
+) {
+    if ( _dumper ) {
+        _dumper->join();
+        _dumper.reset();
+    };
+}; // wait
+
+TEST(
+    using kind_t = flight_t::kind_t;
+    flight_t flight;
+    ASSERT( flight.records().empty() );
+    flight.record( kind_t::event, 100, 130, 29, std::uint8_t( key_state_t::pressed ) );
+    flight.record( kind_t::tap, 200, 200, 29, 1 );
+    auto records = flight.records();
+    ASSERT_EQ( records.size(), 2U );
+    ASSERT( records[ 0 ].kind == kind_t::event );
+    ASSERT_EQ( records[ 0 ].time, 100U );
+    ASSERT_EQ( records[ 0 ].duration, 30U );
+    ASSERT_EQ( uint_t( records[ 0 ].arg ), 29U );
+    ASSERT_EQ( records[ 0 ].tid, std::uint32_t( posix::get_tid() ) );
+    ASSERT( records[ 1 ].kind == kind_t::tap );
+    auto const json = flight.json();
+    ASSERT(
+        json.find( "\"name\":\"event\",\"cat\":\"tapper\",\"ph\":\"X\",\"ts\":100,\"dur\":30," )
+            != string_t::npos
+    );
+    ASSERT( json.find( "\"args\":{\"key\":29,\"active\":true}" ) != string_t::npos );
+    // The ring keeps the newest records only.
+    for ( stamp_t i = 0; i < flight_t::capacity; ++ i ) {
+        flight.record( kind_t::drop, 1000 + i, 1000 + i );
+    };
+    records = flight.records();
+    ASSERT_EQ( records.size(), flight_t::capacity );
+    ASSERT( records.front().kind == kind_t::drop );
+    ASSERT_EQ( records.front().time, 1000U );
+    ASSERT_EQ( records.back().time, 1000U + flight_t::capacity - 1 );
+);
+
+TEST(
+    struct dumped_t {
+        string_t path, error { "none" };
+        void on_dumped( string_t const & p, string_t const & e ) { path = p; error = e; };
+    } dumped;
+    flight_t flight;
+    flight.record( flight_t::kind_t::tap, 200, 200, 29, 1 );
+    flight.dump(
+        "/dev/null", flight_t::on_dumped_t::make< dumped_t, & dumped_t::on_dumped >( & dumped )
+    );
+    flight.wait();
+    ASSERT_EQ( dumped.path, "/dev/null" );
+    ASSERT_EQ( dumped.error, "" );
+);
+
+string_t
+str(
+    flight_t::kind_t kind
+) {
+    switch ( kind ) {
+        case flight_t::kind_t::event:  return "event";
+        case flight_t::kind_t::tap:    return "tap";
+        case flight_t::kind_t::chord:  return "chord";
+        case flight_t::kind_t::skip:   return "skip";
+        case flight_t::kind_t::drop:   return "drop";
+        case flight_t::kind_t::layout: return "layout";
+        case flight_t::kind_t::emit:   return "emit";
+        case flight_t::kind_t::dbus:   return "dbus";
+    };
+    return "(* unknown record kind #" + str( int( kind ) ) + " *)";
+};
+
+}; // namespace tapper
+
+// end of file //
@@ -0,0 +1,189 @@
+/*
+    ---------------------------------------------------------------------- copyright and license ---
+
+    File: src/flight.hpp
+
+    Copyright 🄯 2014, 2016—2017, 2019—2023 Van de Bugger.
+
+    This file is part of Tapper.
+
+    Tapper is free software: you can redistribute it and/or modify it under the terms of the GNU
+    General Public License as published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    Tapper is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+    even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along with Tapper.  If not,
+    see <https://www.gnu.org/licenses/>.
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+
+    ---------------------------------------------------------------------- copyright and license ---
+*/
+
+/** @file
+    `flight_t` class interface.
+
+    @sa flight.cpp
+**/
+
+#ifndef _TAPPER_FLIGHT_HPP_
+#define _TAPPER_FLIGHT_HPP_
+
+#include "base.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "callback.hpp"
+#include "types.hpp"
+
+namespace tapper {
+
+// -------------------------------------------------------------------------------------------------
+// flight_t
+// -------------------------------------------------------------------------------------------------
+
+/**
+    Flight recorder: a fixed-size ring of the most recent pipeline records — input events, tap
+    decisions, actions and backend calls with their timings. Unlike `DBG()` and `TRACE()`, it
+    works in release builds, so when a tap "did not work", the recent history can be dumped and
+    inspected in a trace viewer (`chrome://tracing` or Perfetto).
+
+    `record()` is wait-free: a writer takes a slot by an atomic increment and fills it, it never
+    waits for other writers or the reader. Every slot is guarded by a sequence number, so the
+    reader skips slots which are being written or were overwritten while it read them.
+
+    There is only one instance of the class, use `flight()` function to access it.
+**/
+class flight_t {
+
+    public:
+
+        /** Record kinds. **/
+        enum class kind_t: std::uint8_t {
+            event,      ///< Input event, from kernel time to tapper entry. `value` is key state.
+            tap,        ///< Tap detected. `value` is 1 if the tapper is active.
+            chord,      ///< Chord tap detected. `arg` is the key released last, `value` as above.
+            skip,       ///< Release of the last pressed key which is not a tap, see `skip_t`.
+            drop,       ///< Action dropped because the executor queue is full.
+            layout,     ///< Layout activation by the layouter. `value` is 1 if it failed.
+            emit,       ///< Key tap emission by the emitter. `value` is 1 if it failed.
+            dbus,       ///< D-Bus call, from call to reply. `value` is 1 if it failed.
+            max = dbus,
+        };
+
+        /** Reasons why releasing the last pressed key is not a tap. **/
+        enum class skip_t: std::uint8_t {
+            chord,      ///< Other keys are still pressed.
+            held,       ///< The key was held longer than the repeat delay.
+        };
+
+        /** Flight recorder exceptions. **/
+        class error_t: public std::runtime_error {
+            public:
+                using std::runtime_error::runtime_error;
+        }; // class error_t
+
+        /** A record, as returned by `records()`. **/
+        struct record_t {
+            stamp_t         time;       ///< Start time.
+            stamp_t         duration;   ///< Zero for instant records.
+            kind_t          kind;
+            std::uint8_t    value;      ///< Kind-specific value.
+            std::uint16_t   arg;        ///< Key code or layout index, 0 if not applicable.
+            std::uint32_t   tid;        ///< Kernel id of the writer thread.
+        };
+
+        using records_t = std::vector< record_t >;
+
+        /**
+            Completion callback of a background dump: path of the file and error message, empty if
+            the dump succeeded.
+        **/
+        using on_dumped_t = t::callback_t< string_t const &, string_t const & >;
+
+        /** Number of records kept. **/
+        static size_t constexpr capacity = 4096;
+
+    public:
+
+        flight_t();
+        ~flight_t();
+        flight_t( flight_t const & ) = delete;
+        flight_t & operator =( flight_t const & ) = delete;
+
+        /**
+            Records a span from `start` to `finish` (an instant record if they are equal). Can be
+            called from any thread; does not block and does not allocate memory.
+        **/
+        void record(
+            kind_t          kind,
+            stamp_t         start,
+            stamp_t         finish,
+            std::uint16_t   arg     = 0,
+            std::uint8_t    value   = 0
+        );
+
+        /** Returns consistent records from the oldest to the newest. **/
+        records_t records() const;
+
+        /** Returns records in Chrome trace event format (JSON). **/
+        string_t json() const;
+
+        /** Writes `json()` to the file. **/
+        void dump( string_t const & path ) const;
+
+        /**
+            Takes the records and returns immediately; the records are formatted and written to the
+            file by a background thread, so a slow file system does not stall the caller (e. g. the
+            reactor, which runs the listener). `on_dumped` is called from the background thread.
+            Throws if the previous dump is not yet completed. Must not be called concurrently with
+            itself or `wait()`.
+        **/
+        void dump( string_t const & path, on_dumped_t on_dumped );
+
+        /** Waits for completion of the background dump, if any. **/
+        void wait();
+
+    private:
+
+        class dumper_t;
+
+        using word_t = std::atomic< std::uint64_t >;
+
+        /**
+            Ring slot. `seq` is odd while the slot is being written, and even when the record
+            number `( seq - 2 ) / 2` is complete.
+        **/
+        struct slot_t {
+            word_t seq;
+            word_t time;
+            word_t duration;
+            word_t info;        ///< Kind, value, arg, and tid packed.
+        };
+
+        std::atomic< std::uint64_t >    _next;  ///< Number of the next record.
+
+        /** Slots do not share a cache line with `_next`, which is updated by every writer. **/
+        alignas( 64 ) slot_t            _slots[ capacity ];
+
+        std::unique_ptr< dumper_t >     _dumper;    ///< The last background dump.
+
+}; // class flight_t
+
+/** Returns reference to the only instance of the flight recorder. **/
+flight_t & flight();
+
+string_t str( flight_t::kind_t kind );
+
+}; // namespace tapper
+
+#endif // _TAPPER_FLIGHT_HPP_
+
+// end of file //
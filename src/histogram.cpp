@@ -0,0 +1,196 @@
+/*
+    ---------------------------------------------------------------------- copyright and license ---
+
+    File: src/histogram.cpp
+
+    Copyright 🄯 2014, 2016—2017, 2019—2023 Van de Bugger.
+
+    This file is part of Tapper.
+
+    Tapper is free software: you can redistribute it and/or modify it under the terms of the GNU
+    General Public License as published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    Tapper is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+    even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along with Tapper.  If not,
+    see <https://www.gnu.org/licenses/>.
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+
+    ---------------------------------------------------------------------- copyright and license ---
+*/
+
+/** @file
+    `histogram_t` class implementation.
+**/
+
+#include "histogram.hpp"
+
+#include <cmath>
+#include <limits>
+
+#include "test.hpp"
+
+namespace tapper {
+
+// -------------------------------------------------------------------------------------------------
+// Buckets
+// -------------------------------------------------------------------------------------------------
+
+using value_t = histogram_t::value_t;
+
+static uint_t constexpr sub_bits     = histogram_t::sub_bits;
+static uint_t constexpr sub_count    = histogram_t::sub_count;
+static uint_t constexpr bucket_count = histogram_t::bucket_count;
+
+/** Returns index of the bucket the value belongs to. **/
+static
+uint_t
+bucket_index(
+    value_t value
+) {
+    if ( value < sub_count ) {
+        return uint_t( value );
+    };
+    uint_t msb   = 63 - __builtin_clzll( value );   // Index of the most significant bit.
+    uint_t shift = msb - sub_bits;
+    return ( shift + 1 ) * sub_count + uint_t( value >> shift ) - sub_count;
+};
+
+/** Returns the smallest value of the bucket. **/
+static
+value_t
+bucket_lower(
+    uint_t index
+) {
+    if ( index < sub_count ) {
+        return index;
+    };
+    uint_t shift = index / sub_count - 1;
+    return value_t( sub_count + index % sub_count ) << shift;
+};
+
+/** Returns the largest value of the bucket. **/
+static
+value_t
+bucket_upper(
+    uint_t index
+) {
+    if ( index + 1 >= bucket_count ) {
+        return std::numeric_limits< value_t >::max();
+    };
+    return bucket_lower( index + 1 ) - 1;
+};
+
+TEST(
+    // Buckets are continuous, and bounds fall into their buckets.
+    for ( uint_t i = 0; i + 1 < bucket_count; ++ i ) {
+        ASSERT_EQ( bucket_upper( i ) + 1, bucket_lower( i + 1 ) );
+        ASSERT_EQ( bucket_index( bucket_lower( i ) ), i );
+        ASSERT_EQ( bucket_index( bucket_upper( i ) ), i );
+    };
+    ASSERT_EQ( bucket_index( std::numeric_limits< value_t >::max() ), bucket_count - 1 );
+);
+
+// -------------------------------------------------------------------------------------------------
+// histogram_t
+// -------------------------------------------------------------------------------------------------
+
+histogram_t::histogram_t(
+) {
+    for ( auto & bucket: _buckets ) {
+        bucket.store( 0, std::memory_order_relaxed );
+    };
+    _count.store( 0, std::memory_order_relaxed );
+    _sum.store( 0, std::memory_order_relaxed );
+    _max.store( 0, std::memory_order_relaxed );
+}; // ctor
+
+void
+histogram_t::record(
+    value_t value
+) {
+    _buckets[ bucket_index( value ) ].fetch_add( 1, std::memory_order_relaxed );
+    _count.fetch_add( 1, std::memory_order_relaxed );
+    _sum.fetch_add( value, std::memory_order_relaxed );
+    auto max = _max.load( std::memory_order_relaxed );
+    while ( value > max and not _max.compare_exchange_weak( max, value ) ) {
+        // `max` is updated by `compare_exchange_weak`, just try again.
+    };
+}; // record
+
+histogram_t::value_t
+histogram_t::count(
+) const {
+    return _count.load( std::memory_order_relaxed );
+}; // count
+
+histogram_t::value_t
+histogram_t::sum(
+) const {
+    return _sum.load( std::memory_order_relaxed );
+}; // sum
+
+histogram_t::value_t
+histogram_t::max(
+) const {
+    return _max.load( std::memory_order_relaxed );
+}; // max
+
+histogram_t::value_t
+histogram_t::percentile(
+    double percent
+) const {
+    value_t total = 0;
+    for ( auto const & bucket: _buckets ) {
+        total += bucket.load( std::memory_order_relaxed );
+    };
+    if ( total == 0 ) {
+        return 0;
+    };
+    auto rank = value_t( std::ceil( total * percent / 100 ) );
+    rank = std::max< value_t >( rank, 1 );
+    value_t seen = 0;
+    for ( uint_t i = 0; i < bucket_count; ++ i ) {
+        seen += _buckets[ i ].load( std::memory_order_relaxed );
+        if ( seen >= rank ) {
+            return std::min( bucket_upper( i ), max() );
+        };
+    };
+    return max();
+}; // percentile
+
+string_t
+histogram_t::str(
+) const {
+    return STR(
+        "n=" << count() << ", " <<
+        "p50=" << percentile( 50 ) << ", " <<
+        "p90=" << percentile( 90 ) << ", " <<
+        "p99=" << percentile( 99 ) << ", " <<
+        "max=" << max()
+    );
+}; // str
+
+TEST(
+    histogram_t histogram;
+    ASSERT_EQ( histogram.count(), 0U );
+    ASSERT_EQ( histogram.percentile( 50 ), 0U );
+    for ( histogram_t::value_t value = 1; value <= 100; ++ value ) {
+        histogram.record( value );
+    };
+    ASSERT_EQ( histogram.count(), 100U );
+    ASSERT_EQ( histogram.sum(), 5050U );
+    ASSERT_EQ( histogram.max(), 100U );
+    ASSERT_EQ( histogram.percentile( 1 ), 1U );         // Small values are exact.
+    ASSERT( histogram.percentile( 50 ) >= 50 and histogram.percentile( 50 ) <= 50 * 9 / 8 );
+    ASSERT( histogram.percentile( 90 ) >= 90 and histogram.percentile( 90 ) <= 90 * 9 / 8 );
+    ASSERT_EQ( histogram.percentile( 100 ), 100U );     // Clamped by max.
+);
+
+}; // namespace tapper
+
+// end of file //
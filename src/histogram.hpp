@@ -0,0 +1,106 @@
+/*
+    ---------------------------------------------------------------------- copyright and license ---
+
+    File: src/histogram.hpp
+
+    Copyright 🄯 2014, 2016—2017, 2019—2023 Van de Bugger.
+
+    This file is part of Tapper.
+
+    Tapper is free software: you can redistribute it and/or modify it under the terms of the GNU
+    General Public License as published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    Tapper is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+    even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along with Tapper.  If not,
+    see <https://www.gnu.org/licenses/>.
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+
+    ---------------------------------------------------------------------- copyright and license ---
+*/
+
+/** @file
+    `histogram_t` class interface.
+
+    @sa histogram.cpp
+**/
+
+#ifndef _TAPPER_HISTOGRAM_HPP_
+#define _TAPPER_HISTOGRAM_HPP_
+
+#include "base.hpp"
+
+#include <atomic>
+#include <cstdint>
+
+namespace tapper {
+
+// -------------------------------------------------------------------------------------------------
+// histogram_t
+// -------------------------------------------------------------------------------------------------
+
+/**
+    Lock-free log-linear histogram of 64-bit values.
+
+    Values below 8 have their own buckets. Every larger power-of-two range is split into 8 equal
+    buckets, so a bucket bounds its values with relative error below 12.5%. Buckets are atomic
+    counters, so any number of threads may `record` values concurrently, while another thread
+    reads percentiles. Reading is not a snapshot, though: values recorded in the meantime may or
+    may not be taken into account.
+**/
+class histogram_t {
+
+    public:
+
+        using value_t = std::uint64_t;
+
+        static uint_t constexpr sub_bits     = 3;               ///< log2 of buckets per octave.
+        static uint_t constexpr sub_count    = 1 << sub_bits;   ///< Buckets per octave.
+        static uint_t constexpr bucket_count = ( 64 - sub_bits + 1 ) * sub_count;
+
+        histogram_t();
+        histogram_t( histogram_t const & ) = delete;
+        histogram_t & operator =( histogram_t const & ) = delete;
+
+        /** Adds the value to the histogram. Does not block and does not allocate memory. **/
+        void    record( value_t value );
+
+        /** Returns number of recorded values. **/
+        value_t count() const;
+
+        /** Returns sum of recorded values. **/
+        value_t sum() const;
+
+        /** Returns the largest recorded value, or 0 if no values recorded. **/
+        value_t max() const;
+
+        /**
+            Returns the value which is not less than `percent` percents of recorded values (upper
+            bound of the corresponding bucket, but not greater than `max()`). Returns 0 if no
+            values recorded.
+        **/
+        value_t percentile( double percent ) const;
+
+        /** Returns count, p50, p90, p99 and max as a human-readable string. **/
+        string_t str() const;
+
+    private:
+
+        using counter_t = std::atomic< value_t >;
+
+        counter_t _buckets[ bucket_count ];
+        counter_t _count;
+        counter_t _sum;
+        counter_t _max;
+
+}; // class histogram_t
+
+}; // namespace tapper
+
+#endif // _TAPPER_HISTOGRAM_HPP_
+
+// end of file //
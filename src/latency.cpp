@@ -0,0 +1,158 @@
+/*
+    ---------------------------------------------------------------------- copyright and license ---
+
+    File: src/latency.cpp
+
+    Copyright 🄯 2014, 2016—2017, 2019—2023 Van de Bugger.
+
+    This file is part of Tapper.
+
+    Tapper is free software: you can redistribute it and/or modify it under the terms of the GNU
+    General Public License as published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    Tapper is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+    even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along with Tapper.  If not,
+    see <https://www.gnu.org/licenses/>.
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+
+    ---------------------------------------------------------------------- copyright and license ---
+*/
+
+/** @file
+    `latency_t` class implementation.
+**/
+
+#include "latency.hpp"
+
+#include <chrono>
+
+#include "test.hpp"
+
+namespace tapper {
+
+// -------------------------------------------------------------------------------------------------
+// latency_t
+// -------------------------------------------------------------------------------------------------
+
+latency_t &
+latency(
+) {
+    static latency_t latency;
+    return latency;
+};
+
+stamp_t
+latency_t::now(
+) {
+    using namespace std::chrono;
+    return duration_cast< microseconds >( steady_clock::now().time_since_epoch() ).count();
+}; // now
+
+stamp_t
+latency_t::event_stamp(
+    stamp_t time,
+    stamp_t now
+) {
+    if ( time > now or now - time > 60000000 ) {
+        /*
+            A minute is too long for an input event to wait for. Most likely, the listener reports
+            time of another clock.
+        */
+        return 0;
+    };
+    return time;
+}; // event_stamp
+
+TEST(
+    ASSERT_EQ( latency_t::event_stamp( 1000000, 1000000 ), 1000000U );
+    ASSERT_EQ( latency_t::event_stamp(  990500, 1000000 ),  990500U );
+    ASSERT_EQ( latency_t::event_stamp( 1000001, 1000000 ),       0U );  // Event in the future.
+    ASSERT_EQ( latency_t::event_stamp( 1000000, 100000000 ),     0U );  // Another clock.
+);
+
+stamp_t
+latency_t::unwrap(
+    std::uint32_t   time,
+    stamp_t         now
+) {
+    /*
+        Unsigned subtraction of truncated values gives correct lag even if the 32-bit counter
+        wrapped. Time may be slightly ahead of `now` (e. g. the X server reads a coarse clock), a
+        huge lag means exactly this. An event can't happen after `now`, so time ahead within the
+        tolerance is clamped to `now`, otherwise `event_stamp` would reject it. Time ahead further
+        is likely time of another clock, it is restored as is.
+    */
+    static std::uint32_t constexpr tolerance = 1000;    // Milliseconds.
+    auto const base = now / 1000;
+    auto const lag  = std::uint32_t( std::uint32_t( base ) - time );
+    if ( lag > 0x80000000U ) {
+        auto const ahead = std::uint32_t( - lag );
+        return ahead <= tolerance ? now : ( base + ahead ) * 1000;
+    };
+    return ( base - lag ) * 1000;
+}; // unwrap
+
+TEST(
+    ASSERT_EQ( latency_t::unwrap( 1000, 1000000 ), 1000000U );
+    ASSERT_EQ( latency_t::unwrap(  990, 1000500 ),  990000U );
+    ASSERT_EQ( latency_t::unwrap( 1002, 1000000 ), 1000000U );     // Slightly ahead.
+    ASSERT_EQ( latency_t::unwrap( 1001, 1000999 ), 1000999U );
+    ASSERT_EQ( latency_t::unwrap( 3000, 1000000 ), 3000000U );     // Too far ahead.
+    ASSERT_EQ( latency_t::event_stamp( latency_t::unwrap( 1002, 1000000 ), 1000000 ), 1000000U );
+    ASSERT_EQ( latency_t::unwrap( 4294967295U, 1000ULL << 32 ), ( 1000ULL << 32 ) - 1000 );
+        // Wrapped counter.
+);
+
+void
+latency_t::record(
+    stage_t stage,
+    stamp_t start,
+    stamp_t finish
+) {
+    if ( start == 0 or finish < start ) {
+        return;
+    };
+    _histograms[ int( stage ) ].record( finish - start );
+}; // record
+
+strings_t
+latency_t::report(
+) const {
+    strings_t lines;
+    lines.push_back( "Latency, µs:" );
+    for ( int i = 0; i <= int( stage_t::max ); ++ i ) {
+        lines.push_back( STR( "    " << stage_t( i ) << ": " << _histograms[ i ] ) );
+    };
+    return lines;
+}; // report
+
+histogram_t const &
+latency_t::histogram(
+    stage_t stage
+) const {
+    return _histograms[ int( stage ) ];
+}; // histogram
+
+string_t
+str(
+    latency_t::stage_t stage
+) {
+    switch ( stage ) {
+        case latency_t::stage_t::listener: return "listener";
+        case latency_t::stage_t::detector: return "detector";
+        case latency_t::stage_t::queue:    return "queue";
+        case latency_t::stage_t::layouter: return "layouter";
+        case latency_t::stage_t::emitter:  return "emitter";
+        case latency_t::stage_t::total:    return "total";
+    };
+    return "(* unknown stage #" + str( int( stage ) ) + " *)";
+};
+
+}; // namespace tapper
+
+// end of file //
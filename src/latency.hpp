@@ -0,0 +1,112 @@
+/*
+    ---------------------------------------------------------------------- copyright and license ---
+
+    File: src/latency.hpp
+
+    Copyright 🄯 2014, 2016—2017, 2019—2023 Van de Bugger.
+
+    This file is part of Tapper.
+
+    Tapper is free software: you can redistribute it and/or modify it under the terms of the GNU
+    General Public License as published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    Tapper is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+    even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along with Tapper.  If not,
+    see <https://www.gnu.org/licenses/>.
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+
+    ---------------------------------------------------------------------- copyright and license ---
+*/
+
+/** @file
+    `latency_t` class interface.
+
+    @sa latency.cpp
+**/
+
+#ifndef _TAPPER_LATENCY_HPP_
+#define _TAPPER_LATENCY_HPP_
+
+#include "base.hpp"
+
+#include "histogram.hpp"
+#include "types.hpp"
+
+namespace tapper {
+
+// -------------------------------------------------------------------------------------------------
+// latency_t
+// -------------------------------------------------------------------------------------------------
+
+/**
+    Tap latency statistics. Every stage of the pipeline feeds its own histogram; histograms can be
+    recorded from any thread and reported at any moment.
+
+    There is only one instance of the class, use `latency()` function to access it.
+**/
+class latency_t {
+
+    public:
+
+        /** Pipeline stages. **/
+        enum class stage_t {
+            listener,   ///< Kernel event time → `tapper_t::_on_events` entry (delivery lag).
+            detector,   ///< `tapper_t::_on_events` entry → tap detected.
+            queue,      ///< Tap detected → action taken by an executor thread.
+            layouter,   ///< Layout activation, until the layouter returns.
+            emitter,    ///< Keystroke emulation, until the emitter returns.
+            total,      ///< Input event time → completion of an action.
+            max = total,
+        };
+
+        /** Returns the current monotonic time stamp. **/
+        static stamp_t now();
+
+        /**
+            Returns time stamp of an input event reported by a listener, if it can be compared
+            with `now`. Listeners report event time in microseconds of the monotonic clock, but a
+            device may use another clock. If the event time does not look like monotonic time
+            (e. g. it is in the future or too far in the past), 0 is returned.
+        **/
+        static stamp_t event_stamp( stamp_t time, stamp_t now );
+
+        /**
+            Restores time stamp from time in milliseconds of the monotonic clock truncated to 32
+            bits (e. g. X server time), relatively to `now` stamp. Such time wraps every 49.7
+            days, the restored stamp does not. Time slightly (up to a second) ahead of `now` is
+            clamped to `now`.
+        **/
+        static stamp_t unwrap( std::uint32_t time, stamp_t now );
+
+        /**
+            Records duration of the stage. If `start` is 0 (unknown), nothing is recorded.
+        **/
+        void record( stage_t stage, stamp_t start, stamp_t finish );
+
+        /** Returns human-readable statistics, one line per stage. **/
+        strings_t report() const;
+
+        /** Returns histogram of the stage. **/
+        histogram_t const & histogram( stage_t stage ) const;
+
+    private:
+
+        histogram_t _histograms[ int( stage_t::max ) + 1 ];
+
+}; // class latency_t
+
+/** Returns reference to the only instance of latency statistics. **/
+latency_t & latency();
+
+string_t str( latency_t::stage_t stage );
+
+}; // namespace tapper
+
+#endif // _TAPPER_LATENCY_HPP_
+
+// end of file //
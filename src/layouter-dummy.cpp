@@ -63,11 +63,11 @@ dummy_t::type(
 
 /** Prints debug message, *does not* activate layout. **/
 void
-dummy_t::activate(
+dummy_t::_activate(
     layout_t layout
 ) {
     INF( "(Activate layout " << layout << ".)" );
-}; // activate
+}; // _activate
 
 }; // namespace layouter
 }; // namespace tapper
@@ -55,8 +55,11 @@ class dummy_t: public object_t, public layouter_t {
     public:
 
         explicit         dummy_t();
-        virtual string_t type()                      override;
-        virtual void     activate( layout_t layout ) override;
+        virtual string_t type()                       override;
+
+    protected:
+
+        virtual void     _activate( layout_t layout ) override;
 
 }; // class dummy_t
 
@@ -61,7 +61,11 @@ gnome_t::gnome_t(
     _dbus(
         "org.gnome.Shell",
         "/org/gnome/Shell/Extensions/Agism",
-        "io.sourceforge.Agism"
+        "io.sourceforge.Agism",
+        {
+            { "ActivateInputSource", "(b)"          },
+            { "GetInputSources",     "(a(ussss))"   },
+        }
     )
 {
 }; // ctor
@@ -82,14 +86,36 @@ gnome_t::_get_repeat_delay(
 };
 
 /**
-    Activates specified keyboard layout.
+    Activates specified keyboard layout. The method does not wait for the reply, the reply is
+    handled by `_on_activated()`, which reports completion of the activation.
 **/
 void
-gnome_t::activate(
+gnome_t::_activate(
     layout_t layout
 ) {
     TRACE();
     assert( layout.index );
+    auto const ticket = _ticket();
+    _dbus.call(
+        "ActivateInputSource",
+        layout.index < _args.size() and _args[ layout.index ].gobj()
+            ? _args[ layout.index ] : _make_args( layout ),
+        "(b)",
+        [ this, layout, ticket ]( dbus_t::reply_t const & reply, std::exception_ptr error ) {
+            bool activated = false;
+            CATCH_ALL( activated = _on_activated( layout, reply, error ) );
+            _activated( layout, ticket, not activated );
+        }
+    );
+}; // _activate
+
+/** Handles `ActivateInputSource` reply. Returns `true` if the layout is activated. **/
+bool
+gnome_t::_on_activated(
+    layout_t                layout,
+    dbus_t::reply_t const & reply,
+    std::exception_ptr      error
+) {
     /*
         If GNOME Shell restarts, activating a layout will fail with one of the errors:
 
@@ -103,32 +129,56 @@ gnome_t::activate(
         // TODO: Can GNOME Shell restart in Wayland session?
     */
     try {
-        auto reply = _dbus.call(
-            "ActivateInputSource",
-            Glib::Variant< std::tuple< guint, bool, string_t > >::create(
-                std::make_tuple( layout.index  - 1, false, bell() ? "bell" : "" )
-            ),
-            "(b)",
-            std::chrono::milliseconds( 10 )
-        );
-        auto ok = CAST_DYNAMIC( Variant< bool >, reply.get_child( 0 ) ).get();
-        if ( not ok ) {
+        if ( error ) {
+            std::rethrow_exception( error );
+        };
+        if ( not dbus_t::boolean( reply ) ) {
             WRN( "Can't activate layout " << layout << ": No such layout." );
+            return false;
         };
     } catch ( dbus_t::error_t const & ex ) {
         if ( ex.code() == dbus_t::error_t::code_t::no_such_bus ) {
             WRN( "Can't activate layout " << layout << ": " << ex.what() );
+            return false;
         } else {
             throw;
         };
     } catch ( Glib::Error const & ex ) {
         if ( ex.matches( G_DBUS_ERROR, G_DBUS_ERROR_UNKNOWN_METHOD ) ) {
             WRN( "Can't activate layout " << layout << ": " << ex.what() );
+            return false;
         } else {
             throw;
         };
     };
-}; // activate
+    return true;
+}; // _on_activated
+
+/**
+    Prepares `ActivateInputSource` arguments for all the given layouts, so activation does not
+    spend time on building them.
+**/
+void
+gnome_t::_prepare(
+    layouts_t const & layouts
+) {
+    _args.clear();
+    for ( auto const layout: layouts ) {
+        if ( layout.index >= _args.size() ) {
+            _args.resize( layout.index + 1 );
+        };
+        _args[ layout.index ] = _make_args( layout );
+    };
+}; // _prepare
+
+gnome_t::args_t
+gnome_t::_make_args(
+    layout_t layout
+) {
+    return Glib::Variant< std::tuple< guint, bool, string_t > >::create(
+        std::make_tuple( layout.index  - 1, false, bell() ? "bell" : "" )
+    );
+}; // _make_args
 
 strings_t
 gnome_t::_get_layout_names(
@@ -137,8 +187,7 @@ gnome_t::_get_layout_names(
     auto reply = _dbus.call(
         "GetInputSources",
         Glib::VariantContainerBase(),
-        "(a(ussss))",
-        std::chrono::milliseconds( 100 )
+        "(a(ussss))"
     );
     auto array = CAST_DYNAMIC( VariantContainerBase, reply.get_child( 0 ) );
     for ( size_t i = 0, end = array.get_n_children(); i < end; ++ i ) {
@@ -159,6 +208,13 @@ gnome_t::_can_ring(
     return true;
 };
 
+/** Returns `true`: activation completes when GNOME Shell replies. **/
+bool
+gnome_t::_is_async(
+) {
+    return true;
+};
+
 void
 gnome_t::_start(
 ) {
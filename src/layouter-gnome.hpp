@@ -53,6 +53,9 @@ namespace layouter {
 
     Obviously this layouter requires GNOME Shell. It works for GNOME desktop, GNOME Classic desktop
     and Ubuntu desktop, and is not suitable for non-GNOME desktops.
+
+    The layouter does not track the active layout: the Agism extension does not notify about input
+    source changes, so every activation request goes to GNOME Shell.
 **/
 class gnome_t: public object_t, public layouter_t {
 
@@ -60,21 +63,33 @@ class gnome_t: public object_t, public layouter_t {
 
         explicit          gnome_t();
         virtual string_t  type()                      override;
-        virtual void      activate( layout_t layout ) override;
 
     protected:
 
+        virtual void      _activate( layout_t layout ) override;
         virtual time_t    _get_repeat_delay()         override;
         virtual strings_t _get_layout_names()         override;
         virtual bool      _can_ring()                 override;
+        virtual bool      _is_async()                 override;
         virtual void      _start()                    override;
         virtual void      _stop()                     override;
+        virtual void      _prepare( layouts_t const & layouts ) override;
+
+    private:
+
+        using args_t = Glib::VariantContainerBase;
+
+        args_t _make_args( layout_t layout );
+        bool   _on_activated(
+            layout_t layout, dbus_t::reply_t const & reply, std::exception_ptr error
+        );
 
     private:
 
-        dbus_t          _dbus;
-        gint            _id;
-        gint            _sub;
+        dbus_t                  _dbus;
+        gint                    _id;
+        gint                    _sub;
+        std::vector< args_t >   _args;  ///< Prepared arguments, indexed by layout index.
 
 }; // class gnome_t
 
@@ -36,6 +36,8 @@
 #include <glibmm/fileutils.h>   // FileError
 #include <glibmm/keyfile.h>
 
+#include <giomm/dbusconnection.h>
+#include <giomm/dbuswatchname.h>
 #include <giomm/settings.h>
 
 #include "string.hpp"
@@ -52,6 +54,8 @@ layouter_kde_create(
 namespace tapper {
 namespace layouter {
 
+using connection_t = Glib::RefPtr< Gio::DBus::Connection >;
+
 // -------------------------------------------------------------------------------------------------
 // kde_t
 // -------------------------------------------------------------------------------------------------
@@ -62,7 +66,11 @@ kde_t::kde_t(
     _dbus(
         "org.kde.keyboard",
         "/Layouts",
-        "org.kde.KeyboardLayouts"
+        "org.kde.KeyboardLayouts",
+        {
+            { "setLayout",           "(b)"          },
+            { "getLayoutsList",      "(a(sss))"     },
+        }
     )
 {
 }; // ctor
@@ -75,30 +83,63 @@ kde_t::type(
 }; // type
 
 /**
-    Activates specified keyboard layout.
+    Activates specified keyboard layout. The method does not wait for the reply, the reply is
+    handled by `_on_activated()`, which reports completion of the activation.
 **/
 void
-kde_t::activate(
+kde_t::_activate(
     layout_t layout
 ) {
     assert( layout.index );
-    auto reply = _dbus.call(
+    auto const ticket = _ticket();
+    _dbus.call(
         "setLayout",
-        Glib::Variant< std::tuple< guint > >::create( std::make_tuple( layout.index - 1 ) ),
+        layout.index < _args.size() and _args[ layout.index ].gobj()
+            ? _args[ layout.index ] : _make_args( layout ),
         "(b)",
-        std::chrono::milliseconds( 10 )
+        [ this, layout, ticket ]( dbus_t::reply_t const & reply, std::exception_ptr error ) {
+            bool activated = false;
+            CATCH_ALL( activated = _on_activated( layout, reply, error ) );
+            _activated( layout, ticket, not activated );
+        }
     );
-    auto ok = CAST_DYNAMIC( Variant< bool >, reply.get_child( 0 ) ).get();
-    if ( not ok ) {
+}; // _activate
+
+/** Handles `setLayout` reply. Returns `true` if the layout is activated. **/
+bool
+kde_t::_on_activated(
+    layout_t                layout,
+    dbus_t::reply_t const & reply,
+    std::exception_ptr      error
+) {
+    if ( error ) {
+        std::rethrow_exception( error );
+    };
+    if ( not dbus_t::boolean( reply ) ) {
         WRN( "Can't activate layout " << layout << ": No such layout." );
-        return;
+        return false;
+    };
+    if ( _sub ) {
+        /*
+            `layoutChanged` signal may come before or after the reply, but the next tap may come
+            sooner than the signal.
+        */
+        _set_active( layout );
     };
     if ( bell() ) {
         /*
             TODO: Try to play sound with GTK libraries?
         */
     };
-}; // activate
+    return true;
+}; // _on_activated
+
+/** Returns `true`: activation completes when KDE replies. **/
+bool
+kde_t::_is_async(
+) {
+    return true;
+};
 
 /** Extracts repeat delay from KDE settings and returns it. **/
 time_t
@@ -159,6 +200,100 @@ kde_t::_get_repeat_delay(
     return 0;
 };
 
+/**
+    Prepares `setLayout` arguments for all the given layouts, so activation does not spend time on
+    building them.
+**/
+void
+kde_t::_prepare(
+    layouts_t const & layouts
+) {
+    _args.clear();
+    for ( auto const layout: layouts ) {
+        if ( layout.index >= _args.size() ) {
+            _args.resize( layout.index + 1 );
+        };
+        _args[ layout.index ] = _make_args( layout );
+    };
+}; // _prepare
+
+kde_t::args_t
+kde_t::_make_args(
+    layout_t layout
+) {
+    return Glib::Variant< std::tuple< guint > >::create( std::make_tuple( layout.index - 1 ) );
+}; // _make_args
+
+/**
+    Starts tracking the active layout. KDE emits `layoutChanged` signal with zero-based index of the
+    new layout whenever the layout is changed, either by Tapper or by the user. Until the first
+    signal (or the first activation) the active layout is unknown.
+**/
+void
+kde_t::_start(
+) {
+    _id = Gio::DBus::watch_name(
+        Gio::DBus::BusType::SESSION,
+        _dbus.name(),
+        [ this ](
+            connection_t const &    connection,
+            string_t                name,
+            string_t const &
+        ) {
+            DBG( "Name " << q( name ) << " appeared in the session bus." );
+            _conn = connection;
+            _sub = connection->signal_subscribe(
+                [ this ](
+                    connection_t,
+                    string_t const &,
+                    string_t const &,
+                    string_t const &,
+                    string_t const &,
+                    Glib::VariantContainerBase const & params
+                ) {
+                    if ( params.get_type_string() != "(u)" ) {
+                        WRN( "Unexpected " << q( "layoutChanged" ) << " signal parameters." );
+                        _set_active( layout_t() );
+                        return;
+                    };
+                    guint index = 0;
+                    g_variant_get( const_cast< GVariant * >( params.gobj() ), "(u)", & index );
+                    DBG( "Layout " << ( index + 1 ) << " is active." );
+                    _set_active( layout_t( index + 1 ) );
+                },
+                _dbus.name(),               // sender
+                _dbus.face(),               // interface
+                "layoutChanged",            // signal
+                _dbus.path()                // object
+            );
+        },
+        [ this ](
+            connection_t const &    connection,
+            string_t                name
+        ) {
+            DBG( "Name " << q( name ) << " vanished in the session bus." );
+            if ( connection and _sub ) {
+                connection->signal_unsubscribe( _sub );
+            };
+            _sub = 0;
+            _conn.reset();
+            _set_active( layout_t() );      // The new instance may start with another layout.
+        }
+    );
+}; // _start
+
+void
+kde_t::_stop(
+) {
+    Gio::DBus::unwatch_name( _id );
+    _id = 0;
+    if ( _conn ) {
+        _conn->signal_unsubscribe( _sub );
+        _sub = 0;
+        _conn.reset();
+    };
+}; // _stop
+
 strings_t
 kde_t::_get_layout_names(
 ) {
@@ -166,8 +301,7 @@ kde_t::_get_layout_names(
     auto reply = _dbus.call(
         "getLayoutsList",
         Glib::VariantContainerBase(),
-        "(a(sss))",
-        std::chrono::milliseconds( 100 )
+        "(a(sss))"
     );
     auto array = CAST_DYNAMIC( VariantContainerBase, reply.get_child( 0 ) );
     for ( size_t i = 0, end = array.get_n_children(); i < end; ++ i ) {
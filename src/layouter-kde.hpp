@@ -52,6 +52,9 @@ namespace layouter {
     them by invoking KDE methods via D-BUS.
 
     Obviously this layouter requires KDE.
+
+    The layouter tracks the active layout by listening `layoutChanged` signal, so activating the
+    already active layout does not cost a D-Bus call.
 **/
 class kde_t: public object_t, public layouter_t {
 
@@ -59,16 +62,33 @@ class kde_t: public object_t, public layouter_t {
 
         explicit               kde_t();
         virtual string_t       type()                          override;
-        virtual void           activate( layout_t layout )     override;
 
     protected:
 
+        virtual void           _activate( layout_t layout )    override;
+        virtual bool           _is_async()                     override;
+        virtual void           _start()                        override;
+        virtual void           _stop()                         override;
         virtual time_t         _get_repeat_delay()             override;
         virtual strings_t      _get_layout_names()             override;
+        virtual void           _prepare( layouts_t const & layouts ) override;
+
+    private:
+
+        using args_t = Glib::VariantContainerBase;
+
+        args_t _make_args( layout_t layout );
+        bool   _on_activated(
+            layout_t layout, dbus_t::reply_t const & reply, std::exception_ptr error
+        );
 
     private:
 
-        dbus_t  _dbus;
+        dbus_t                  _dbus;
+        guint                   _id  { 0 };
+        std::atomic< guint >    _sub { 0 };     ///< `layoutChanged` subscription, 0 if none.
+        Glib::RefPtr< Gio::DBus::Connection > _conn;
+        std::vector< args_t >   _args;  ///< Prepared arguments, indexed by layout index.
 
 }; // class kde_t
 
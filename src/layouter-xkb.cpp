@@ -33,6 +33,8 @@
 #include "layouter-xkb.hpp"
 #include "layouter-xkb.h"
 
+#include "reactor.hpp"
+
 tapper::layouter_t *
 layouter_xkb_create(
 ) {
@@ -49,7 +51,8 @@ namespace layouter {
 xkb_t::xkb_t(
 ):
     OBJECT_T(),
-    _kb( _display )
+    _display( x::shared_display() ),
+    _kb( * _display )
 {
 }; // ctor
 
@@ -80,7 +83,7 @@ xkb_t::_get_layout_names(
 };
 
 void
-xkb_t::activate(
+xkb_t::_activate(
     layout_t layout
 ) {
     assert( layout.index > 0 );
@@ -89,7 +92,22 @@ xkb_t::activate(
         _kb.bell();
     }; // if
     _kb.display().flush();
-}; // activate
+    if ( _monitor ) {
+        /*
+            `XkbStateNotify` event will come soon, but the next tap may come sooner.
+        */
+        _set_active( layout );
+    }; // if
+}; // _activate
+
+/** Rings the bell without locking the group again. **/
+void
+xkb_t::_ring(
+    layout_t
+) {
+    _kb.bell();
+    _kb.display().flush();
+}; // _ring
 
 bool
 xkb_t::_can_ring(
@@ -97,6 +115,50 @@ xkb_t::_can_ring(
     return true;
 };
 
+/**
+    Starts tracking the active layout. Events are selected before querying the current group, so
+    a change cannot slip between the query and watching the connection.
+**/
+void
+xkb_t::_start(
+) {
+    _monitor.reset( new monitor_t );
+    _monitor->kb.select_group_events();
+    _monitor->display.flush();
+    _set_active( layout_t( _kb.locked_group() + 1 ) );
+    reactor().watch(
+        _monitor->display.connection(),
+        reactor_t::on_ready_t::make< xkb_t, & xkb_t::_on_state >( this )
+    );
+}; // _start
+
+void
+xkb_t::_stop(
+) {
+    if ( _monitor ) {
+        reactor().unwatch( _monitor->display.connection() );
+        _monitor.reset();
+    }; // if
+}; // _stop
+
+/**
+    Processes keyboard state events. Called by the reactor when the monitor connection is ready for
+    reading.
+**/
+void
+xkb_t::_on_state(
+) {
+    while ( XPending( _monitor->display ) ) {
+        XEvent event;
+        XNextEvent( _monitor->display, & event );
+        uint_t group = 0;
+        if ( _monitor->kb.group_event( event, group ) ) {
+            DBG( "Group " << ( group + 1 ) << " is active." );
+            _set_active( layout_t( group + 1 ) );
+        }; // if
+    }; // while
+}; // _on_state
+
 }; // namespace layouter
 }; // namespace tapper
 
@@ -53,6 +53,10 @@ namespace layouter {
 
     Obviously this layouter requires X Window System. This layouter works for non-GNOME desktops:
     LXDE, LXQt, Mate, Xfce, and probably others.
+
+    When started, the layouter tracks the active layout: it listens `XkbStateNotify` events on a
+    separate display connection watched by the reactor, so activating the already active layout
+    does not cost a request to the X server.
 **/
 class xkb_t: public object_t, public layouter_t {
 
@@ -63,16 +67,37 @@ class xkb_t: public object_t, public layouter_t {
 
     protected:          // methods
 
-        virtual layout_range_t layout_range()              override;
-        virtual void           activate( layout_t layout ) override;
-        virtual time_t         _get_repeat_delay()         override;
-        virtual strings_t      _get_layout_names()         override;
-        virtual bool           _can_ring()                 override;
+        virtual layout_range_t layout_range()               override;
+        virtual void           _activate( layout_t layout ) override;
+        virtual void           _ring( layout_t layout )     override;
+        virtual time_t         _get_repeat_delay()          override;
+        virtual strings_t      _get_layout_names()          override;
+        virtual bool           _can_ring()                  override;
+        virtual void           _start()                     override;
+        virtual void           _stop()                      override;
+
+    private:            // types
+
+        /**
+            Connection which listens keyboard state changes. Events are read by the reactor
+            thread, they must not be mixed with requests of the executor threads, so the monitor
+            uses its own connection.
+        **/
+        struct monitor_t {
+            x::display_t    display;
+            x::kb_t         kb;
+            monitor_t(): kb( display ) {};
+        }; // struct monitor_t
+
+    private:            // methods
+
+        void _on_state();
 
     private:            // data
 
-        x::display_t    _display;
-        x::kb_t         _kb;
+        x::display_s        _display;   ///< Shared with the XTest emitter.
+        x::kb_t             _kb;
+        ptr_t< monitor_t >  _monitor;
 
 }; // class xkb_t
 
@@ -29,6 +29,8 @@
 
 #include "layouter.hpp"
 
+#include "test.hpp"
+
 #include "layouter-dummy.h"
 #if ENABLE_GNOME
     #include "layouter-gnome.h"
@@ -145,16 +147,59 @@ layouter_t::layout(
     return layout_t();
 };
 
+void
+layouter_t::activate(
+    layout_t layout,
+    ticket_t ticket
+) {
+    _ticket_ = ticket;
+    try {
+        if ( layout.index == _active_.load( std::memory_order_relaxed ) ) {
+            DBG( "Layout " << layout << " is already active." );
+            if ( not _bell_always_ ) {
+                _activated( layout, ticket, false );
+                return;
+            };
+            _ring( layout );
+        } else {
+            _activate( layout );
+        };
+    } catch ( ... ) {
+        _activated( layout, ticket, true );
+        throw;
+    };
+    if ( not _is_async() ) {
+        _activated( layout, ticket, false );
+    };
+}; // activate
+
+void
+layouter_t::set_on_activated(
+    on_activated_t handler
+) {
+    std::lock_guard< std::mutex > lock( _on_activated_mutex_ );
+    _on_activated_ = handler;
+}; // set_on_activated
+
+layout_t
+layouter_t::active(
+) const {
+    return layout_t( _active_.load( std::memory_order_relaxed ) );
+}; // active
+
 void
 layouter_t::start(
-    bool        bell,
-    on_event_t  handler
+    settings_t::bell_t  bell,
+    layouts_t const &   layouts,
+    on_event_t          handler
 ) {
-    if ( bell and not _can_ring() ) {
+    _bell_        = bell == settings_t::bell_t::enabled or bell == settings_t::bell_t::always;
+    _bell_always_ = bell == settings_t::bell_t::always;
+    if ( _bell_ and not _can_ring() ) {
         INF( type() << " layouter cannot ring the bell." );
     };
-    _bell_ = bell;
     _handler = handler;
+    _prepare( layouts );
     _start();
 }; // start
 
@@ -169,9 +214,25 @@ layouter_t::stop(
 ) {
     _stop();
     _bell_ = false;
+    _bell_always_ = false;
     _handler = nullptr;
+    _set_active( layout_t() );
 }; // stop
 
+void
+layouter_t::_ring(
+    layout_t layout
+) {
+    _activate( layout );
+}; // _ring
+
+void
+layouter_t::_set_active(
+    layout_t layout
+) {
+    _active_.store( layout.index, std::memory_order_relaxed );
+}; // _set_active
+
 time_t
 layouter_t::_get_repeat_delay(
 ) {
@@ -190,6 +251,34 @@ layouter_t::_can_ring(
     return false;
 };
 
+void
+layouter_t::_prepare(
+    layouts_t const &
+) {
+};
+
+bool
+layouter_t::_is_async(
+) {
+    return false;
+};
+
+/**
+    Calls the completion handler, if any. The handler is called with the mutex locked, so
+    `set_on_activated()` waits for the running handler.
+**/
+void
+layouter_t::_activated(
+    layout_t layout,
+    ticket_t ticket,
+    bool     failed
+) {
+    std::lock_guard< std::mutex > lock( _on_activated_mutex_ );
+    if ( _on_activated_ ) {
+        _on_activated_( layout, ticket, failed );
+    };
+}; // _activated
+
 strings_t const &
 layouter_t::_layout_names(
 ) {
@@ -199,6 +288,43 @@ layouter_t::_layout_names(
     return * _layout_names_.get();
 };
 
+namespace {
+
+/** Layouter which counts activations and pretends it tracks the active layout. **/
+struct counter_t: public layouter_t {
+    int activations { 0 };
+    int completions { 0 };
+    virtual string_t type() override { return "Counter"; };
+    virtual void _activate( layout_t layout ) override { ++ activations; _set_active( layout ); };
+    void switched( layout_t layout ) { _set_active( layout ); };
+    void completed( layout_t, ticket_t, bool ) { ++ completions; };
+};
+
+}; // namespace
+
+TEST(
+    counter_t layouter;
+    layouter.set_on_activated(
+        layouter_t::on_activated_t::make< counter_t, & counter_t::completed >( & layouter )
+    );
+    layouter.start();
+    ASSERT_EQ( layouter.active().index, 0u );
+    layouter.activate( layout_t( 1 ) );
+    layouter.activate( layout_t( 1 ) );             // Already active — skipped.
+    ASSERT_EQ( layouter.activations, 1 );
+    ASSERT_EQ( layouter.completions, 2 );           // Skipped activation is completed, too.
+    layouter.set_on_activated( nullptr );
+    layouter.switched( layout_t( 2 ) );             // The user switched layout by other means.
+    layouter.activate( layout_t( 1 ) );
+    ASSERT_EQ( layouter.activations, 2 );
+    layouter.stop();
+    layouter.start( settings_t::bell_t::always );
+    layouter.activate( layout_t( 1 ) );
+    layouter.activate( layout_t( 1 ) );             // Already active, but the bell should ring.
+    ASSERT_EQ( layouter.activations, 4 );
+    layouter.stop();
+);
+
 }; // namespace tapper
 
 // end of file //
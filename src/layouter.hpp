@@ -34,8 +34,11 @@
 
 #include "base.hpp"
 
+#include <atomic>
 #include <functional>
+#include <mutex>
 
+#include "callback.hpp"
 #include "settings.hpp"
 #include "types.hpp"
 
@@ -73,6 +76,15 @@ using layouter_p = ptr_t< layouter_t >;
     only GNOME layouter can do it. It may not be the best possible design desision, but GNOME
     layouter is the component closest to GNOME. It already communicates with GNOME through D-Bus,
     so let it listen the bus for one more signal.
+
+    A layouter may also track the active layout: if the backend notifies about layout changes, the
+    layouter reports them by calling `_set_active()`. In such a case `activate()` does not bother
+    the backend when the requested layout is already active, so tapping a key assigned to the
+    current layout costs no round trip to the X server or D-Bus peer.
+
+    Activation may be asynchronous: D-Bus layouters send a request and return, the reply comes
+    later. A caller interested in the outcome sets a completion handler with `set_on_activated()`,
+    it is called once per `activate()` call when the activation actually completes.
 **/
 class layouter_t {
 
@@ -86,6 +98,21 @@ class layouter_t {
 
         using on_event_t = std::function< void( bool ) >;
 
+        /**
+            Caller data passed to `activate()` and returned to the completion handler as is: time
+            of the event which caused activation, and time activation started, in µs.
+        **/
+        struct ticket_t {
+            stamp_t event;
+            stamp_t started;
+        };
+
+        /**
+            Activation completion handler. Arguments are the layout, the ticket passed to
+            `activate()`, and `true` if activation failed.
+        **/
+        using on_activated_t = t::callback_t< layout_t, ticket_t, bool >;
+
     public:         // methods
 
         /** Layouter factory. Returns pointer to a new layouter of the specified type. **/
@@ -138,16 +165,41 @@ class layouter_t {
             The method activates the given layout and ring the bell (if `_bell_` is `true` and
             layouter is capable to do it).
 
-            Descentands are expected to override the method.
+            If the layout is known to be active already, the method does nothing, unless bell mode
+            is `always`: in such a case it just rings the bell, see `_ring()`. Actual activation is
+            performed by `_activate()`.
+
+            The completion handler is called when activation completes: before the method returns,
+            or later, from another thread, if the layouter is asynchronous. If the method throws,
+            the handler is called with failure before the exception leaves the method.
         **/
-        virtual void activate(
-            layout_t layout     ///< Index of the layout to activate.
-        ) = 0;
+        void activate(
+            layout_t layout,                ///< Index of the layout to activate.
+            ticket_t ticket = ticket_t()    ///< Data for the completion handler.
+        );
+
+        /**
+            Sets (or, if `nullptr`, resets) the activation completion handler. When the method
+            returns, the previous handler is not running and will not be called any more, so its
+            object can be safely destroyed even if activations are still in flight.
+        **/
+        void set_on_activated( on_activated_t handler );
+
+        /**
+            Returns the active layout, or `layout_t()` if the layouter does not know which layout
+            is active.
+        **/
+        layout_t active() const;
 
         /**
             Start layouter.
 
-            @param bell — If `true`, the bell is enabled, and disabled otherwise.
+            @param bell — Bell mode. If it is `enabled`, the bell rings when a layout is activated.
+            If it is `always`, the bell rings even if the requested layout is already active.
+
+            @param layouts — Layouts which are going to be activated. The layouter may prepare
+            everything required to activate these layouts in advance, so activation is faster.
+            Other layouts can be activated as well, but activation may be slower.
 
             @param handler — This function, if specified, will be called when user session changes
             its status from active to inactive and back.
@@ -155,7 +207,11 @@ class layouter_t {
             Note that `start()` is actually starts the user session status monitoring. Most of the
             methods can be called before `start()`.
         **/
-        void start( bool bell = false, on_event_t handler = nullptr );
+        void start(
+            settings_t::bell_t  bell     = settings_t::bell_t::disabled,
+            layouts_t const &   layouts  = layouts_t(),
+            on_event_t          handler  = nullptr
+        );
 
         /**
             Returns bell status: `true` is bell is enabled and `false` otherwise. It does not ring
@@ -170,6 +226,51 @@ class layouter_t {
         virtual void _start() {};
         virtual void _stop()  {};
 
+        /**
+            Activates the given layout and rings the bell if it is enabled. It is called by
+            `activate()`.
+
+            Descentands are expected to override the method.
+        **/
+        virtual void _activate( layout_t layout ) = 0;
+
+        /**
+            Rings the bell when the requested layout is already active and bell mode is `always`.
+            Default implementation calls `_activate()`, because some backends ring the bell only as
+            part of activation. If the decendant can ring the bell alone, it should override the
+            method.
+        **/
+        virtual void _ring( layout_t layout );
+
+        /**
+            Returns `true` if `_activate()` and `_ring()` only start activation and report its
+            completion by calling `_activated()`. Otherwise activation is completed when
+            `_activate()` or `_ring()` returns. Default implementation returns `false`.
+        **/
+        virtual bool _is_async();
+
+        /**
+            Asynchronous descendants call this method when activation completes. `ticket` is the
+            value returned by `_ticket()` when the activation was started.
+        **/
+        void _activated( layout_t layout, ticket_t ticket, bool failed );
+
+        /** Returns ticket of the activation being started by `_activate()` or `_ring()`. **/
+        ticket_t _ticket() const { return _ticket_; };
+
+        /**
+            Descendants which monitor layout changes call this method to report the active layout.
+            `layout_t()` means the active layout is not known (e. g. the monitoring is lost), so
+            the next activation will not be skipped.
+        **/
+        void _set_active( layout_t layout );
+
+        /**
+            Prepares activation of the given layouts, see `start()`. It is called before `_start()`,
+            when the bell status is already known. Default implementation does nothing.
+        **/
+        virtual void _prepare( layouts_t const & layouts );
+
         /**
             The returns keyboard repeat delay (amount of time the user has to hold a key down
             before the system will generate repeating key press events). Note that `repeat_delay`
@@ -208,10 +309,20 @@ class layouter_t {
 
         bool        _bell_ { false };
             ///< Bell status: bell is enabled (if `true`) or disabled (if `false`).
+        bool        _bell_always_ { false };
+            ///< Ring the bell even if the requested layout is already active.
+        std::atomic< layout_t::rep_t > _active_ { 0 };
+            ///< Index of the active layout reported by `_set_active`, 0 if not known.
         time_t      _repeat_delay_ { 0 };
             ///< Cached repeat delay returned by `_get_repeat_delay`.
         strings_p   _layout_names_;
             ///< Cached layout names returned by `_get_layout_names`.
+        ticket_t    _ticket_ {};
+            ///< Ticket of the activation being started, `activate()` is called by one thread.
+        std::mutex  _on_activated_mutex_;
+            ///< Guards `_on_activated_`: completions may come from another thread.
+        on_activated_t _on_activated_ { nullptr };
+            ///< Activation completion handler.
 
 }; // class layouter_t
 
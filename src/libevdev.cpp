@@ -183,6 +183,27 @@ uinput_t::write_event(
     };
 };
 
+void
+uinput_t::add_event(
+    events_t &      events,
+    event_type_t    type,
+    event_code_t    code,
+    int             value
+) {
+    ::input_event event = {};
+    event.type  = type;
+    event.code  = code;
+    event.value = value;
+    events.push_back( event );
+};
+
+void
+uinput_t::write_events(
+    events_t const & events
+) {
+    _file.write( events.data(), events.size() * sizeof( ::input_event ) );
+};
+
 }; // namespace libevdev
 }; // namespace tapper
 
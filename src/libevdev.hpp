@@ -37,6 +37,9 @@
 #include <functional>
 #include <initializer_list>
 #include <map>
+#include <vector>
+
+#include <linux/input.h>
 
 #include "posix.hpp"
 #include "linux.hpp"
@@ -109,6 +112,9 @@ namespace libevdev {
 
             typedef uinput_t myself_t;
 
+            /** Sequence of input events to be written at once. **/
+            using events_t = std::vector< ::input_event >;
+
             explicit uinput_t( evdev_t const & evdev );
             uinput_t( myself_t const & that ) = delete;
             uinput_t( myself_t && that );
@@ -121,6 +127,20 @@ namespace libevdev {
 
             void write_event( event_type_t type, event_code_t code, int value );
 
+            /**
+                Appends an event to `events`. Time is left zero: the kernel stamps events written
+                to uinput itself.
+            **/
+            static void add_event(
+                events_t & events, event_type_t type, event_code_t code, int value
+            );
+
+            /**
+                Writes all the events by a single `write` on the uinput file, so readers of the
+                device never see a partially written frame.
+            **/
+            void write_events( events_t const & events );
+
         private:
 
             posix::file_t       _file;
@@ -29,13 +29,17 @@
 
 #include "libinput.hpp"
 
+#include <errno.h>
 #include <fcntl.h>
 #include <libinput.h>
 #include <libudev.h>
-#include <poll.h>
+#include <linux/input.h>
+#include <sys/ioctl.h>
 #include <unistd.h>
 
+#include "latency.hpp"
 #include "privileges.hpp"
+#include "reactor.hpp"
 #include "string.hpp"
 #include "types.hpp"
 
@@ -83,6 +87,35 @@ udev_t::operator =(
 // class context_t
 // -------------------------------------------------------------------------------------------------
 
+/**
+    Returns `true` if the device (represented by opened file descriptor) can produce any of the
+    given keys (or buttons). If device capabilities can't be queried, the function returns `true`
+    to let libinput decide.
+**/
+static
+bool
+produces_any(
+    int             fd,
+    keys_t const &  keys
+) {
+    using bits_t = unsigned long;
+    auto const bits_per_item = 8 * sizeof( bits_t );
+    bits_t bits[ KEY_CNT / bits_per_item + 1 ] = { 0 };
+    if ( ioctl( fd, EVIOCGBIT( EV_KEY, sizeof( bits ) ), bits ) < 0 ) {
+        return true;
+    };
+    for ( auto key: keys ) {
+        auto code = key.code();
+        if ( code >= KEY_CNT ) {
+            continue;
+        };
+        if ( bits[ code / bits_per_item ] & ( 1UL << ( code % bits_per_item ) ) ) {
+            return true;
+        };
+    };
+    return false;
+};
+
 static
 int
 _open(
@@ -133,15 +166,12 @@ void _log_handler(
 static const libinput_interface _interface = { _open, _close };
 
 context_t::context_t(
-    on_event_t          on_event,
     string_t const &    seat,
     udev_t const &      udev
 ):
     OBJECT_T(),
     _rep( libinput_udev_create_context( & _interface, this, udev.rep ) ),
-    _on_event( on_event ),
-    _seat( seat ),
-    _thread( * this )
+    _seat( seat )
 {
     if ( not _rep ) {
         ERR( "Failed to initialize libinput context." );
@@ -165,13 +195,27 @@ context_t::~context_t(
 
 void
 context_t::enable(
+    on_events_t             on_events,
+    listener_t::devices_t & devices,
+    keys_t const &          keys
 ) {
+    _batch   = batch_t( on_events );
+    _devices = & devices;
+    _keys    = keys;
     int err = libinput_udev_assign_seat( _rep, _seat.c_str() );
     if ( err ) {
         ERR( "Failed to assign seat to libinput context." );
     };
-    _thread.start();
+    reactor().watch(
+        fd(), reactor_t::on_ready_t::make< context_t, & context_t::_dispatch >( this )
+    );
     _state = state_t::enabled;
+    /*
+        In the very beginning there are some add_device events in the queue. However, poll does not
+        sense them and will wait until the first "real" input event. It is not documented but
+        Libinput debug tools (event-debug and list-devices) are implemented in such way.
+    */
+    _dispatch();
 };
 
 void
@@ -182,12 +226,7 @@ context_t::disable(
             // Not enabled — nothing to do.
         } break;
         case state_t::enabled: {
-            /*
-                This code relies on the application (since signal disposition is process-wide):
-                Application should handle SIGINT signal to let ppoll be interrupted.
-            */
-            _thread.kill( SIGINT );
-            _thread.join();
+            reactor().unwatch( fd() );
             _state = state_t::disabled;
         } break;
         case state_t::disabled: {
@@ -212,6 +251,15 @@ context_t::open(
         file->open( path, flags );
     } );
     auto fd = file->fd();
+    if ( not _keys.empty() and not produces_any( fd, _keys ) ) {
+        /*
+            Touchscreens, tablets, accelerometers, lid switches, power buttons, etc: they can't
+            produce keys Tapper interested in, so there is no need to dispatch their events. Refuse
+            to open the device, libinput will ignore it.
+        */
+        DBG( "Device " << q( path ) << " can't produce interesting keys, ignored." );
+        return -ENODEV;
+    };
     _files[ fd ] = std::move( file );
     return fd;
 };
@@ -228,60 +276,77 @@ context_t::close(
     };
 };
 
-context_t::thread_t::thread_t(
-    context_t & context
-):
-    parent_t( "lictx" ),
-    _context( context )
-{
-};
-
+/**
+    Reads pending events from libinput and delivers keyboard and pointer button events to the
+    handler by one batch. Called by the reactor when the libinput fd is ready for reading.
+**/
 void
-context_t::thread_t::body(
+context_t::_dispatch(
 ) {
-    /*
-        In the very beginning there are some add_device events in the queue. However, poll does not
-        sense them and will wait until the first "real" input event. It is not documented but
-        Libinput debug tools (event-debug and list-devices) are implemented in such way.
-    */
-    struct pollfd pfd {
-        .fd      = _context.fd(),
-        .events  = POLLIN,
-        .revents = 0,
-    };
     for ( ; ; ) {
-        for ( ; ; ) {
-            int err = libinput_dispatch( _context._rep );
-            if ( err ) {
-                ERR( "Libinput dispatch failed: " << posix::syserrmsg( -err ) << "." );
-            };
-            event_t event( _context );
-            auto type = event.type();
-            if ( type == event_t::type_t::none ) {
-                break;
-            };
-            _context._on_event( event );
+        int err = libinput_dispatch( _rep );
+        if ( err ) {
+            ERR( "Libinput dispatch failed: " << posix::syserrmsg( -err ) << "." );
         };
-        int error = ::poll( & pfd, 1, -1 );
-        if ( error < 0 ) {
-            error = errno;
-            if ( error == EINTR ) { // Interrupted system call.
-                break;              // This is not an actual error, just exit the loop.
-            };
-            ERR( "Failed to poll fd #" << pfd.fd << ": " << posix::syserrmsg( error ) << "." );
+        event_t event( * this );
+        auto type = event.type();
+        if ( type == event_t::type_t::none ) {
+            break;
+        };
+        auto const device = listener_t::device_t(
+            uintptr_t( libinput_device_get_user_data( event.device() ) )
+        );
+        switch ( type ) {
+            case event_t::type_t::device_added: {
+                auto const added = _devices->add( libinput_device_get_name( event.device() ) );
+                libinput_device_set_user_data(
+                    event.device(), reinterpret_cast< void * >( uintptr_t( added ) )
+                );
+            } break;
+            case event_t::type_t::device_removed: {
+                _batch.remove( * _devices, device, latency_t::now() );
+            } break;
+            case event_t::type_t::keyboard_key: {
+                if ( _devices->policy( device ) == listener_t::device_policy_t::ignore ) {
+                    break;
+                };
+                auto kbev = event.keyboard();
+                _batch.push( {
+                    .time   = kbev.time(),
+                    .key    = kbev.key(),
+                    .state  = kbev.state(),
+                    .device = device,
+                } );
+            } break;
+            case event_t::type_t::pointer_button: {
+                if ( _devices->policy( device ) == listener_t::device_policy_t::ignore ) {
+                    break;
+                };
+                auto ptev = event.pointer();
+                _batch.push( {
+                    .time   = ptev.time(),
+                    .key    = ptev.button(),
+                    .state  = ptev.state(),
+                    .device = device,
+                } );
+            } break;
+            default: {
+                // Do nothing.
+            } break;
         };
     };
-};
+    _batch.flush();
+}; // _dispatch
 
 // -------------------------------------------------------------------------------------------------
 // keyboard_event_t
 // -------------------------------------------------------------------------------------------------
 
-time_t
+stamp_t
 context_t::keyboard_event_t::time(
 ) const {
-    auto time = libinput_event_keyboard_get_time( _rep );
-    STATIC_ASSERT( sizeof( time ) == sizeof( time_t ) );
+    auto time = libinput_event_keyboard_get_time_usec( _rep );
+    STATIC_ASSERT( sizeof( time ) == sizeof( stamp_t ) );
     return time;
 };
 
@@ -317,11 +382,11 @@ context_t::keyboard_event_t::keyboard_event_t(
 // pointer_event_t
 // -------------------------------------------------------------------------------------------------
 
-time_t
+stamp_t
 context_t::pointer_event_t::time(
 ) const {
-    auto time = libinput_event_pointer_get_time( _rep );
-    STATIC_ASSERT( sizeof( time ) == sizeof( time_t ) );
+    auto time = libinput_event_pointer_get_time_usec( _rep );
+    STATIC_ASSERT( sizeof( time ) == sizeof( stamp_t ) );
     return time;
 };
 
@@ -360,7 +425,6 @@ context_t::pointer_event_t::pointer_event_t(
 context_t::event_t::event_t(
     context_t & context
 ):
-    OBJECT_T(),
     _rep( libinput_get_event( context._rep ) )
 {
 };
@@ -387,6 +451,12 @@ context_t::event_t::keyboard(
     return keyboard_event_t( libinput_event_get_keyboard_event( _rep ) );
 };
 
+libinput_device *
+context_t::event_t::device(
+) const {
+    return libinput_event_get_device( _rep );
+};
+
 context_t::pointer_event_t
 context_t::event_t::pointer(
 ) const {
@@ -34,7 +34,6 @@
 
 #include "base.hpp"
 
-#include <functional>
 #include <map>
 
 #include <libinput.h>
@@ -97,7 +96,7 @@ namespace libinput {
             class keyboard_event_t {
                 friend class event_t;
                 public:
-                    time_t      time()  const;
+                    stamp_t     time()  const;
                     key_t       key()   const;
                     key_state_t state() const;
                 private:
@@ -112,7 +111,7 @@ namespace libinput {
             class pointer_event_t {
                 friend class event_t;
                 public:
-                    time_t      time()   const;
+                    stamp_t     time()   const;
                     key_t       button() const;
                     key_state_t state()  const;
                 private:
@@ -120,22 +119,31 @@ namespace libinput {
                     libinput_event_pointer * _rep { nullptr };
             };
 
-            class event_t: public object_t {
+            /**
+                libinput event. It is created for every input event, so unlike most Tapper classes
+                it is not an `object_t`: in debug build `object_t` allocates an id string.
+            **/
+            class event_t {
                 friend class context_t;
                 public:
+                    event_t( event_t const & ) = delete;
+                    event_t & operator =( event_t const & ) = delete;
                     /**
                         Only types used by Tapper are represented here. libinput has mamy more
                         event types, but they are out of Tapper interest.
                     **/
                     enum class type_t {
                         none           = LIBINPUT_EVENT_NONE,
+                        device_added   = LIBINPUT_EVENT_DEVICE_ADDED,
+                        device_removed = LIBINPUT_EVENT_DEVICE_REMOVED,
                         keyboard_key   = LIBINPUT_EVENT_KEYBOARD_KEY,
                         pointer_button = LIBINPUT_EVENT_POINTER_BUTTON,
                     };
                     type_t              type()     const;
                     keyboard_event_t    keyboard() const;
                     pointer_event_t     pointer()  const;
-                    time_t              time()     const;
+                    stamp_t             time()     const;
+                    libinput_device *   device()   const;
                 private:
                     explicit event_t( context_t & context );
                     ~event_t();
@@ -143,17 +151,31 @@ namespace libinput {
                     libinput_event * _rep;
             }; // class event_t
 
-            using on_event_t = std::function< void( event_t const & ) >;
+            /**
+                Keyboard key and pointer button events are converted to `listener_t::event_t`,
+                collected in a batch, and delivered by the reactor thread directly to the
+                listener's event handler when libinput has no more events, so a burst of input
+                events costs only one indirect call on its way to the tapper.
+
+                Every added libinput device is registered in the listener's devices table, its
+                index is kept in the device user data and marks the device's events. Events of
+                ignored devices are dropped before batching.
+            **/
+            using on_events_t = listener_t::on_events_t;
+            using batch_t     = listener_t::batch_t;
 
         public:
 
-            context_t(
-                on_event_t          on_event,
+            explicit context_t(
                 string_t const &    seat,
                 udev_t const &      udev = udev_t()
             );
             virtual ~context_t();
-            void enable();
+            void enable(
+                on_events_t             on_events,
+                listener_t::devices_t & devices,
+                keys_t const &          keys = keys_t()
+            );
             void disable();
             int fd();
             virtual int  open( string_t const & path, int flags );
@@ -171,25 +193,20 @@ namespace libinput {
                 disabled
             }; // enum state_t
 
-            class thread_t: public posix::thread_t {
-                using parent_t = posix::thread_t;
-                friend class context_t;
-                private:
-                    explicit thread_t( context_t & context );
-                    virtual void body() override;
-                private:
-                    context_t & _context;
-            };
-
             using files_t = std::map< int, ptr_t< posix::file_t > >;
 
         private:
 
-            on_event_t  _on_event;
-            state_t     _state { state_t::inited };
-            string_t    _seat;
-            thread_t    _thread;
-            files_t     _files;
+            void _dispatch();
+
+        private:
+
+            batch_t                 _batch;
+            listener_t::devices_t * _devices { nullptr };
+            state_t                 _state { state_t::inited };
+            string_t                _seat;
+            keys_t                  _keys;  ///< Devices which can't produce them are not opened.
+            files_t                 _files;
 
     }; // class context_t
 
@@ -0,0 +1,117 @@
+/*
+    ---------------------------------------------------------------------- copyright and license ---
+
+    File: src/listener-evdev.cpp
+
+    Copyright 🄯 2014, 2016—2017, 2019—2023 Van de Bugger.
+
+    This file is part of Tapper.
+
+    Tapper is free software: you can redistribute it and/or modify it under the terms of the GNU
+    General Public License as published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    Tapper is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+    even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along with Tapper.  If not,
+    see <https://www.gnu.org/licenses/>.
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+
+    ---------------------------------------------------------------------- copyright and license ---
+*/
+
+/** @file
+    `listener::evdev_t` class implementation.
+**/
+
+#include "listener-evdev.hpp"
+#include "listener-evdev.h"
+
+#include "linux.hpp"
+#include "posix.hpp"
+
+tapper::listener_t *
+listener_evdev_create(
+) {
+    THIS( nullptr );
+    DBG( "Creating evdev listener…" );
+    return new tapper::listener::evdev_t;
+};
+
+namespace tapper {
+namespace listener {
+
+// -------------------------------------------------------------------------------------------------
+// evdev_t
+// -------------------------------------------------------------------------------------------------
+
+evdev_t::evdev_t(
+):
+    OBJECT_T(),
+    _context(
+        posix::get_env( "XDG_SEAT", "seat0" )   // See comment in `libinput_t` constructor.
+    )
+{
+}; // ctor
+
+/** Returns `"evdev"`. **/
+string_t
+evdev_t::type(
+) {
+    return "evdev";
+}; // type
+
+key_t::range_t
+evdev_t::key_range(
+) {
+    return linux::key_range();
+}; // key_range
+
+keys_t
+evdev_t::keys(
+) {
+    return linux::keys();
+};
+
+key_t
+evdev_t::key(
+    string_t const & name
+) {
+    return linux::key( name );
+}; // key
+
+string_t
+evdev_t::key_name(
+    key_t key
+) {
+    return linux::key_name( key );
+}; // key_name
+
+strings_t
+evdev_t::key_names(
+    key_t key
+) {
+    return linux::key_names( key );
+}; // key_names
+
+void
+evdev_t::_start(
+) {
+    DBG( "Starting evdev listener…" );
+    _context.enable( _on_events, _devices );
+}; // _start
+
+void
+evdev_t::_stop(
+) {
+    DBG( "Stopping evdev listener…" );
+    _context.disable();
+}; // _stop
+
+}; // namespace listener
+}; // namespace tapper
+
+// end of file //
@@ -0,0 +1,84 @@
+/*
+    ---------------------------------------------------------------------- copyright and license ---
+
+    File: src/listener-evdev.hpp
+
+    Copyright 🄯 2014, 2016—2017, 2019—2023 Van de Bugger.
+
+    This file is part of Tapper.
+
+    Tapper is free software: you can redistribute it and/or modify it under the terms of the GNU
+    General Public License as published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    Tapper is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+    even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along with Tapper.  If not,
+    see <https://www.gnu.org/licenses/>.
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+
+    ---------------------------------------------------------------------- copyright and license ---
+*/
+
+/** @file
+    `listener::evdev_t` class interface.
+
+    @sa listener-evdev.cpp
+**/
+
+#ifndef _TAPPER_LISTENER_EVDEV_HPP_
+#define _TAPPER_LISTENER_EVDEV_HPP_
+
+#include "listener.hpp"
+
+#include "evdev.hpp"
+
+namespace tapper {
+namespace listener {
+
+// -------------------------------------------------------------------------------------------------
+// evdev_t
+// -------------------------------------------------------------------------------------------------
+
+/**
+    evdev listener. Reads key events directly from the kernel input devices, bypassing libinput.
+    Unlike libinput, the kernel is asked to deliver key events only, so the listener is not woken
+    up by pointer motions, touchpads, tablets, etc. Also, the listener reports autorepeated key
+    presses (which libinput hides).
+
+    The evdev listener works for both X Window System and Wayland, and requires the same
+    permissions as the libinput listener: the Tapper process must belong to the '`input`' group.
+**/
+class evdev_t: public object_t, public listener_t {
+
+    public:
+
+        explicit evdev_t();
+
+        virtual string_t       type()                       override;
+        virtual key_t::range_t key_range()                  override;
+        virtual keys_t         keys()                       override;
+        virtual key_t          key( string_t const & name ) override;
+        virtual string_t       key_name( key_t key )        override;
+        virtual strings_t      key_names( key_t key )       override;
+
+    protected:
+
+        virtual void           _start()                     override;
+        virtual void           _stop()                      override;
+
+    private:
+
+        evdev::context_t            _context;
+
+}; // class evdev_t
+
+}; // namespace listener
+}; // namespace tapper
+
+#endif // _TAPPER_LISTENER_EVDEV_HPP_
+
+// end of file //
@@ -52,7 +52,6 @@ libinput_t::libinput_t(
 ):
     OBJECT_T(),
     _context(
-        std::bind( & libinput_t::_on_intercept, this, std::placeholders::_1 ),
         posix::get_env( "XDG_SEAT", "seat0" ) /*
             Some platforms define XDG_SEAT environment variable, it looks I should use it. If the
             variable is not defined, use default value "seat0".
@@ -105,7 +104,7 @@ void
 libinput_t::_start(
 ) {
     DBG( "Starting libinput listener…" );
-    _context.enable();
+    _context.enable( _on_events, _devices, _keys );
 }; // _start
 
 void
@@ -115,33 +114,6 @@ libinput_t::_stop(
     _context.disable();
 }; // _stop
 
-void
-libinput_t::_on_intercept(
-    libinput::context_t::event_t const & event
-) {
-    switch ( event.type() ) {
-        case libinput::context_t::event_t::type_t::keyboard_key: {
-            auto kbev  = event.keyboard();
-            _on_event( {
-                .time  = kbev.time(),
-                .key   = kbev.key(),
-                .state = kbev.state(),
-            } );
-        } break;
-        case libinput::context_t::event_t::type_t::pointer_button: {
-            auto ptev   = event.pointer();
-            _on_event( {
-                .time  = ptev.time(),
-                .key   = ptev.button(),
-                .state = ptev.state(),
-            } );
-        } break;
-        default: {
-            // Do nothing.
-        } break;
-    };
-}; // on_intercept
-
 }; // namespace listener
 }; // namespace tapper
 
@@ -70,8 +70,6 @@ class libinput_t: public object_t, public listener_t {
 
     private:
 
-        void _on_intercept( libinput::context_t::event_t const & event );
-
         libinput::context_t         _context;
 
 }; // class libinput_t
@@ -0,0 +1,270 @@
+/*
+    ---------------------------------------------------------------------- copyright and license ---
+
+    File: src/listener-replay.cpp
+
+    Copyright 🄯 2014, 2016—2017, 2019—2023 Van de Bugger.
+
+    This file is part of Tapper.
+
+    Tapper is free software: you can redistribute it and/or modify it under the terms of the GNU
+    General Public License as published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    Tapper is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+    even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along with Tapper.  If not,
+    see <https://www.gnu.org/licenses/>.
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+
+    ---------------------------------------------------------------------- copyright and license ---
+*/
+
+/** @file
+    `listener::replay_t` class implementation.
+**/
+
+#include "listener-replay.hpp"
+#include "listener-replay.h"
+
+#include <algorithm>
+#include <cstdint>
+
+#include <errno.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "linux.hpp"
+#include "posix.hpp"
+#include "reactor.hpp"
+#include "string.hpp"
+
+tapper::listener_t *
+listener_replay_create(
+    char const * path
+) {
+    THIS( nullptr );
+    DBG( "Creating replay listener…" );
+    return new tapper::listener::replay_t( path );
+};
+
+namespace tapper {
+namespace listener {
+
+// -------------------------------------------------------------------------------------------------
+// replay_t
+// -------------------------------------------------------------------------------------------------
+
+replay_t::replay_t(
+    string_t const & path
+):
+    OBJECT_T(),
+    _reader( path )
+{
+    INF( "Input event log " << q( path ) << ": " << _reader.size() << " events." );
+}; // ctor
+
+/** Returns `"replay"`. **/
+string_t
+replay_t::type(
+) {
+    return "replay";
+}; // type
+
+/*
+    All the listeners report Linux kernel key codes, so recorded events have Linux key codes
+    regardless of the listener used for recording.
+*/
+
+key_t::range_t
+replay_t::key_range(
+) {
+    return linux::key_range();
+}; // key_range
+
+keys_t
+replay_t::keys(
+) {
+    return linux::keys();
+};
+
+key_t
+replay_t::key(
+    string_t const & name
+) {
+    return linux::key( name );
+}; // key
+
+string_t
+replay_t::key_name(
+    key_t key
+) {
+    return linux::key_name( key );
+}; // key_name
+
+strings_t
+replay_t::key_names(
+    key_t key
+) {
+    return linux::key_names( key );
+}; // key_names
+
+replay_t::~replay_t(
+) {
+    if ( _timer != -1 ) {
+        ::close( _timer );
+    };
+}; // dtor
+
+size_t
+replay_t::play(
+) {
+    assert( _on_events );
+    auto const size = _reader.size();
+    batch_t batch( _on_events );
+    for ( size_t i = 0; i < size; ++ i ) {
+        _push( batch, _reader.event( i ) );
+    };
+    batch.flush();
+    return size;
+}; // play
+
+void
+replay_t::schedule(
+    bool realtime
+) {
+    assert( _on_events );
+    _realtime = realtime;
+    _next     = 0;
+    if ( _reader.size() == 0 ) {
+        reactor().stop();
+        return;
+    };
+    if ( _timer == -1 ) {
+        _timer = timerfd_create( CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK );
+        if ( _timer == -1 ) {
+            int error = errno;
+            ERR( "Failed to create timerfd: " << posix::syserrmsg( error ) << "." );
+        };
+    };
+    clock_gettime( CLOCK_MONOTONIC, & _begin );
+    reactor().watch( _timer, reactor_t::on_ready_t::make< replay_t, & replay_t::_on_timer >( this ) );
+    _arm( _begin );
+}; // schedule
+
+size_t
+replay_t::played(
+) const {
+    return _next;
+}; // played
+
+void
+replay_t::_start(
+) {
+    DBG( "Starting replay listener…" );
+}; // _start
+
+void
+replay_t::_stop(
+) {
+    DBG( "Stopping replay listener…" );
+    if ( _timer != -1 ) {
+        reactor().unwatch( _timer );
+    };
+}; // _stop
+
+/** Delivers the next portion of events, then arms the timer for the next one, if any. **/
+void
+replay_t::_on_timer(
+) {
+    std::uint64_t expirations = 0;
+    if ( ::read( _timer, & expirations, sizeof( expirations ) ) != sizeof( expirations ) ) {
+        return;     // Spurious wakeup, e. g. the timer has been re-armed.
+    };
+    auto const size  = _reader.size();
+    auto const first = _reader.event( _next ).time;
+    size_t end = std::min( size, _next + chunk );
+    if ( _realtime ) {
+        // Events recorded at the same time are delivered by one batch.
+        end = _next + 1;
+        while ( end < size and _reader.event( end ).time == first ) {
+            ++ end;
+        };
+    };
+    batch_t batch( _on_events );
+    for ( ; _next < end; ++ _next ) {
+        _push( batch, _reader.event( _next ) );
+    };
+    batch.flush();
+    if ( _next == size ) {
+        reactor().unwatch( _timer );
+        reactor().stop();
+    } else if ( _realtime ) {
+        // Microseconds since the first event:
+        auto const offset = stamp_t( _reader.event( _next ).time - _reader.event( 0 ).time );
+        struct timespec due = _begin;
+        due.tv_sec  += offset / 1000000;
+        due.tv_nsec += long( offset % 1000000 ) * 1000;
+        if ( due.tv_nsec >= 1000000000 ) {
+            due.tv_sec  += 1;
+            due.tv_nsec -= 1000000000;
+        };
+        _arm( due );
+    } else {
+        // Let the reactor dispatch other descriptors (e. g. signals) before the next portion.
+        _arm( { .tv_sec = 0, .tv_nsec = 1 } );
+    };
+}; // _on_timer
+
+/** Arms the timer to expire at the given absolute time. A time in the past expires at once. **/
+void
+replay_t::_arm(
+    struct timespec const & due
+) {
+    struct itimerspec const spec { .it_interval = { 0, 0 }, .it_value = due };
+    if ( timerfd_settime( _timer, TFD_TIMER_ABSTIME, & spec, nullptr ) ) {
+        int error = errno;
+        ERR( "Failed to arm timerfd: " << posix::syserrmsg( error ) << "." );
+    };
+}; // _arm
+
+/** Pushes a recorded event to the batch, registering or removing its device if needed. **/
+void
+replay_t::_push(
+    batch_t &           batch,
+    event_t const &     event
+) {
+    if ( event.device == 0 or event.device >= devices_t::capacity ) {
+        // Unknown device.
+        if ( event.key.code() != key_t::none or event.device == 0 ) {
+            batch.push( { .time = event.time, .key = event.key, .state = event.state } );
+        };
+    } else {
+        auto & index = _indices[ event.device ];
+        if ( event.key.code() == key_t::none ) {
+            batch.remove( _devices, index, event.time );
+            index = 0;
+        } else {
+            if ( not index ) {
+                index = _devices.add( "#" + str( uint_t( event.device ) ) );
+            };
+            if ( _devices.policy( index ) != device_policy_t::ignore ) {
+                batch.push( {
+                    .time   = event.time,
+                    .key    = event.key,
+                    .state  = event.state,
+                    .device = index,
+                } );
+            };
+        };
+    };
+}; // _push
+
+}; // namespace listener
+}; // namespace tapper
+
+// end of file //
@@ -0,0 +1,132 @@
+/*
+    ---------------------------------------------------------------------- copyright and license ---
+
+    File: src/listener-replay.hpp
+
+    Copyright 🄯 2014, 2016—2017, 2019—2023 Van de Bugger.
+
+    This file is part of Tapper.
+
+    Tapper is free software: you can redistribute it and/or modify it under the terms of the GNU
+    General Public License as published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    Tapper is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+    even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along with Tapper.  If not,
+    see <https://www.gnu.org/licenses/>.
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+
+    ---------------------------------------------------------------------- copyright and license ---
+*/
+
+/** @file
+    `listener::replay_t` class interface.
+
+    @sa listener-replay.cpp
+**/
+
+#ifndef _TAPPER_LISTENER_REPLAY_HPP_
+#define _TAPPER_LISTENER_REPLAY_HPP_
+
+#include "listener.hpp"
+
+#include <time.h>
+
+#include "recording.hpp"
+
+namespace tapper {
+namespace listener {
+
+// -------------------------------------------------------------------------------------------------
+// replay_t
+// -------------------------------------------------------------------------------------------------
+
+/**
+    Replay listener. Instead of listening to input devices, it reads input events from a log
+    written by `recording::recorder_t`. The listener does not need any permissions, input devices,
+    or X Window System session, so it is suitable for regression testing and benchmarking.
+
+    The listener does not have its own thread: `schedule()` lets the reactor deliver events, so
+    signals stop a replay like any other run; `play()` delivers all the events by the calling
+    thread at once. Event times are delivered as recorded, so tap detection does not depend on
+    replay speed.
+
+    Logs do not keep device names, so a device is registered under the name `#`*index*, where
+    *index* is the device index in the log, when its first event is replayed. Thus, device policies
+    can be applied to replayed devices, e. g. `--state-only-device=#2`. Events of ignored devices
+    are dropped, like real listeners do.
+**/
+class replay_t: public object_t, public listener_t {
+
+    public:
+
+        explicit replay_t( string_t const & path );
+        virtual ~replay_t();
+
+        virtual string_t       type()                       override;
+        virtual key_t::range_t key_range()                  override;
+        virtual keys_t         keys()                       override;
+        virtual key_t          key( string_t const & name ) override;
+        virtual string_t       key_name( key_t key )        override;
+        virtual strings_t      key_names( key_t key )       override;
+
+        /**
+            Delivers all the recorded events to the handler as fast as possible, by full batches.
+            The listener must be started. Returns number of delivered events.
+        **/
+        size_t play();
+
+        /**
+            Lets the reactor deliver the recorded events to the handler and stop when all the
+            events are delivered. The listener must be started.
+
+            @param realtime — If `true`, events are delivered with the recorded intervals (but the
+            first event is delivered immediately), events recorded at the same time are delivered
+            by one batch. If `false`, events are delivered as fast as possible, but the reactor
+            dispatches other descriptors between portions of events.
+        **/
+        void schedule( bool realtime );
+
+        /**
+            Returns number of events delivered since `schedule()`. If the reactor has been stopped
+            by a signal, not all the events may be delivered.
+        **/
+        size_t played() const;
+
+    protected:
+
+        virtual void           _start()                     override;
+        virtual void           _stop()                      override;
+
+    private:
+
+        void _on_timer();
+        void _arm( struct timespec const & due );
+        void _push( batch_t & batch, event_t const & event );
+
+    private:
+
+        /** Max number of events delivered at once by `schedule( false )`. **/
+        static size_t constexpr chunk = 4096;
+
+        recording::reader_t    _reader;
+        int                    _timer    { -1 };    ///< `timerfd`, or -1 if not yet created.
+        bool                   _realtime { false };
+        size_t                 _next     { 0 };     ///< Index of the next event to deliver.
+        struct timespec        _begin    {};        ///< Time the first event was delivered at.
+
+        /** Indices of registered devices by device indices in the log, 0 if not registered. **/
+        device_t               _indices[ devices_t::capacity ] = {};
+
+}; // class replay_t
+
+}; // namespace listener
+}; // namespace tapper
+
+#endif // _TAPPER_LISTENER_REPLAY_HPP_
+
+// end of file //
@@ -0,0 +1,326 @@
+/*
+    ---------------------------------------------------------------------- copyright and license ---
+
+    File: src/listener-xi2.cpp
+
+    Copyright 🄯 2014, 2016—2017, 2019—2023 Van de Bugger.
+
+    This file is part of Tapper.
+
+    Tapper is free software: you can redistribute it and/or modify it under the terms of the GNU
+    General Public License as published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    Tapper is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+    even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along with Tapper.  If not,
+    see <https://www.gnu.org/licenses/>.
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+
+    ---------------------------------------------------------------------- copyright and license ---
+*/
+
+/** @file
+    `listener::xi2_t` class implementation.
+**/
+
+#include "listener-xi2.hpp"
+#include "listener-xi2.h"
+
+#include <cstdint>
+
+#include "latency.hpp"
+#include "reactor.hpp"
+
+tapper::listener_t *
+listener_xi2_create(
+) {
+    THIS( nullptr );
+    DBG( "Creating xi2 listener…" );
+    return new tapper::listener::xi2_t;
+};
+
+namespace tapper {
+namespace listener {
+
+// -------------------------------------------------------------------------------------------------
+// xi2_t
+// -------------------------------------------------------------------------------------------------
+
+size_t constexpr xi2_t::source_count;
+
+xi2_t::xi2_t(
+):
+    OBJECT_T(),
+    _keymap( _display ),
+    _sources()
+{
+    int event = 0;
+    int error = 0;
+    if ( not XQueryExtension( _display, "XInputExtension", & _opcode, & event, & error ) ) {
+        ERR( "XInput extension is not supported." );
+    };
+    /*
+        Version 2.1 or later should be announced: raw events are delivered to such clients even if
+        another client grabs the device, otherwise taps would be lost while a menu is open.
+    */
+    int major = 2;
+    int minor = 2;
+    auto status = XIQueryVersion( _display, & major, & minor );
+    if ( status != Success or major < 2 ) {
+        ERR( "XInput 2 is not supported (the server supports " << major << "." << minor << ")." );
+    };
+    DBG( "XInput extension version " << major << "." << minor << "." );
+}; // ctor
+
+/** Returns `"XInput2"`. **/
+string_t
+xi2_t::type(
+) {
+    return "XInput2";
+}; // type
+
+key_t::range_t
+xi2_t::key_range(
+) {
+    return _keymap.key_range();
+}; // key_range
+
+keys_t
+xi2_t::keys(
+) {
+    return _keymap.keys();
+}; // keys
+
+key_t
+xi2_t::key(
+    string_t const & name
+) {
+    return _keymap.key( name );
+}; // key
+
+string_t
+xi2_t::key_name(
+    key_t key
+) {
+    return _keymap.key_name( key );
+}; // key_name
+
+strings_t
+xi2_t::key_names(
+    key_t key
+) {
+    auto name = key_name( key );
+    return name.empty() ? strings_t{} : strings_t{ name };
+}; // key_names
+
+void
+xi2_t::_start(
+) {
+    _batch = batch_t( _on_events );
+    int count = 0;
+    auto const infos = XIQueryDevice( _display, XIAllDevices, & count );
+    for ( int i = 0; i < count; ++ i ) {
+        if ( infos[ i ].use == XISlaveKeyboard or infos[ i ].use == XISlavePointer ) {
+            _add_device( infos[ i ].deviceid );
+        };
+    };
+    XIFreeDeviceInfo( infos );
+    _select( true );
+    _display.flush();
+    reactor().watch(
+        _display.connection(), reactor_t::on_ready_t::make< xi2_t, & xi2_t::_on_ready >( this )
+    );
+    _on_ready();
+}; // _start
+
+void
+xi2_t::_stop(
+) {
+    reactor().unwatch( _display.connection() );
+    _select( false );
+    _display.sync();
+    for ( size_t id = 0; id < source_count; ++ id ) {
+        if ( _sources[ id ] ) {
+            _devices.remove( _sources[ id ] );  // The handler is not interested any more.
+            _sources[ id ] = 0;
+        };
+    };
+}; // _stop
+
+/**
+    Selects (or deselects) raw key and button events of all master devices on the root window. A
+    raw event of a master device tells the slave (physical) device in `sourceid`. Selecting events
+    of all the devices would deliver every event twice, from the slave and from its master. Device
+    hierarchy changes are selected for all the devices.
+**/
+void
+xi2_t::_select(
+    bool enable
+) {
+    unsigned char mask[ XIMaskLen( XI_LASTEVENT ) ] = {};
+    if ( enable ) {
+        XISetMask( mask, XI_RawKeyPress );
+        XISetMask( mask, XI_RawKeyRelease );
+        XISetMask( mask, XI_RawButtonPress );
+        XISetMask( mask, XI_RawButtonRelease );
+    };
+    unsigned char hierarchy[ XIMaskLen( XI_LASTEVENT ) ] = {};
+    if ( enable ) {
+        XISetMask( hierarchy, XI_HierarchyChanged );
+    };
+    XIEventMask events[ 2 ];
+    events[ 0 ].deviceid = XIAllMasterDevices;
+    events[ 0 ].mask_len = sizeof( mask );
+    events[ 0 ].mask     = mask;
+    events[ 1 ].deviceid = XIAllDevices;
+    events[ 1 ].mask_len = sizeof( hierarchy );
+    events[ 1 ].mask     = hierarchy;
+    auto status = XISelectEvents( _display, XDefaultRootWindow( _display ), events, 2 );
+    if ( status != Success ) {
+        ERR( "Selecting XInput raw events failed." );
+    };
+}; // _select
+
+/** Registers the X input device in the devices table. **/
+void
+xi2_t::_add_device(
+    int id
+) {
+    if ( id < 0 or size_t( id ) >= source_count or _sources[ id ] ) {
+        return;
+    };
+    int count = 0;
+    auto const info = XIQueryDevice( _display, id, & count );
+    if ( info and count > 0 ) {
+        _sources[ id ] = _devices.add( info[ 0 ].name );
+    };
+    XIFreeDeviceInfo( info );
+}; // _add_device
+
+/** Unregisters the X input device and reports its removal to the handler. **/
+void
+xi2_t::_remove_device(
+    int id
+) {
+    if ( id < 0 or size_t( id ) >= source_count or not _sources[ id ] ) {
+        return;
+    };
+    _batch.remove( _devices, _sources[ id ], latency_t::now() );
+    _sources[ id ] = 0;
+}; // _remove_device
+
+/**
+    Processes events which are already received. Called by the reactor when the connection is
+    ready for reading. Xlib may have read events while waiting for a reply, so all the queued
+    events are processed, not only those which made the connection ready.
+**/
+void
+xi2_t::_on_ready(
+) {
+    while ( XPending( _display ) ) {
+        XEvent event;
+        XNextEvent( _display, & event );
+        auto & cookie = event.xcookie;
+        if (
+            cookie.type == GenericEvent and cookie.extension == _opcode
+            and XGetEventData( _display, & cookie )
+        ) {
+            auto what = CATCH_ALL(
+                if ( cookie.evtype == XI_HierarchyChanged ) {
+                    _on_hierarchy( * static_cast< XIHierarchyEvent const * >( cookie.data ) );
+                } else {
+                    _on_raw_event( * static_cast< XIRawEvent const * >( cookie.data ) );
+                };
+            );
+            XFreeEventData( _display, & cookie );
+            if ( not what.empty() ) {
+                ERR( what );
+            };
+        };
+    };
+    _batch.flush();
+    _display.check();
+}; // _on_ready
+
+/** Follows slave devices being added and removed. **/
+void
+xi2_t::_on_hierarchy(
+    XIHierarchyEvent const & event
+) {
+    for ( int i = 0; i < event.num_info; ++ i ) {
+        auto const & info = event.info[ i ];
+        if ( info.flags & XISlaveRemoved ) {
+            _remove_device( info.deviceid );
+        } else if (
+            info.flags & XISlaveAdded
+            and ( info.use == XISlaveKeyboard or info.use == XISlavePointer )
+        ) {
+            _add_device( info.deviceid );
+        };
+    };
+}; // _on_hierarchy
+
+/**
+    Converts a raw event to a listener event. Raw events carry key codes and button numbers as the
+    device reported them, before the button mapping is applied. X key codes are converted to Linux
+    key codes the same way as by the XRecord listener.
+**/
+void
+xi2_t::_on_raw_event(
+    XIRawEvent const & event
+) {
+    DBG(
+        "Raw event " << event.evtype << ", detail " << event.detail << ", "
+            << "device " << event.deviceid << ", source " << event.sourceid << "."
+    );
+    /*
+        Raw event time is X server time, see `xrecord_t::on_intercept()`.
+    */
+    auto const time = latency_t::unwrap( std::uint32_t( event.time ), latency_t::now() );
+    auto const device =
+        0 <= event.sourceid and size_t( event.sourceid ) < source_count ?
+            _sources[ event.sourceid ] : device_t( 0 );
+    if ( _devices.policy( device ) == device_policy_t::ignore ) {
+        return;
+    };
+    switch ( event.evtype ) {
+        case XI_RawKeyPress:
+        case XI_RawKeyRelease: {
+            if ( x::key_t::min <= event.detail and event.detail <= x::key_t::max ) {
+                _batch.push( {
+                    .time   = time,
+                    .key    = x::key_t( event.detail ).linux(),
+                    .state  = key_state( event.evtype == XI_RawKeyPress ),
+                    .device = device,
+                } );
+            };
+        } break;
+        case XI_RawButtonPress:
+        case XI_RawButtonRelease: {
+            /*
+                Mouse wheel rotation is reported as buttons 4…7, `linux()` returns key with zero
+                code for them.
+            */
+            if ( x::btn_t::min <= event.detail and event.detail <= x::btn_t::max ) {
+                auto key = x::btn_t( event.detail ).linux();
+                if ( key.code() ) {
+                    _batch.push( {
+                        .time   = time,
+                        .key    = key,
+                        .state  = key_state( event.evtype == XI_RawButtonPress ),
+                        .device = device,
+                    } );
+                };
+            };
+        } break;
+    };
+}; // _on_raw_event
+
+}; // namespace listener
+}; // namespace tapper
+
+// end of file //
@@ -0,0 +1,103 @@
+/*
+    ---------------------------------------------------------------------- copyright and license ---
+
+    File: src/listener-xi2.hpp
+
+    Copyright 🄯 2014, 2016—2017, 2019—2023 Van de Bugger.
+
+    This file is part of Tapper.
+
+    Tapper is free software: you can redistribute it and/or modify it under the terms of the GNU
+    General Public License as published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    Tapper is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+    even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along with Tapper.  If not,
+    see <https://www.gnu.org/licenses/>.
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+
+    ---------------------------------------------------------------------- copyright and license ---
+*/
+
+/** @file
+    `listener::xi2_t` class interface.
+
+    @sa listener-xi2.cpp
+**/
+
+#ifndef _TAPPER_LISTENER_XI2_HPP_
+#define _TAPPER_LISTENER_XI2_HPP_
+
+#include "base.hpp"
+#include "listener.hpp"
+
+#include <X11/extensions/XInput2.h>
+
+#include "x.hpp"
+
+namespace tapper {
+namespace listener {
+
+// -------------------------------------------------------------------------------------------------
+// xi2_t
+// -------------------------------------------------------------------------------------------------
+
+/**
+    XInput2 listener. It selects raw key and button events (`XI_RawKeyPress`, `XI_RawKeyRelease`,
+    `XI_RawButtonPress`, `XI_RawButtonRelease`) on the root window and reads them from a single
+    display connection watched by the reactor. Unlike XRecord, the server does not have to copy
+    every event to a recording client, and events tell the source device. Like XRecord, it
+    requires X Window System and does not work in Wayland, but does not require extra
+    permissions.
+
+    Slave keyboards and pointers are registered in the devices table by name; the listener also
+    selects `XI_HierarchyChanged` events to follow devices being plugged and unplugged.
+**/
+class xi2_t: public object_t, public listener_t {
+
+    public:
+
+        explicit xi2_t();
+
+        virtual string_t            type()                       override;
+        virtual key_t::range_t      key_range()                  override;
+        virtual keys_t              keys()                       override;
+        virtual key_t               key( string_t const & name ) override;
+        virtual string_t            key_name( key_t key )        override;
+        virtual strings_t           key_names( key_t key )       override;
+
+    protected:
+
+        virtual void                _start()                     override;
+        virtual void                _stop()                      override;
+
+    private:
+
+        /** Number of possible X input device ids. **/
+        static size_t constexpr source_count = 256;
+
+        void                _select( bool enable );
+        void                _add_device( int id );
+        void                _remove_device( int id );
+        void                _on_ready();
+        void                _on_hierarchy( XIHierarchyEvent const & event );
+        void                _on_raw_event( XIRawEvent const & event );
+
+        x::display_t        _display;
+        x::keymap_t         _keymap;
+        int                 _opcode { 0 };      ///< Major opcode of XInputExtension.
+        batch_t             _batch;
+        device_t            _sources[ source_count ];   ///< Device indices, by X device id.
+
+}; // class xi2_t
+
+}; // namespace listener
+}; // namespace tapper
+
+#endif // _TAPPER_LISTENER_XI2_HPP_
+
+// end of file //
@@ -35,6 +35,7 @@
 #include <byteswap.h>       // bswap_64
 #include <X11/Xproto.h>     // xEvent
 
+#include "latency.hpp"
 #include "string.hpp"
 #include "test.hpp"
 
@@ -56,7 +57,11 @@ namespace listener {
 xrecord_t::xrecord_t(
 ):
     OBJECT_T(),
-    _context( std::bind( & xrecord_t::on_intercept, this, std::placeholders::_1 ) )
+    _context(
+        std::bind( & xrecord_t::on_intercept, this, std::placeholders::_1 ),
+        std::bind( & xrecord_t::on_processed, this )
+    ),
+    _keymap( _context.display() )
 {
 }; // ctor
 
@@ -70,69 +75,27 @@ xrecord_t::type(
 key_t::range_t
 xrecord_t::key_range(
 ) {
-    if ( not _key_range ) {
-        /*
-            Get Xkb key range.
-        */
-        auto xkb_range = kb_desc().key_range();
-        // Convert Xkb key range to Tapper key range:
-        auto range = key_t::range_t(
-            x::key_t( xkb_range.min ).linux().code(),
-            x::key_t( xkb_range.max ).linux().code()
-        );
-        DBG( "XRecord interceptor key range: " << range << " (keys only)." );
-        /*
-            Extend key range with button codes. X button codes are sequential from `x::button_min`
-            to `x::button_max`, but corresponding Linux key codes may or may not be sequential, so
-            range `key_range_t( x::button( x::button_min ), x::button( x::button_max ) )` may be
-            invalid. Let's add buttons one-by-one.
-        */
-        for ( size_t code = x::btn_t::min; code <= x::btn_t::max; ++ code ) {
-            auto key = x::btn_t( code ).linux();
-            if ( key.code() ) {
-                range += key.code();
-            };
-        };
-        DBG( "XRecord interceptor key range: " << range << " (keys and buttons)." );
-        assert( range.is_valid() );
-        _key_range.reset( new key_t::range_t( range ) );
-    };
-    return * _key_range.get();
+    return _keymap.key_range();
 }; // key_range
 
 keys_t
 xrecord_t::keys(
 ) {
-    keys_t keys;
-    for ( auto key: key2name() ) {
-        keys.insert( key.first );
-    };
-    return keys;
+    return _keymap.keys();
 };
 
 key_t
 xrecord_t::key(
     string_t const & name
 ) {
-    auto & map = name2key();
-    auto it = map.find( uc( name ) );
-    if ( it == map.end() ) {
-        return key_t();         // TODO: Exception?
-    };
-    return it->second;
+    return _keymap.key( name );
 }; // key
 
 string_t
 xrecord_t::key_name(
     key_t key
 ) {
-    key_range().check( key );
-    auto const & map = key2name();
-    auto it = map.find( key );
-    if ( it == map.end() ) {
-        return "";
-    };
-    return it->second;
+    return _keymap.key_name( key );
 }; // key_name
 
 strings_t
@@ -146,6 +109,7 @@ xrecord_t::key_names(
 void
 xrecord_t::_start(
 ) {
+    _batch = batch_t( _on_events );
     _context.enable();
 }; // _start
 
@@ -155,84 +119,6 @@ xrecord_t::_stop(
     _context.disable();
 }; // _stop
 
-x::kb_t &
-xrecord_t::kb(
-) {
-    if ( not _kb ) {
-        _kb.reset( new x::kb_t( _context.display() ) );
-    };
-    return * _kb.get();
-}; // kb
-
-x::kb_t::desc_t &
-xrecord_t::kb_desc(
-) {
-    if ( not _kb_desc ) {
-        _kb_desc = kb().desc();
-    };
-    return * _kb_desc.get();
-}; // kb_desc
-
-strings_t const &
-xrecord_t::key_names(
-) {
-    if ( not _key_names ) {
-        _key_names.reset( new strings_t( kb_desc().key_names() ) );
-    };
-    return * _key_names.get();
-}; // key_names
-
-xrecord_t::key2name_t const &
-xrecord_t::key2name(
-) {
-    if ( not _key2name ) {
-        key2name_t map;
-        auto const & names = key_names();
-        for ( size_t i = 0, end = names.size(); i < end; ++ i ) {
-            auto const & name = names[ i ];
-            if ( not name.empty() ) {
-                auto key = x::key_t( i ).linux();
-                map.insert( { key, name } );
-                // Indices are unique, so there is no need to check that insertion was successful.
-            };
-        };
-        for ( auto code = x::btn_t::min; code <= x::btn_t::max; ++ code ) {
-            auto key = x::btn_t( code ).linux();
-            if ( key.code() ) {
-                auto name = STR( "BTN" << code );
-                auto ok = map.insert( { key, name } ).second;
-                assert( ok );   // Just in case.
-                static_cast< void >( ok );
-            };
-        };
-        _key2name.reset( new key2name_t( std::move( map ) ) );
-    };
-    return * _key2name.get();
-}; // key2name
-
-xrecord_t::name2key_t const &
-xrecord_t::name2key(
-) {
-    if ( not _name2key ) {
-        name2key_t map;
-        for ( auto const & it: key2name() ) {
-            auto ok = map.insert( { it.second, it.first } ).second;
-            if ( not ok ) {
-                auto name = it.second;
-                auto k1   = map[ it.second ];
-                auto k2   = it.first;
-                WRN(
-                    "X Window System reported non-unique key name " << q( name ) << " "
-                        "for keys " << k1 << " and " << k2 << "; "
-                        "the first code will be used for this key name."
-                );
-            };
-        };
-        _name2key.reset( new name2key_t( map ) );
-    };
-    return * _name2key.get();
-}; // name2key
-
 void
 xrecord_t::on_intercept(
     XRecordInterceptData const * data
@@ -272,7 +158,12 @@ xrecord_t::on_intercept(
                 STATIC_ASSERT( sizeof( time ) == 4 );
                 time = bswap_32( time );
             };
-            return time;
+            /*
+                X server time is milliseconds of the monotonic clock truncated to 32 bits (at
+                least, Xorg and Xwayland read `CLOCK_MONOTONIC`), so it can be correlated with the
+                current time stamp. Precision is still one millisecond, though.
+            */
+            return latency_t::unwrap( time, latency_t::now() );
         };
 
         auto type = get_x_event_type();
@@ -281,7 +172,7 @@ xrecord_t::on_intercept(
             case KeyPress:
             case KeyRelease: {
                 auto key = get_x_event_key().linux();
-                _on_event( {
+                _batch.push( {
                     .time  = get_x_event_time(),
                     .key   = key,
                     .state = key_state( type == KeyPress ),
@@ -293,11 +184,11 @@ xrecord_t::on_intercept(
                     X Window System reports mouse wheel rotation as mouse buttons 4, 5, 6, and 7
                     press and release events. For these events `linux()` method returns key with
                     zero code, so I have to make sure the code is not zero before calling
-                    `_on_event()`.
+                    `_batch.push()`.
                 */
                 auto key = get_x_event_button().linux();
                 if ( key.code() ) {
-                    _on_event( {
+                    _batch.push( {
                         .time  = get_x_event_time(),
                         .key   = key,
                         .state = key_state( type == ButtonPress ),
@@ -309,6 +200,13 @@ xrecord_t::on_intercept(
     }; // if
 }; // on_intercept
 
+/** Delivers events intercepted at one wakeup to the handler. **/
+void
+xrecord_t::on_processed(
+) {
+    _batch.flush();
+}; // on_processed
+
 }; // namespace listener
 }; // namespace tapper
 
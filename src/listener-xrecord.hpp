@@ -69,27 +69,12 @@ class xrecord_t: public object_t, public listener_t {
 
     private:
 
-        using strings_p  = ptr_t< strings_t >;
-        using key2name_t = std::map< key_t, string_t >;
-        using key2name_p = ptr_t< key2name_t >;
-        using name2key_t = std::map< string_t, key_t >;
-        using name2key_p = ptr_t< name2key_t >;
-
-        x::kb_t &          kb();
-        x::kb_t::desc_t &  kb_desc();
-        strings_t const &  key_names();
-        key2name_t const & key2name();
-        name2key_t const & name2key();
-
-        void               on_intercept( XRecordInterceptData const * data );
+        void                on_intercept( XRecordInterceptData const * data );
+        void                on_processed();
 
         x::record::context_t    _context;
-        x::kb_p                 _kb;
-        x::kb_t::desc_p         _kb_desc;
-        key_t::range_p          _key_range;
-        strings_p               _key_names;
-        key2name_p              _key2name;
-        name2key_p              _name2key;
+        x::keymap_t             _keymap;
+        batch_t                 _batch;
 
 }; // class xrecord_t
 
@@ -29,15 +29,154 @@
 
 #include "listener.hpp"
 
+#include "string.hpp"
+#include "test.hpp"
+
 #if WITH_LIBINPUT
+    #include "listener-evdev.h"
     #include "listener-libinput.h"
 #endif // WITH_LIBINPUT
 #if WITH_X
+    #include "listener-xi2.h"
     #include "listener-xrecord.h"
 #endif // WITH_X
 
 namespace tapper {
 
+// -------------------------------------------------------------------------------------------------
+// callback_t
+// -------------------------------------------------------------------------------------------------
+
+namespace {
+
+struct summator_t {
+    int sum { 0 };
+    void add( int value ) { sum += value; };
+};
+
+}; // namespace
+
+TEST(
+    summator_t summator;
+    t::callback_t< int > callback;
+    ASSERT( not callback );
+    callback = t::callback_t< int >::make< summator_t, & summator_t::add >( & summator );
+    ASSERT( bool( callback ) );
+    callback( 2 );
+    callback( 3 );
+    ASSERT_EQ( summator.sum, 5 );
+    callback = nullptr;
+    ASSERT( not callback );
+);
+
+// -------------------------------------------------------------------------------------------------
+// devices_t
+// -------------------------------------------------------------------------------------------------
+
+size_t constexpr listener_t::devices_t::capacity;
+
+listener_t::devices_t::devices_t(
+):
+    OBJECT_T(),
+    _names( capacity )
+{
+    for ( size_t i = 0; i < capacity; ++ i ) {
+        _policies[ i ] = device_policy_t::normal;
+        _used[ i ]     = false;
+    };
+    _used[ 0 ] = true;      // Unknown device is always "used".
+}; // ctor
+
+void
+listener_t::devices_t::set_policies(
+    device_policies_t const & policies
+) {
+    _by_name = policies;
+};
+
+listener_t::device_t
+listener_t::devices_t::add(
+    string_t const & name
+) {
+    device_t device = 0;
+    for ( size_t i = 1; i < capacity; ++ i ) {
+        if ( not _used[ i ] ) {
+            device = device_t( i );
+            break;
+        };
+    };
+    if ( not device ) {
+        WRN( "Too many input devices, " << q( name ) << " is not tracked separately." );
+        return 0;
+    };
+    auto const it = _by_name.find( name );
+    auto const policy = it == _by_name.end() ? device_policy_t::normal : it->second;
+    _used[ device ]     = true;
+    _names[ device ]    = name;
+    _policies[ device ] = policy;
+    if ( policy != device_policy_t::normal ) {
+        INF( "Input device " << q( name ) << ": " << policy << "." );
+    };
+    DBG( "Device #" << uint_t( device ) << " added: " << q( name ) << "." );
+    return device;
+};
+
+void
+listener_t::devices_t::remove(
+    device_t device
+) {
+    if ( device == 0 or device >= capacity ) {
+        return;
+    };
+    DBG( "Device #" << uint_t( device ) << " removed: " << q( _names[ device ] ) << "." );
+    _used[ device ]     = false;
+    _names[ device ].clear();
+    _policies[ device ] = device_policy_t::normal;
+};
+
+string_t
+listener_t::devices_t::name(
+    device_t device
+) const {
+    return device < capacity ? _names[ device ] : string_t();
+};
+
+TEST(
+    using policy_t = listener_t::device_policy_t;
+    listener_t::devices_t devices;
+    devices.set_policies( { { "mouse", policy_t::state_only }, { "pedal", policy_t::ignore } } );
+    ASSERT( devices.policy( 0 ) == policy_t::normal );
+    auto const keyboard = devices.add( "keyboard" );
+    auto const mouse    = devices.add( "mouse" );
+    auto const pedal    = devices.add( "pedal" );
+    ASSERT_EQ( uint_t( keyboard ), 1U );
+    ASSERT_EQ( uint_t( mouse ), 2U );
+    ASSERT( devices.policy( keyboard ) == policy_t::normal );
+    ASSERT( devices.policy( mouse ) == policy_t::state_only );
+    ASSERT( devices.policy( pedal ) == policy_t::ignore );
+    ASSERT_EQ( devices.name( mouse ), "mouse" );
+    devices.remove( mouse );
+    ASSERT( devices.policy( mouse ) == policy_t::normal );
+    ASSERT( devices.add( "keyboard" ) == mouse );         // Free index is reused.
+    ASSERT( devices.policy( 1000 ) == policy_t::normal );
+);
+
+string_t
+str(
+    listener_t::device_policy_t policy
+) {
+    switch ( policy ) {
+        case listener_t::device_policy_t::normal:     return "normal";
+        case listener_t::device_policy_t::state_only: return "state-only";
+        case listener_t::device_policy_t::ignore:     return "ignore";
+    };
+    return "(* unknown device policy #" + str( int( policy ) ) + " *)";
+};
+
+// -------------------------------------------------------------------------------------------------
+// listener_t
+// -------------------------------------------------------------------------------------------------
+
 key_state_t
 listener_t::key_state(
     bool pressed
@@ -67,6 +206,16 @@ listener_t::create(
                 listener = listener_xrecord_create();
             #endif // WITH_X
         } break;
+        case settings_t::listener_t::evdev: {
+            #if WITH_LIBINPUT
+                listener = listener_evdev_create();
+            #endif // WITH_LIBINPUT
+        } break;
+        case settings_t::listener_t::xi2: {
+            #if WITH_X
+                listener = listener_xi2_create();
+            #endif // WITH_X
+        } break;
     };
     if ( not listener ) {
         ERR( "No listeners available." );
@@ -84,19 +233,111 @@ listener_t::key_full_name(
 
 void
 listener_t::start(
-    on_event_t handler
+    on_events_t     handler,
+    keys_t const &  keys
 ) {
-    _on_event = handler;
+    _on_events = handler;
+    _keys      = keys;
     _start();
 };
 
+void
+listener_t::start(
+    on_event_t      handler,
+    keys_t const &  keys
+) {
+    _on_event = handler;
+    start( on_events_t::make< listener_t, & listener_t::_deliver >( this ), keys );
+};
+
+void
+listener_t::set_device_policies(
+    device_policies_t const & policies
+) {
+    _devices.set_policies( policies );
+};
+
 void
 listener_t::stop(
 ) {
     _stop();
-    _on_event = nullptr;
+    _on_events = nullptr;
+    _on_event  = nullptr;
 };
 
+/** Passes events of the batch to the per-event handler one by one. **/
+void
+listener_t::_deliver(
+    event_t const * events,
+    size_t          count
+) {
+    for ( size_t i = 0; i < count; ++ i ) {
+        _on_event( events[ i ] );
+    };
+};
+
+// -------------------------------------------------------------------------------------------------
+// batch_t
+// -------------------------------------------------------------------------------------------------
+
+void
+listener_t::batch_t::remove(
+    devices_t & devices,
+    device_t    device,
+    stamp_t     time
+) {
+    if ( device == 0 ) {
+        return;
+    };
+    push( { .time = time, .key = key_t(), .state = key_state_t::released, .device = device } );
+    flush();
+    devices.remove( device );
+}; // remove
+
+namespace {
+
+struct collector_t {
+    size_t calls  { 0 };
+    size_t events { 0 };
+    void add( listener_t::event_t const *, size_t count ) { ++ calls; events += count; };
+};
+
+}; // namespace
+
+TEST(
+    using batch_t = listener_t::batch_t;
+    collector_t collector;
+    batch_t batch(
+        listener_t::on_events_t::make< collector_t, & collector_t::add >( & collector )
+    );
+    listener_t::event_t const event { 0, key_t( 1 ), key_state_t::pressed };
+    batch.flush();                          // Empty batch is not delivered.
+    ASSERT_EQ( collector.calls, 0u );
+    for ( size_t i = 0; i < 3; ++ i ) {
+        batch.push( event );
+    };
+    ASSERT_EQ( collector.calls, 0u );
+    batch.flush();
+    ASSERT_EQ( collector.calls, 1u );
+    ASSERT_EQ( collector.events, 3u );
+    for ( size_t i = 0; i <= batch_t::capacity; ++ i ) {
+        batch.push( event );                // Full batch is delivered immediately.
+    };
+    ASSERT_EQ( collector.calls, 2u );
+    batch.flush();
+    ASSERT_EQ( collector.calls, 3u );
+    ASSERT_EQ( collector.events, 3 + batch_t::capacity + 1 );
+    listener_t::devices_t devices;
+    auto const device = devices.add( "keyboard" );
+    batch.push( event );
+    batch.remove( devices, device, 0 );     // Removal event is delivered with pending events.
+    ASSERT_EQ( collector.calls, 4u );
+    ASSERT_EQ( collector.events, 3 + batch_t::capacity + 1 + 2 );
+    ASSERT_EQ( devices.name( device ), "" );
+    batch.remove( devices, 0, 0 );          // Unknown device can't be removed.
+    ASSERT_EQ( collector.calls, 4u );
+);
+
 }; // namespace tapper
 
 // end of file //
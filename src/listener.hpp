@@ -34,8 +34,10 @@
 
 #include "base.hpp"
 
-#include <functional>
+#include <cstdint>
+#include <map>
 
+#include "callback.hpp"
 #include "settings.hpp"
 
 namespace tapper {
@@ -66,17 +68,142 @@ class listener_t {
         */
         key_state_t key_state( bool pressed );
 
-        /** Keyboard event, either key (or button) press or release. **/
+        /**
+            Input device index, see `devices_t`. 0 means the device is not known: the listener
+            can't tell devices apart, or there are too many devices.
+        **/
+        using device_t = std::uint16_t;
+
+        /** What the tapper does with events of an input device. **/
+        enum class device_policy_t: std::uint8_t {
+            normal,         ///< Events make and break taps.
+            state_only,     ///< Only the key state of the device is tracked, see `tapper_t`.
+            ignore,         ///< Events are dropped by the listener.
+            max = ignore,
+        };
+
+        using device_policies_t = std::map< string_t, device_policy_t >;
+
+        /**
+            Keyboard event, either key (or button) press or release. An event with no key
+            (`key_t::none`) of a known device reports the device is removed: keys held on the
+            device will never be released.
+        **/
         struct event_t {
-            time_t      time;   ///< Time when the event occurred, in milliseconds.
+            stamp_t     time;   ///< Time when the event occurred, in µs of the monotonic clock.
             key_t       key;    ///< Key which state was changed.
             key_state_t state;  ///< New state of the key.
+            device_t    device; ///< Device which reported the event.
         };
 
         /**
-            Type of function called on every keyboard event.
+            Input devices known to the listener. A listener which can tell devices apart `add()`s
+            a device when the device appears, and marks events of the device with the returned
+            index. The device policy is looked up by the device name when the device is added, and
+            kept in a fixed array, so the policy of an event's device costs a single indexed load.
+        **/
+        class devices_t: public object_t {
+
+            public:
+
+                /** Max number of devices, including the unknown device 0. **/
+                static size_t constexpr capacity = 64;
+
+                devices_t();
+
+                /** Sets policies of devices by name. Should be called before devices are added. **/
+                void set_policies( device_policies_t const & policies );
+
+                /**
+                    Registers a device. Returns its index, or 0 if there are too many devices. Use
+                    `policy()` to learn what to do with the device.
+                **/
+                device_t add( string_t const & name );
+
+                /** Unregisters a device, its index may be reused. **/
+                void remove( device_t device );
+
+                /** Returns policy of the device. Devices out of range are unknown. **/
+                device_policy_t policy( device_t device ) const {
+                    return _policies[ device < capacity ? device : 0 ];
+                };
+
+                /** Returns name of the device, empty if the device is unknown. **/
+                string_t name( device_t device ) const;
+
+            private:
+
+                device_policies_t   _by_name;
+                device_policy_t     _policies[ capacity ];
+                strings_t           _names;
+                bool                _used[ capacity ];
+
+        }; // class devices_t
+
+        /**
+            Type of function called on every keyboard event. It is called on every event, so it
+            is a non-allocating callback rather than `std::function`.
         **/
-        using on_event_t = std::function< void( event_t const & ) >;
+        using on_event_t = t::callback_t< event_t const & >;
+
+        /**
+            Type of function called on every batch of keyboard events. A listener reads input in
+            bulk, and delivers all the events read at one wakeup by a single call, so the handler
+            sees a burst (e. g. a chord or a key repeat followed by a release) at once.
+        **/
+        using on_events_t = t::callback_t< event_t const *, size_t >;
+
+        /**
+            Events read at one wakeup. Concrete listeners `push()` events while reading and
+            `flush()` the batch when the input is exhausted. The events are kept in a fixed array,
+            so collecting them does not allocate memory; if the array is full, the events are
+            delivered earlier.
+        **/
+        class batch_t {
+
+            public:
+
+                /** Max number of events delivered by one call. **/
+                static size_t constexpr capacity = 64;
+
+                explicit batch_t( on_events_t handler = nullptr ):
+                    _handler( handler )
+                {
+                };
+
+                /** Appends an event to the batch. Delivers the batch if it is full. **/
+                void push( event_t const & event ) {
+                    _events[ _size ++ ] = event;
+                    if ( _size == capacity ) {
+                        flush();
+                    };
+                };
+
+                /**
+                    Reports removal of a device: delivers collected events followed by the device
+                    removal event, then unregisters the device. The handler sees the events before
+                    the device is unregistered, so it still can look up the device policy, and
+                    events of the removed device never reach the handler with the index of another
+                    device.
+                **/
+                void remove( devices_t & devices, device_t device, stamp_t time );
+
+                /** Delivers collected events, if any, to the handler. **/
+                void flush() {
+                    if ( _size ) {
+                        auto const size = _size;
+                        _size = 0;
+                        _handler( _events, size );
+                    };
+                };
+
+            private:
+
+                on_events_t _handler;
+                event_t     _events[ capacity ];
+                size_t      _size { 0 };
+
+        }; // class batch_t
 
     public:
 
@@ -129,23 +256,51 @@ class listener_t {
             Starts listening.
 
             @param handler — The given function will be called on each user input event.
+
+            @param keys — Keys the caller is interested in. A listener may ignore input devices
+            which can't produce any of these keys. Empty set means all the keys are interesting.
         **/
-        void start( on_event_t handler );
+        void start( on_events_t handler, keys_t const & keys = keys_t() );
+
+        /**
+            Starts listening. The same as above, but events of a batch are passed to the handler
+            one by one.
+        **/
+        void start( on_event_t handler, keys_t const & keys = keys_t() );
 
         /** Stops listening, the handler function will not be called any more. **/
         void stop();
 
+        /**
+            Sets policies of input devices by device name. Should be called before `start()`.
+            Listeners which can't tell devices apart ignore policies.
+        **/
+        void set_device_policies( device_policies_t const & policies );
+
+        /** Returns devices known to the listener. **/
+        devices_t const & devices() const { return _devices; };
+
     protected:
 
         virtual void _start() = 0;
         virtual void _stop()  = 0;
 
+        on_events_t _on_events { nullptr };     ///< Function to call on every batch of events.
+        keys_t      _keys;                      ///< Interesting keys, empty means all.
+        devices_t   _devices;
+
+    private:
+
+        void _deliver( event_t const * events, size_t count );
+
         on_event_t  _on_event { nullptr };      ///< Function to call on every user input event.
 
 }; // class listener_t
 
 using listener_p = ptr_t< listener_t >;
 
+string_t str( listener_t::device_policy_t policy );
+
 /// Namespace for concrete listeners.
 namespace listener {
 }; // namespace listener
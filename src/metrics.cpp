@@ -0,0 +1,366 @@
+/*
+    ---------------------------------------------------------------------- copyright and license ---
+
+    File: src/metrics.cpp
+
+    Copyright 🄯 2014, 2016—2017, 2019—2023 Van de Bugger.
+
+    This file is part of Tapper.
+
+    Tapper is free software: you can redistribute it and/or modify it under the terms of the GNU
+    General Public License as published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    Tapper is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+    even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along with Tapper.  If not,
+    see <https://www.gnu.org/licenses/>.
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+
+    ---------------------------------------------------------------------- copyright and license ---
+*/
+
+/** @file
+    `metrics_t` class implementation.
+**/
+
+#include "metrics.hpp"
+
+#include <cerrno>
+#include <cstring>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "latency.hpp"
+#include "posix.hpp"
+#include "reactor.hpp"
+#include "string.hpp"
+#include "test.hpp"
+
+namespace tapper {
+
+/** Returns name of the action type, used as a label value. **/
+static
+char const *
+action_name(
+    action_t::type_t type
+) {
+    switch ( type ) {
+        case action_t::type_t::none:            return "none";
+        case action_t::type_t::activate_layout: return "activate_layout";
+        case action_t::type_t::emit_key_tap:    return "emit_key_tap";
+    };
+    return "unknown";
+};
+
+/** Returns label value quoted and escaped as Prometheus text format requires. **/
+static
+string_t
+label(
+    string_t const & value
+) {
+    string_t result = "\"";
+    for ( auto const c: value ) {
+        switch ( c ) {
+            case '\\': result += "\\\\"; break;
+            case '"':  result += "\\\""; break;
+            case '\n': result += "\\n";  break;
+            default:   result += c;
+        };
+    };
+    return result + "\"";
+};
+
+TEST(
+    ASSERT_EQ( label( "esc" ), "\"esc\"" );
+    ASSERT_EQ( label( "a\"b\\c\n" ), "\"a\\\"b\\\\c\\n\"" );
+);
+
+/** Returns `# HELP` and `# TYPE` lines of a metric. **/
+static
+string_t
+header(
+    char const *    name,
+    char const *    type,
+    char const *    help
+) {
+    return STR(
+        "# HELP " << name << " " << help << "\n" <<
+        "# TYPE " << name << " " << type << "\n"
+    );
+};
+
+// -------------------------------------------------------------------------------------------------
+// metrics_t
+// -------------------------------------------------------------------------------------------------
+
+metrics_t &
+metrics(
+) {
+    static metrics_t metrics;
+    return metrics;
+};
+
+metrics_t::metrics_t(
+):
+    OBJECT_T()
+{
+    _events.store( 0, std::memory_order_relaxed );
+    for ( auto & counter: _taps ) {
+        counter.store( 0, std::memory_order_relaxed );
+    };
+    for ( size_t i = 0; i < action_count; ++ i ) {
+        _actions[ i ].store( 0, std::memory_order_relaxed );
+        _failures[ i ].store( 0, std::memory_order_relaxed );
+    };
+    _dropped.store( 0, std::memory_order_relaxed );
+    _dbus_calls.store( 0, std::memory_order_relaxed );
+    for ( auto & counter: _dbus_errors ) {
+        counter.store( 0, std::memory_order_relaxed );
+    };
+    for ( auto & counter: _sessions ) {
+        counter.store( 0, std::memory_order_relaxed );
+    };
+    _active.store( true, std::memory_order_relaxed );
+}; // ctor
+
+metrics_t::~metrics_t(
+) {
+    CATCH_ALL( close() );
+}; // dtor
+
+void
+metrics_t::listener(
+    string_t const &    type,
+    strings_t const &   key_names
+) {
+    _listener  = type;
+    _key_names = key_names;
+}; // listener
+
+string_t
+metrics_t::render(
+) const {
+    auto const load = [] ( counter_t const & counter ) {
+        return counter.load( std::memory_order_relaxed );
+    };
+    string_t out;
+    out += header( "tapper_input_events_total", "counter", "Input events received from listener." );
+    out += STR( "tapper_input_events_total{listener=" << label( _listener ) << "} "
+        << load( _events ) << "\n" );
+    out += header( "tapper_taps_total", "counter", "Taps detected, per key." );
+    for ( size_t code = 0; code < key_count; ++ code ) {
+        auto const taps = load( _taps[ code ] );
+        if ( taps ) {
+            auto const & name = code < _key_names.size() ? _key_names[ code ] : string_t();
+            out += STR(
+                "tapper_taps_total{code=\"" << code << "\""
+                    << ( name.empty() ? string_t() : ",key=" + label( name ) )
+                    << "} " << taps << "\n"
+            );
+        };
+    };
+    out += header( "tapper_actions_total", "counter", "Actions executed, per action type." );
+    for ( size_t i = 1; i < action_count; ++ i ) {
+        out += STR( "tapper_actions_total{type=\"" << action_name( action_t::type_t( i ) )
+            << "\"} " << load( _actions[ i ] ) << "\n" );
+    };
+    out += header(
+        "tapper_action_errors_total", "counter",
+        "Actions failed (layouter or emitter errors), per action type."
+    );
+    for ( size_t i = 1; i < action_count; ++ i ) {
+        out += STR( "tapper_action_errors_total{type=\"" << action_name( action_t::type_t( i ) )
+            << "\"} " << load( _failures[ i ] ) << "\n" );
+    };
+    out += header(
+        "tapper_actions_dropped_total", "counter",
+        "Actions dropped because too many actions were pending."
+    );
+    out += STR( "tapper_actions_dropped_total " << load( _dropped ) << "\n" );
+    out += header( "tapper_dbus_calls_total", "counter", "D-Bus method calls." );
+    out += STR( "tapper_dbus_calls_total " << load( _dbus_calls ) << "\n" );
+    out += header( "tapper_dbus_errors_total", "counter", "Failed D-Bus method calls, per error." );
+    for ( int i = 0; i <= int( dbus_error_t::max ); ++ i ) {
+        out += STR( "tapper_dbus_errors_total{error=\"" << dbus_error_t( i ) << "\"} "
+            << load( _dbus_errors[ i ] ) << "\n" );
+    };
+    out += header(
+        "tapper_session_transitions_total", "counter",
+        "User session activity changes, per new state."
+    );
+    out += STR( "tapper_session_transitions_total{state=\"inactive\"} "
+        << load( _sessions[ 0 ] ) << "\n" );
+    out += STR( "tapper_session_transitions_total{state=\"active\"} "
+        << load( _sessions[ 1 ] ) << "\n" );
+    out += header( "tapper_session_active", "gauge", "1 if user session is active, 0 otherwise." );
+    out += STR(
+        "tapper_session_active " << int( _active.load( std::memory_order_relaxed ) ) << "\n"
+    );
+    /*
+        Latency is reported as a summary: histograms are kept in microseconds, Prometheus wants
+        seconds; `str( double )` prints 6 decimal digits, so nothing is lost.
+    */
+    out += header( "tapper_latency_seconds", "summary", "Latency of tap processing stages." );
+    static struct { char const * label; double percent; } const quantiles[] = {
+        { "0.5", 50 }, { "0.9", 90 }, { "0.99", 99 }, { "1", 100 },
+    };
+    for ( int i = 0; i <= int( latency_t::stage_t::max ); ++ i ) {
+        auto const   stage     = latency_t::stage_t( i );
+        auto const & histogram = latency().histogram( stage );
+        for ( auto const & quantile: quantiles ) {
+            out += STR( "tapper_latency_seconds{stage=\"" << stage << "\","
+                << "quantile=\"" << quantile.label << "\"} "
+                << histogram.percentile( quantile.percent ) / 1e6 << "\n" );
+        };
+        out += STR( "tapper_latency_seconds_sum{stage=\"" << stage << "\"} "
+            << histogram.sum() / 1e6 << "\n" );
+        out += STR( "tapper_latency_seconds_count{stage=\"" << stage << "\"} "
+            << histogram.count() << "\n" );
+    };
+    return out;
+}; // render
+
+TEST(
+    metrics_t metrics;
+    metrics.listener( "evdev", strings_t{ "", "esc" } );
+    metrics.events( 3 );
+    metrics.tap( key_t( 1 ) );
+    metrics.tap( key_t( 2 ) );
+    metrics.action( action_t::type_t::emit_key_tap, true );
+    metrics.dbus_error( metrics_t::dbus_error_t::timeout );
+    metrics.session( true );       // Not a transition: session is initially active.
+    metrics.session( false );
+    auto const text = metrics.render();
+    auto const has = [ & text ] ( string_t const & line ) {
+        return text.find( "\n" + line + "\n" ) != string_t::npos;
+    };
+    ASSERT( has( "tapper_input_events_total{listener=\"evdev\"} 3" ) );
+    ASSERT( has( "tapper_taps_total{code=\"1\",key=\"esc\"} 1" ) );
+    ASSERT( has( "tapper_taps_total{code=\"2\"} 1" ) );
+    ASSERT( has( "tapper_actions_total{type=\"activate_layout\"} 0" ) );
+    ASSERT( has( "tapper_action_errors_total{type=\"emit_key_tap\"} 1" ) );
+    ASSERT( has( "tapper_dbus_errors_total{error=\"timeout\"} 1" ) );
+    ASSERT( has( "tapper_session_transitions_total{state=\"active\"} 0" ) );
+    ASSERT( has( "tapper_session_transitions_total{state=\"inactive\"} 1" ) );
+    ASSERT( has( "tapper_session_active 0" ) );
+    ASSERT( has( "# TYPE tapper_latency_seconds summary" ) );
+);
+
+void
+metrics_t::serve(
+    string_t const & path
+) {
+    assert( _socket == -1 );
+    sockaddr_un addr;
+    std::memset( & addr, 0, sizeof( addr ) );
+    addr.sun_family = AF_UNIX;
+    if ( path.empty() or path.size() >= sizeof( addr.sun_path ) ) {
+        ERR( "Bad metrics socket path " << q( path ) << "." );
+    };
+    std::strcpy( addr.sun_path, path.c_str() );
+    auto const address = reinterpret_cast< sockaddr const * >( & addr );
+    int fd = ::socket( AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0 );
+    if ( fd == -1 ) {
+        int error = errno;
+        ERR( "Failed to create metrics socket: " << posix::syserrmsg( error ) << "." );
+    };
+    /*
+        A socket left by a crashed instance would make `bind()` fail, so remove it. But if
+        somebody accepts connections, the socket is alive, do not steal it.
+    */
+    struct stat st;
+    if ( ::lstat( path.c_str(), & st ) == 0 and S_ISSOCK( st.st_mode ) ) {
+        if ( ::connect( fd, address, sizeof( addr ) ) == 0 or errno == EAGAIN ) {
+            ::close( fd );
+            ERR( "Metrics socket " << q( path ) << " is served by another process." );
+        };
+        ::unlink( path.c_str() );
+        ::close( fd );
+        fd = ::socket( AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0 );
+        if ( fd == -1 ) {
+            int error = errno;
+            ERR( "Failed to create metrics socket: " << posix::syserrmsg( error ) << "." );
+        };
+    };
+    // Taps per key may tell much about the user, so the socket is accessible by the user only.
+    auto const mask = ::umask( 0077 );
+    int const bound = ::bind( fd, address, sizeof( addr ) );
+    int const error = errno;
+    ::umask( mask );
+    if ( bound != 0 or ::listen( fd, 8 ) != 0 ) {
+        int const e = bound != 0 ? error : errno;
+        ::close( fd );
+        ERR(
+            "Failed to bind metrics socket " << q( path ) << ": " << posix::syserrmsg( e ) << "."
+        );
+    };
+    _socket = fd;
+    _path   = path;
+    reactor().watch(
+        _socket,
+        reactor_t::on_ready_t::make< metrics_t, & metrics_t::_on_connect >( this )
+    );
+    INF( "Serving metrics on " << q( _path ) << "." );
+}; // serve
+
+void
+metrics_t::close(
+) {
+    if ( _socket == -1 ) {
+        return;
+    };
+    reactor().unwatch( _socket );
+    ::close( _socket );
+    _socket = -1;
+    ::unlink( _path.c_str() );
+    _path.clear();
+}; // close
+
+/**
+    Sends metrics to a connected client. The text is much smaller than a socket buffer, so it is
+    written at once; a client which does not read it is not waited for, the reactor must not block.
+**/
+void
+metrics_t::_on_connect(
+) {
+    int const fd = ::accept4( _socket, nullptr, nullptr, SOCK_CLOEXEC | SOCK_NONBLOCK );
+    if ( fd == -1 ) {
+        return;     // The client has gone, or accept was interrupted. Nothing to do.
+    };
+    auto const text = render();
+    auto const sent = ::send( fd, text.data(), text.size(), MSG_NOSIGNAL );
+    int const error = errno;
+    if ( sent < 0 and ( error == EPIPE or error == ECONNRESET ) ) {
+        // The client has gone without reading (e. g. another instance checked the socket).
+    } else if ( sent != ssize_t( text.size() ) ) {
+        WRN(
+            "Failed to send metrics: "
+                << ( sent < 0 ? posix::syserrmsg( error ) : string_t( "Short write" ) ) << "."
+        );
+    };
+    ::close( fd );
+}; // _on_connect
+
+string_t
+str(
+    metrics_t::dbus_error_t error
+) {
+    switch ( error ) {
+        case metrics_t::dbus_error_t::no_such_bus:     return "no_such_bus";
+        case metrics_t::dbus_error_t::bad_result_type: return "bad_result_type";
+        case metrics_t::dbus_error_t::timeout:         return "timeout";
+        case metrics_t::dbus_error_t::other:           return "other";
+    };
+    return "(* unknown D-Bus error #" + str( int( error ) ) + " *)";
+};
+
+}; // namespace tapper
+
+// end of file //
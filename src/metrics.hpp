@@ -0,0 +1,187 @@
+/*
+    ---------------------------------------------------------------------- copyright and license ---
+
+    File: src/metrics.hpp
+
+    Copyright 🄯 2014, 2016—2017, 2019—2023 Van de Bugger.
+
+    This file is part of Tapper.
+
+    Tapper is free software: you can redistribute it and/or modify it under the terms of the GNU
+    General Public License as published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    Tapper is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+    even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along with Tapper.  If not,
+    see <https://www.gnu.org/licenses/>.
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+
+    ---------------------------------------------------------------------- copyright and license ---
+*/
+
+/** @file
+    `metrics_t` class interface.
+
+    @sa metrics.cpp
+**/
+
+#ifndef _TAPPER_METRICS_HPP_
+#define _TAPPER_METRICS_HPP_
+
+#include "base.hpp"
+
+#include <atomic>
+#include <cstdint>
+
+#include "types.hpp"
+
+namespace tapper {
+
+// -------------------------------------------------------------------------------------------------
+// metrics_t
+// -------------------------------------------------------------------------------------------------
+
+/**
+    Operational counters: input events, taps, actions, D-Bus and emitter failures, session
+    activity. Together with `latency()` statistics they are reported in Prometheus text format,
+    optionally served on a UNIX socket by the reactor.
+
+    Counters are relaxed atomics, so any thread may update them without locking and without
+    allocating memory, while the reactor thread renders them. As with `histogram_t`, rendering is
+    not a snapshot.
+
+    There is only one instance of the class, use `metrics()` function to access it.
+**/
+class metrics_t: public object_t {
+
+    public:
+
+        /** Metrics exceptions. **/
+        class error_t: public std::runtime_error {
+            public:
+                using std::runtime_error::runtime_error;
+        }; // class error_t
+
+        /** Kinds of D-Bus call failures. **/
+        enum class dbus_error_t {
+            no_such_bus,        ///< The bus name is not present.
+            bad_result_type,    ///< The method returned unexpected type.
+            timeout,            ///< The call deadline expired.
+            other,              ///< Any other error reported by the remote side or GIO.
+            max = other,
+        };
+
+    public:
+
+        metrics_t();
+        ~metrics_t();
+
+        /**
+            Sets labels: the listener type and names of keys, indexed by key code. Should be
+            called before the tapper starts.
+        **/
+        void listener( string_t const & type, strings_t const & key_names );
+
+        /** Counts input events received from the listener. **/
+        void events( size_t count ) {
+            _events.fetch_add( count, std::memory_order_relaxed );
+        };
+
+        /** Counts a tap of the key. **/
+        void tap( key_t key ) {
+            _taps[ key.code() ].fetch_add( 1, std::memory_order_relaxed );
+        };
+
+        /** Counts an executed action, `failed` if the layouter or emitter threw. **/
+        void action( action_t::type_t type, bool failed ) {
+            _count( _actions, type );
+            if ( failed ) {
+                _count( _failures, type );
+            };
+        };
+
+        /** Counts an action dropped because the executor queue is full. **/
+        void dropped() {
+            _dropped.fetch_add( 1, std::memory_order_relaxed );
+        };
+
+        /** Counts a D-Bus call. **/
+        void dbus_call() {
+            _dbus_calls.fetch_add( 1, std::memory_order_relaxed );
+        };
+
+        /** Counts a failed D-Bus call. **/
+        void dbus_error( dbus_error_t error ) {
+            _dbus_errors[ int( error ) ].fetch_add( 1, std::memory_order_relaxed );
+        };
+
+        /** Records user session activity reported by the layouter. **/
+        void session( bool active ) {
+            if ( _active.exchange( active, std::memory_order_relaxed ) != active ) {
+                _sessions[ active ].fetch_add( 1, std::memory_order_relaxed );
+            };
+        };
+
+        /** Returns all the metrics, including latency, in Prometheus text exposition format. **/
+        string_t render() const;
+
+        /**
+            Starts serving metrics on a UNIX stream socket bound to `path`: every client which
+            connects to the socket receives `render()` output, then the connection is closed. The
+            socket is watched by `reactor()`, and is accessible by the current user only. If a
+            stale socket is left at `path`, it is replaced, but if another process serves it,
+            `error_t` is thrown.
+        **/
+        void serve( string_t const & path );
+
+        /** Stops serving metrics and removes the socket. **/
+        void close();
+
+    private:
+
+        using counter_t = std::atomic< std::uint64_t >;
+
+        /** Number of possible key codes, including `key_t::none`. **/
+        static size_t constexpr key_count = size_t( key_t::max ) + 1;
+
+        /** Number of action types. **/
+        static size_t constexpr action_count = size_t( action_t::type_t::emit_key_tap ) + 1;
+
+        void _count( counter_t ( & counters )[ action_count ], action_t::type_t type ) {
+            counters[ int( type ) ].fetch_add( 1, std::memory_order_relaxed );
+        };
+
+        void _on_connect();
+
+    private:
+
+        string_t            _listener;
+        strings_t           _key_names;
+        counter_t           _events;
+        counter_t           _taps[ key_count ];
+        counter_t           _actions[ action_count ];
+        counter_t           _failures[ action_count ];
+        counter_t           _dropped;
+        counter_t           _dbus_calls;
+        counter_t           _dbus_errors[ int( dbus_error_t::max ) + 1 ];
+        counter_t           _sessions[ 2 ];     ///< Transitions to inactive and active state.
+        std::atomic< bool > _active;
+        string_t            _path;              ///< Path to the socket, empty if not served.
+        int                 _socket { -1 };
+
+}; // class metrics_t
+
+/** Returns reference to the only instance of metrics. **/
+metrics_t & metrics();
+
+string_t str( metrics_t::dbus_error_t error );
+
+}; // namespace tapper
+
+#endif // _TAPPER_METRICS_HPP_
+
+// end of file //
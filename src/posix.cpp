@@ -38,6 +38,10 @@
 #include <pwd.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
 #include <unistd.h>
 
 #include "string.hpp"
@@ -195,26 +199,6 @@ symlink(
     };
 };
 
-/** Sleep until interrupted. **/
-void
-sleep(
-) {
-    struct timespec time {
-        .tv_sec = std::numeric_limits< ::time_t >::max(),
-        .tv_nsec = 0,
-    };
-    for ( ; ; ) {
-        auto error = nanosleep( & time, nullptr );
-        if ( error ) {
-            error = errno;
-            if ( error == EINTR ) {
-                break;
-            };
-            ERR( "nanosleep failed", error );
-        };
-    };
-};
-
 // -------------------------------------------------------------------------------------------------
 // error_t
 // -------------------------------------------------------------------------------------------------
@@ -399,6 +383,24 @@ get_group_id(
         };
     };
 
+    cap_t::cap_t(
+        string_t const & path
+    ) :
+        _rep( cap_get_file( path.c_str() ) )
+    {
+        if ( not _rep ) {
+            int e = errno;
+            if ( e != ENODATA ) {
+                ERR( "Can't get capabilities of " << q( path ), e );
+            };
+            _rep = cap_init();
+            if ( not _rep ) {
+                e = errno;
+                ERR( "Can't init capabilities", e );
+            };
+        };
+    };
+
     bool
     cap_t::get(
         flag_t  flag,
@@ -482,6 +484,21 @@ get_group_id(
 
 #endif // WITH_LIBCAP
 
+void
+drop_caps(
+) {
+    #if WITH_LIBCAP
+        cap_t cap;
+        cap.clear();
+        cap.apply();
+    #endif // WITH_LIBCAP
+    auto err = prctl( PR_SET_KEEPCAPS, 0, 0, 0, 0 );
+    if ( err ) {
+        int e = errno;
+        ERR( "Can't reset keep_caps flag", e );
+    };
+}; // drop_caps
+
 // -------------------------------------------------------------------------------------------------
 // File system
 // -------------------------------------------------------------------------------------------------
@@ -558,12 +575,92 @@ file_t::close(
     _fd = -1;
 };
 
+/**
+    Writes all the data to the file. Partial and interrupted writes are continued.
+**/
+void
+file_t::write(
+    void const * data,
+    size_t       size
+) {
+    auto ptr = static_cast< char const * >( data );
+    while ( size > 0 ) {
+        auto written = ::write( _fd, ptr, size );
+        if ( written < 0 ) {
+            int e = errno;
+            if ( e == EINTR ) {
+                continue;
+            };
+            ERR( "Can't write file " << q( _path ), e );
+        };
+        ptr  += written;
+        size -= written;
+    };
+};
+
 int
 file_t::fd(
 ) {
     return _fd;
 };
 
+mapping_t::~mapping_t(
+) {
+    CATCH_ALL( unmap() );
+};
+
+/**
+    Maps the entire file into memory. An empty file is not actually mapped, `data()` returns
+    `nullptr` in such a case.
+**/
+void
+mapping_t::map(
+    file_t & file
+) {
+    assert( _data == nullptr );
+    stat_t st;
+    if ( fstat( file.fd(), & st ) != 0 ) {
+        int e = errno;
+        ERR( "Can't stat file", e );
+    };
+    if ( st.st_size == 0 ) {
+        return;
+    };
+    auto data = mmap( nullptr, st.st_size, PROT_READ, MAP_PRIVATE, file.fd(), 0 );
+    if ( data == MAP_FAILED ) {
+        int e = errno;
+        ERR( "Can't map file", e );
+    };
+    _data = data;
+    _size = st.st_size;
+};
+
+void
+mapping_t::unmap(
+) {
+    if ( _data ) {
+        auto err = munmap( _data, _size );
+        if ( err ) {
+            int e = errno;
+            ERR( "Can't unmap file", e );
+        };
+        _data = nullptr;
+        _size = 0;
+    };
+};
+
+void const *
+mapping_t::data(
+) const {
+    return _data;
+};
+
+size_t
+mapping_t::size(
+) const {
+    return _size;
+};
+
 // =================================================================================================
 // signal
 // =================================================================================================
@@ -707,6 +804,175 @@ kill(
 
 }; // namespace signal
 
+// -------------------------------------------------------------------------------------------------
+// semaphore_t
+// -------------------------------------------------------------------------------------------------
+
+semaphore_t::semaphore_t(
+    uint_t value
+):
+    OBJECT_T()
+{
+    auto error = sem_init( & _rep, 0, value );
+    if ( error ) {
+        error = errno;
+        ERR( "Initializing semaphore failed", error );
+    };
+}; // ctor
+
+semaphore_t::~semaphore_t(
+) {
+    auto error = sem_destroy( & _rep );
+    if ( error ) {
+        error = errno;
+        WRN( "Destroying semaphore failed: " << syserrmsg( error ) << "." );
+    };
+}; // dtor
+
+/**
+    Increments the semaphore. The function does not block.
+**/
+void
+semaphore_t::post(
+) {
+    auto error = sem_post( & _rep );
+    if ( error ) {
+        error = errno;
+        ERR( "Posting semaphore failed", error );
+    };
+}; // post
+
+/**
+    Waits until the semaphore is positive, then decrements it. Unlike `sleep`, the function is
+    *not* interrupted by signals: a signal handler does not post semaphores, so EINTR means nothing
+    to the caller.
+**/
+void
+semaphore_t::wait(
+) {
+    for ( ; ; ) {
+        auto error = sem_wait( & _rep );
+        if ( not error ) {
+            break;
+        };
+        error = errno;
+        if ( error != EINTR ) {
+            ERR( "Waiting for semaphore failed", error );
+        };
+    };
+}; // wait
+
+// -------------------------------------------------------------------------------------------------
+// Scheduling
+// -------------------------------------------------------------------------------------------------
+
+bool
+sched_t::is_default(
+) const {
+    return policy == policy_t::other and nice == 0 and cpus.empty();
+}; // is_default
+
+string_t
+sched_t::str(
+) const {
+    strings_t items;
+    switch ( policy ) {
+        case policy_t::other: {
+            items.push_back( STR( "nice " << nice ) );
+        } break;
+        case policy_t::fifo: {
+            items.push_back( STR( "fifo " << priority ) );
+        } break;
+        case policy_t::rr: {
+            items.push_back( STR( "rr " << priority ) );
+        } break;
+    };
+    if ( not cpus.empty() ) {
+        strings_t list;
+        for ( auto cpu: cpus ) {
+            list.push_back( tapper::str( cpu ) );
+        };
+        items.push_back( "cpus " + join( ",", list ) );
+    };
+    return join( ", ", items );
+}; // str
+
+pid_t
+get_tid(
+) {
+    return pid_t( syscall( SYS_gettid ) );
+}; // get_tid
+
+void
+set_sched(
+    pid_t           tid,
+    sched_t const & sched
+) {
+    if ( sched.policy != sched_t::policy_t::other ) {
+        sched_param param {};
+        param.sched_priority = sched.priority;
+        if ( sched_setscheduler( tid, int( sched.policy ), & param ) != 0 ) {
+            int e = errno;
+            ERR( "Can't set scheduling policy of thread " << tid, e );
+        };
+    } else if ( sched.nice != 0 ) {
+        // Linux applies `PRIO_PROCESS` to a single thread if thread id is given.
+        if ( setpriority( PRIO_PROCESS, id_t( tid ), sched.nice ) != 0 ) {
+            int e = errno;
+            ERR( "Can't set nice level of thread " << tid, e );
+        };
+    };
+    if ( not sched.cpus.empty() ) {
+        cpu_set_t set;
+        CPU_ZERO( & set );
+        for ( auto cpu: sched.cpus ) {
+            if ( cpu >= CPU_SETSIZE ) {
+                ERR( "CPU " << cpu << " is out of range." );
+            };
+            CPU_SET( cpu, & set );
+        };
+        if ( sched_setaffinity( tid, sizeof( set ), & set ) != 0 ) {
+            int e = errno;
+            ERR( "Can't set CPU affinity of thread " << tid, e );
+        };
+    };
+}; // set_sched
+
+void
+reset_sched(
+) {
+    sched_param param {};
+    if ( sched_setscheduler( 0, SCHED_OTHER, & param ) != 0 ) {
+        int e = errno;
+        ERR( "Can't reset scheduling policy", e );
+    };
+    if ( setpriority( PRIO_PROCESS, id_t( get_tid() ), 0 ) != 0 ) {
+        int e = errno;
+        ERR( "Can't reset nice level", e );
+    };
+}; // reset_sched
+
+void
+lock_memory(
+) {
+    if ( mlockall( MCL_CURRENT | MCL_FUTURE ) != 0 ) {
+        int e = errno;
+        ERR( "Can't lock memory", e );
+    };
+}; // lock_memory
+
+TEST(
+    sched_t sched;
+    ASSERT( sched.is_default() );
+    sched.cpus = { 0, 2, 3 };
+    ASSERT( not sched.is_default() );
+    ASSERT_EQ( sched.str(), "nice 0, cpus 0,2,3" );
+    sched.policy   = sched_t::policy_t::fifo;
+    sched.priority = 10;
+    sched.cpus.clear();
+    ASSERT_EQ( sched.str(), "fifo 10" );
+);
+
 // -------------------------------------------------------------------------------------------------
 // thread_t
 // -------------------------------------------------------------------------------------------------
@@ -816,7 +1082,8 @@ thread_t::_body(
     #endif // ENABLE_DEBUG
     TRACE();
     DBG( "really started" );
-    auto what = CATCH_ALL( thread->body(); );
+    // A thread inherits capabilities of its creator, but no thread needs them.
+    auto what = CATCH_ALL( drop_caps(); thread->body(); );
         /*
             Do not assign result of `CATCH_ALL` directly to `thread->_what`: it may overwrite error
             message leaved there by the thread body.
@@ -827,6 +1094,21 @@ thread_t::_body(
     return nullptr;
 }; // _body
 
+TEST(
+    // A thread resets "keep capabilities" flag inherited from its creator.
+    struct probe_t: public thread_t {
+        probe_t(): thread_t( "probe" ) {};
+        int keep { -1 };
+        virtual void body() override { keep = prctl( PR_GET_KEEPCAPS, 0, 0, 0, 0 ); };
+    };
+    prctl( PR_SET_KEEPCAPS, 1, 0, 0, 0 );
+    probe_t probe;
+    probe.start();
+    probe.join();
+    prctl( PR_SET_KEEPCAPS, 0, 0, 0, 0 );
+    ASSERT_EQ( probe.keep, 0 );
+);
+
 }; // namespace posix
 
 template<>
@@ -35,11 +35,14 @@
 #include "base.hpp"
 
 #include <initializer_list>
+#include <set>
 #include <stdexcept>    // std::runtime_error
 #include <vector>
 
 #include <fcntl.h>
 #include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
 #include <signal.h>
 
 #if WITH_LIBCAP
@@ -58,7 +61,6 @@ namespace posix {
     string_t base_name( string_t const & path );
     string_t syserrmsg( int error );
     void     execp( string_t const & prog, strings_t const & args );
-    void     sleep();
 
     // ---------------------------------------------------------------------------------------------
     // error_t
@@ -141,12 +143,20 @@ namespace posix {
                 };
 
                 enum class value_t {
-                    setuid = CAP_SETUID,
-                    setgid = CAP_SETGID,
+                    setuid   = CAP_SETUID,
+                    setgid   = CAP_SETGID,
+                    sys_nice = CAP_SYS_NICE,
+                    ipc_lock = CAP_IPC_LOCK,
                         // There are many other capability values, but I do not need them.
                 };
 
+                /** Gets capabilities of the calling thread. **/
                 cap_t();
+                /**
+                    Gets capabilities of the given file. All the sets of a file which has no
+                    capabilities are empty.
+                **/
+                explicit cap_t( string_t const & path );
                 cap_t( cap_t const & ) = delete;
                 ~cap_t();
 
@@ -168,6 +178,12 @@ namespace posix {
 
     #endif // WITH_LIBCAP
 
+    /**
+        Drops all capabilities of the calling thread and resets its "keep capabilities" flag.
+        Capabilities are per-thread, so other threads are not affected.
+    **/
+    void drop_caps();
+
     // ---------------------------------------------------------------------------------------------
     // File system
     // ---------------------------------------------------------------------------------------------
@@ -188,12 +204,32 @@ namespace posix {
             myself_t & operator =( myself_t const & that ) = delete;
             void open( string_t const & path, int flags = 0, int mode = 0 );
             void close();
+            void write( void const * data, size_t size );
             int fd();
         private:
             string_t _path;
             int      _fd = -1;
     };
 
+    /**
+        Read-only memory mapping of an entire file.
+    **/
+    class mapping_t {
+        public:
+            using myself_t = mapping_t;
+            mapping_t() = default;
+            mapping_t( myself_t const & that ) = delete;
+            ~mapping_t();
+            myself_t & operator =( myself_t const & that ) = delete;
+            void   map( file_t & file );
+            void   unmap();
+            void const * data() const;
+            size_t size() const;
+        private:
+            void * _data = nullptr;
+            size_t _size = 0;
+    };
+
     // ---------------------------------------------------------------------------------------------
     // signal_t
     // ---------------------------------------------------------------------------------------------
@@ -228,6 +264,76 @@ namespace posix {
 
     }; // namespace signal
 
+    // ---------------------------------------------------------------------------------------------
+    // semaphore_t
+    // ---------------------------------------------------------------------------------------------
+
+    /**
+        Unnamed POSIX semaphore. `post` does not take any locks, so a thread which must not block
+        (e. g. a listener thread) can wake up another thread (e. g. an executor thread).
+    **/
+    class semaphore_t: public object_t {
+
+        public:
+
+            explicit semaphore_t( uint_t value = 0 );
+            ~semaphore_t();
+
+            void post();
+            void wait();
+
+        private:
+
+            sem_t           _rep;
+
+    }; // class semaphore_t
+
+    // ---------------------------------------------------------------------------------------------
+    // Scheduling
+    // ---------------------------------------------------------------------------------------------
+
+    using cpus_t = std::set< uint_t >;
+
+    /** Scheduling parameters of a thread. **/
+    struct sched_t {
+        enum class policy_t {
+            other = SCHED_OTHER,    ///< Default time-sharing policy, `nice` matters.
+            fifo  = SCHED_FIFO,     ///< Real-time first-in first-out policy, `priority` matters.
+            rr    = SCHED_RR,       ///< Real-time round-robin policy, `priority` matters.
+        };
+        policy_t policy   { policy_t::other };
+        int      priority { 0 };    ///< Real-time priority, 1…99.
+        int      nice     { 0 };    ///< Nice level, -20…19.
+        cpus_t   cpus;              ///< CPUs the thread may run on, empty set means all.
+        /** Returns `true` if parameters are default, so there is nothing to apply. **/
+        bool     is_default() const;
+        string_t str() const;
+    };
+
+    /** Returns kernel id of the calling thread. **/
+    pid_t get_tid();
+
+    /**
+        Applies scheduling parameters to the thread with the given kernel id. Real-time policies,
+        negative nice levels and (sometimes) affinity require `cap_sys_nice` capability. Threads
+        created by the thread later inherit the parameters.
+    **/
+    void set_sched( pid_t tid, sched_t const & sched );
+
+    /**
+        Resets scheduling policy and nice level of the calling thread to defaults, so a thread does
+        not keep parameters inherited from its creator. Lowering priority does not require any
+        capabilities.
+    **/
+    void reset_sched();
+
+    /**
+        Locks all current and future pages of the process in memory, so input processing never
+        waits for a page fault. Requires `cap_ipc_lock` capability or sufficient
+        `RLIMIT_MEMLOCK`.
+    **/
+    void lock_memory();
+
     // ---------------------------------------------------------------------------------------------
     // thread_t
     // ---------------------------------------------------------------------------------------------
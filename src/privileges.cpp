@@ -125,9 +125,26 @@ privileges_t::init(
             set_user_ids( _uids.r, WITH_LIBEVDEV ? no_uid : _uids.r );
         };
 
-        // Drop all capabilities now, they are not required any more:
+        /*
+            Drop all capabilities now, they are not required any more. Capabilities required for
+            tuning (step 7) are kept in the permitted set, since it is not yet known if tuning is
+            requested — but only if the administrator granted them to the executable file, or the
+            real user is "root". Capabilities of a setuid-root executable are not an opt-in.
+        */
+        bool sys_nice = cap.get( flag_t::permitted, value_t::sys_nice );
+        bool ipc_lock = cap.get( flag_t::permitted, value_t::ipc_lock );
+        if ( ( sys_nice or ipc_lock ) and _uids.r != _root() ) {
+            posix::cap_t const file( "/proc/self/exe" );
+            sys_nice = sys_nice and file.get( flag_t::permitted, value_t::sys_nice );
+            ipc_lock = ipc_lock and file.get( flag_t::permitted, value_t::ipc_lock );
+        };
         cap.clear();
+        cap.set( flag_t::permitted, value_t::sys_nice, sys_nice );
+        cap.set( flag_t::permitted, value_t::ipc_lock, ipc_lock );
         cap.apply();
+        if ( sys_nice or ipc_lock ) {
+            keep_caps( true );      // Otherwise dropping "root" user drops them too.
+        };
 
     #else
 
@@ -145,8 +162,8 @@ privileges_t::init(
             Change groups before changing the user, otherwise changing groups may fail due to lack
             of privileges.
         */
-        CATCH_ALL( set_group_ids( _gids.r, WITH_LIBINPUT ? input : _gids.r ) );
-        CATCH_ALL( set_user_ids( _uids.r, WITH_LIBEVDEV ? root : _uids.r ) );
+        CATCH_ALL( set_group_ids( _gids.r, WITH_LIBINPUT ? _input() : _gids.r ) );
+        CATCH_ALL( set_user_ids( _uids.r, WITH_LIBEVDEV ? _root() : _uids.r ) );
 
     #endif // WITH_LIBCAP
 };
@@ -216,6 +233,51 @@ privileges_t::do_as_user(
     function();
 };
 
+void
+privileges_t::do_as_tuner(
+    function_t function
+) {
+    lock_t lock( _mutex );
+    TRACE();
+    #if WITH_LIBCAP
+        using flag_t  = posix::cap_t::flag_t;
+        using value_t = posix::cap_t::value_t;
+        posix::cap_t cap;
+        for ( auto value: { value_t::sys_nice, value_t::ipc_lock } ) {
+            cap.set( flag_t::effective, value, cap.get( flag_t::permitted, value ) );
+        };
+        cap.apply();
+        function();
+        for ( auto value: { value_t::sys_nice, value_t::ipc_lock } ) {
+            cap.set( flag_t::effective, value, false );
+        };
+        cap.apply();
+    #else
+        /*
+            Without libcap, I do not know if the process has required capabilities or not. Let the
+            function just try.
+        */
+        function();
+    #endif // WITH_LIBCAP
+};
+
+void
+privileges_t::drop_tuning(
+) {
+    lock_t lock( _mutex );
+    TRACE();
+    #if WITH_LIBCAP
+        // Tuning capabilities are the only ones left after step 1.
+        posix::drop_caps();
+    #endif // WITH_LIBCAP
+};
+
+privileges_t::tuning_guard_t::~tuning_guard_t(
+) {
+    THIS( & privileges() );
+    CATCH_ALL( privileges().drop_tuning() );
+};
+
 uid_t
 privileges_t::_root(
 ) {
@@ -273,6 +335,18 @@ privileges_t::set_group_ids(
     };
 };
 
+void
+privileges_t::keep_caps(
+    bool keep
+) {
+    auto err = prctl( PR_SET_KEEPCAPS, keep ? 1 : 0, 0, 0, 0 );
+    if ( err ) {
+        using posix::error_t;
+        int e = errno;
+        ERR( "Can't set keep_caps flag", e );
+    };
+};
+
 }; // namespace tapper
 
 // end of file //
@@ -72,6 +72,18 @@
         temporary switched back to "root" user (step 4). Of course, the same mutex should be used
         in other steps.
 
+    7.  Scheduling options (real-time policy, negative nice level) require `cap_sys_nice`, locking
+        memory may require `cap_ipc_lock`. If the process has these capabilities, keep them in the
+        permitted set (but not in the effective one) at step 1, and let them survive step 3. Raise
+        them temporarily, only to apply the options, then drop them completely.
+
+        The capabilities are kept only if the administrator opted in by granting them to the
+        executable file (e. g. `setcap cap_setuid,cap_setgid,cap_sys_nice,cap_ipc_lock=p`), or if
+        the real user is "root". A setuid-root executable has all the capabilities, but it must
+        not give real-time scheduling to any user. Whatever way Tapper exits, the capabilities must
+        not outlive start-up, so a `tuning_guard_t` drops them. Capabilities are per-thread, so
+        every thread started by Tapper drops them before doing anything (see `posix::thread_t`).
+
     P. S. Actually, `chown root:root && chmod u+s` is to much. Only two capabilities, `cap_setuid`
     and `cap_setgid` are enough.
 
@@ -138,6 +150,27 @@ namespace tapper {
             **/
             void do_as_user( function_t function );
 
+            /**
+                Execute the given function with `cap_sys_nice` and `cap_ipc_lock` capabilities, if
+                they are permitted (step 7).
+            **/
+            void do_as_tuner( function_t function );
+
+            /** Drop `cap_sys_nice` and `cap_ipc_lock` capabilities completely (step 7). **/
+            void drop_tuning();
+
+            /**
+                Drops `cap_sys_nice` and `cap_ipc_lock` capabilities when goes out of scope, so they
+                are dropped on any exit path, including exceptions (step 7).
+            **/
+            class tuning_guard_t {
+                public:
+                    tuning_guard_t() {};
+                    tuning_guard_t( tuning_guard_t const & ) = delete;
+                    ~tuning_guard_t();
+                    tuning_guard_t & operator =( tuning_guard_t const & ) = delete;
+            }; // class tuning_guard_t
+
         private:
 
             static auto constexpr no_uid = posix::no_uid;
@@ -151,6 +184,7 @@ namespace tapper {
 
             void  set_user_ids( uid_t effective, uid_t saved = no_uid );
             void  set_group_ids( gid_t effective, gid_t saved = no_gid );
+            void  keep_caps( bool keep );
 
             std::mutex  _mutex;
 
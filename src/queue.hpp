@@ -0,0 +1,114 @@
+/*
+    ---------------------------------------------------------------------- copyright and license ---
+
+    File: src/queue.hpp
+
+    Copyright 🄯 2014, 2016—2017, 2019—2023 Van de Bugger.
+
+    This file is part of Tapper.
+
+    Tapper is free software: you can redistribute it and/or modify it under the terms of the GNU
+    General Public License as published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    Tapper is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+    even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along with Tapper.  If not,
+    see <https://www.gnu.org/licenses/>.
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+
+    ---------------------------------------------------------------------- copyright and license ---
+*/
+
+/** @file
+    `queue_t` template defined here.
+**/
+
+#ifndef _TAPPER_QUEUE_HPP_
+#define _TAPPER_QUEUE_HPP_
+
+#include "base.hpp"
+
+#include <atomic>
+
+namespace tapper {
+namespace t {
+
+/**
+    Bounded lock-free single-producer single-consumer queue.
+
+    Exactly one thread may call `push`, and exactly one (probably another) thread may call `pop`.
+    Neither `push` nor `pop` blocks or allocates memory: if the queue is full, `push` returns
+    `false`; if the queue is empty, `pop` returns `false`. Waking up the consumer is the caller's
+    responsibility.
+**/
+template<
+    typename _value_t,
+    size_t   _capacity                  ///< Max number of items, must be a power of two.
+>
+class queue_t {
+
+    STATIC_ASSERT( _capacity > 0 );
+    STATIC_ASSERT( ( _capacity & ( _capacity - 1 ) ) == 0 );
+
+    public:
+
+        using value_t  = _value_t;
+        using myself_t = queue_t< _value_t, _capacity >;
+
+        static size_t constexpr capacity = _capacity;
+
+        queue_t() = default;
+        queue_t( myself_t const & ) = delete;
+        myself_t & operator =( myself_t const & ) = delete;
+
+        /** Appends the value to the queue. Returns `false` if the queue is full. **/
+        bool push( value_t const & value ) {
+            auto const tail = _tail.load( std::memory_order_relaxed );
+            if ( tail - _head.load( std::memory_order_acquire ) == capacity ) {
+                return false;
+            };
+            _items[ tail & _mask ] = value;
+            _tail.store( tail + 1, std::memory_order_release );
+            return true;
+        };
+
+        /** Takes the first value from the queue. Returns `false` if the queue is empty. **/
+        bool pop( value_t & value ) {
+            auto const head = _head.load( std::memory_order_relaxed );
+            if ( head == _tail.load( std::memory_order_acquire ) ) {
+                return false;
+            };
+            value = _items[ head & _mask ];
+            _head.store( head + 1, std::memory_order_release );
+            return true;
+        };
+
+        /** Returns `true` if the queue is empty. Meaningful for the consumer only. **/
+        bool empty() const {
+            return _head.load( std::memory_order_relaxed ) == _tail.load( std::memory_order_acquire );
+        };
+
+    private:
+
+        static size_t constexpr _mask = _capacity - 1;
+
+        /*
+            Head and tail are written by different threads, keep them in different cache lines to
+            avoid false sharing.
+        */
+        alignas( 64 ) std::atomic< size_t > _head { 0 };   ///< Index of the next item to pop.
+        alignas( 64 ) std::atomic< size_t > _tail { 0 };   ///< Index of the next item to push.
+        value_t                             _items[ _capacity ];
+
+}; // class queue_t
+
+}; // namespace t
+}; // namespace tapper
+
+#endif // _TAPPER_QUEUE_HPP_
+
+// end of file //
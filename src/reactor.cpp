@@ -0,0 +1,253 @@
+/*
+    ---------------------------------------------------------------------- copyright and license ---
+
+    File: src/reactor.cpp
+
+    Copyright 🄯 2014, 2016—2017, 2019—2023 Van de Bugger.
+
+    This file is part of Tapper.
+
+    Tapper is free software: you can redistribute it and/or modify it under the terms of the GNU
+    General Public License as published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    Tapper is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+    even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along with Tapper.  If not,
+    see <https://www.gnu.org/licenses/>.
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+
+    ---------------------------------------------------------------------- copyright and license ---
+*/
+
+/** @file
+    `reactor_t` class implementation.
+
+    @sa reactor.hpp
+**/
+
+#include "reactor.hpp"
+
+#include <cerrno>
+#include <cstdint>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <unistd.h>
+
+#include "test.hpp"
+
+namespace tapper {
+
+// -------------------------------------------------------------------------------------------------
+// reactor_t
+// -------------------------------------------------------------------------------------------------
+
+reactor_t::reactor_t(
+):
+    OBJECT_T()
+{
+    _epoll = epoll_create1( EPOLL_CLOEXEC );
+    if ( _epoll == -1 ) {
+        int error = errno;
+        ERR( "Failed to create epoll instance: " << posix::syserrmsg( error ) << "." );
+    };
+    _wakeup = eventfd( 0, EFD_CLOEXEC | EFD_NONBLOCK );
+    if ( _wakeup == -1 ) {
+        int error = errno;
+        ::close( _epoll );
+        ERR( "Failed to create eventfd: " << posix::syserrmsg( error ) << "." );
+    };
+    _watch( _wakeup, on_ready_t::make< reactor_t, & reactor_t::_on_wakeup >( this ) );
+}; // ctor
+
+reactor_t::~reactor_t(
+) {
+    if ( _signal != -1 ) {
+        ::close( _signal );
+    };
+    ::close( _wakeup );
+    ::close( _epoll );
+}; // dtor
+
+void
+reactor_t::watch(
+    int         fd,
+    on_ready_t  on_ready
+) {
+    assert( on_ready );
+    if ( size_t( fd ) < _callbacks.size() and _callbacks[ fd ] ) {
+        ERR( "File descriptor " << fd << " is already watched." );
+    };
+    _watch( fd, on_ready );
+}; // watch
+
+void
+reactor_t::unwatch(
+    int fd
+) {
+    if ( size_t( fd ) >= _callbacks.size() or not _callbacks[ fd ] ) {
+        return;
+    };
+    if ( epoll_ctl( _epoll, EPOLL_CTL_DEL, fd, nullptr ) ) {
+        int error = errno;
+        WRN(
+            "Failed to unwatch file descriptor " << fd << ": " << posix::syserrmsg( error ) << "."
+        );
+    };
+    _callbacks[ fd ] = nullptr;
+}; // unwatch
+
+void
+reactor_t::signals(
+    posix::signal::set_t const &    set,
+    on_signal_t                     on_signal
+) {
+    posix::signal::mask( SIG_BLOCK, set );
+    _signal = signalfd( _signal, & set.rep, SFD_CLOEXEC | SFD_NONBLOCK );
+    if ( _signal == -1 ) {
+        int error = errno;
+        ERR( "Failed to create signalfd: " << posix::syserrmsg( error ) << "." );
+    };
+    _on_signal_ = on_signal;
+    if ( size_t( _signal ) >= _callbacks.size() or not _callbacks[ _signal ] ) {
+        _watch( _signal, on_ready_t::make< reactor_t, & reactor_t::_on_signal >( this ) );
+    };
+}; // signals
+
+void
+reactor_t::run(
+) {
+    int const   size = 16;
+    epoll_event events[ size ];
+    _stopped = false;
+    while ( not _stopped ) {
+        int count = epoll_wait( _epoll, events, size, -1 );
+        if ( count < 0 ) {
+            int error = errno;
+            if ( error == EINTR ) {
+                continue;
+            };
+            ERR( "Failed to wait for events: " << posix::syserrmsg( error ) << "." );
+        };
+        for ( int i = 0; i < count; ++ i ) {
+            /*
+                A callback may unwatch other descriptors, so check the callback is still here.
+            */
+            auto const fd = events[ i ].data.fd;
+            if ( size_t( fd ) < _callbacks.size() and _callbacks[ fd ] ) {
+                _callbacks[ fd ]();
+            };
+        };
+    };
+}; // run
+
+void
+reactor_t::stop(
+) {
+    std::uint64_t const one = 1;
+    if ( ::write( _wakeup, & one, sizeof( one ) ) != sizeof( one ) ) {
+        int error = errno;
+        if ( error != EAGAIN ) {    // Counter overflow: the reactor will wake up anyway.
+            ERR( "Failed to wake up reactor: " << posix::syserrmsg( error ) << "." );
+        };
+    };
+}; // stop
+
+void
+reactor_t::_watch(
+    int         fd,
+    on_ready_t  on_ready
+) {
+    epoll_event event {
+        .events = EPOLLIN,
+        .data   = { .fd = fd },
+    };
+    if ( epoll_ctl( _epoll, EPOLL_CTL_ADD, fd, & event ) ) {
+        int error = errno;
+        ERR( "Failed to watch file descriptor " << fd << ": " << posix::syserrmsg( error ) << "." );
+    };
+    if ( size_t( fd ) >= _callbacks.size() ) {
+        _callbacks.resize( fd + 1 );
+    };
+    _callbacks[ fd ] = on_ready;
+}; // _watch
+
+void
+reactor_t::_on_wakeup(
+) {
+    std::uint64_t value = 0;
+    if ( ::read( _wakeup, & value, sizeof( value ) ) == sizeof( value ) ) {
+        _stopped = true;
+    };
+}; // _on_wakeup
+
+void
+reactor_t::_on_signal(
+) {
+    signalfd_siginfo info;
+    while ( ::read( _signal, & info, sizeof( info ) ) == sizeof( info ) ) {
+        DBG( "Signal " << info.ssi_signo << "." );
+        if ( _on_signal_ ) {
+            _on_signal_( int( info.ssi_signo ) );
+        };
+    };
+}; // _on_signal
+
+reactor_t &
+reactor(
+) {
+    static reactor_t reactor;
+    return reactor;
+};
+
+// -------------------------------------------------------------------------------------------------
+// Tests
+// -------------------------------------------------------------------------------------------------
+
+namespace {
+
+struct pipe_reader_t {
+    int     fd    { -1 };
+    int     reads { 0 };
+    reactor_t * reactor { nullptr };
+    void on_ready() {
+        char byte;
+        if ( ::read( fd, & byte, 1 ) == 1 ) {
+            ++ reads;
+        };
+        if ( reads == 2 ) {
+            reactor->stop();
+        };
+    };
+};
+
+}; // namespace
+
+TEST(
+    int fds[ 2 ];
+    ASSERT_EQ( pipe( fds ), 0 );
+    reactor_t reactor;
+    pipe_reader_t reader;
+    reader.fd      = fds[ 0 ];
+    reader.reactor = & reactor;
+    using on_ready_t = reactor_t::on_ready_t;
+    auto on_ready = on_ready_t::make< pipe_reader_t, & pipe_reader_t::on_ready >( & reader );
+    reactor.watch( fds[ 0 ], on_ready );
+    ASSERT_EQ( write( fds[ 1 ], "ab", 2 ), 2 );
+    reactor.run();                      // Returns after reading both bytes.
+    ASSERT_EQ( reader.reads, 2 );
+    reactor.unwatch( fds[ 0 ] );
+    reactor.stop();                     // Stop requested before run, so run returns at once.
+    reactor.run();
+    ::close( fds[ 0 ] );
+    ::close( fds[ 1 ] );
+);
+
+}; // namespace tapper
+
+// end of file //
@@ -0,0 +1,133 @@
+/*
+    ---------------------------------------------------------------------- copyright and license ---
+
+    File: src/reactor.hpp
+
+    Copyright 🄯 2014, 2016—2017, 2019—2023 Van de Bugger.
+
+    This file is part of Tapper.
+
+    Tapper is free software: you can redistribute it and/or modify it under the terms of the GNU
+    General Public License as published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    Tapper is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+    even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along with Tapper.  If not,
+    see <https://www.gnu.org/licenses/>.
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+
+    ---------------------------------------------------------------------- copyright and license ---
+*/
+
+/** @file
+    `reactor_t` class interface.
+
+    @sa reactor.cpp
+**/
+
+#ifndef _TAPPER_REACTOR_HPP_
+#define _TAPPER_REACTOR_HPP_
+
+#include "base.hpp"
+
+#include <vector>
+
+#include "callback.hpp"
+#include "posix.hpp"
+
+namespace tapper {
+
+// -------------------------------------------------------------------------------------------------
+// reactor_t
+// -------------------------------------------------------------------------------------------------
+
+/**
+    Event loop which owns file descriptors of all the input sources.
+
+    Listener contexts and layouters register their file descriptors (libinput fd, X connections,
+    evdev epoll fd, etc) with `watch()`, and the main thread calls `run()`. When a file descriptor
+    is ready for reading, its callback is called from within `run()`, so listening and tap
+    detection are done by the main thread, there are no per-component threads, and no signals are
+    sent to threads to stop them.
+
+    Signals are not handled asynchronously either: `signals()` blocks them and reads them from a
+    `signalfd`, so a signal is just one more callback. Other threads may stop the reactor with
+    `stop()`, which writes to an `eventfd`.
+
+    If a callback throws an exception, the loop stops and the exception is propagated to the caller
+    of `run()`.
+**/
+class reactor_t: public object_t {
+
+    public:
+
+        /** Reactor exceptions. **/
+        class error_t: public std::runtime_error {
+            public:
+                using std::runtime_error::runtime_error;
+        }; // class error_t
+
+        /** Function to call when a file descriptor is ready for reading. **/
+        using on_ready_t  = t::callback_t<>;
+
+        /** Function to call when a signal is received. **/
+        using on_signal_t = t::callback_t< int >;
+
+    public:
+
+        reactor_t();
+        ~reactor_t();
+
+        /**
+            Starts watching the file descriptor: `on_ready` will be called every time the
+            descriptor is ready for reading (the descriptor is level-triggered). A descriptor may
+            be watched only once.
+        **/
+        void watch( int fd, on_ready_t on_ready );
+
+        /** Stops watching the file descriptor. It is not an error if it is not watched. **/
+        void unwatch( int fd );
+
+        /**
+            Blocks the given signals in the calling thread (threads started later inherit the mask)
+            and calls `on_signal` when any of them is received. Should be called by the main thread
+            before any other thread is started, otherwise a signal may be delivered to a thread
+            which does not block it.
+        **/
+        void signals( posix::signal::set_t const & set, on_signal_t on_signal );
+
+        /** Dispatches events until `stop()` is called. **/
+        void run();
+
+        /** Makes `run()` return. Can be called from any thread or from a callback. **/
+        void stop();
+
+    private:
+
+        void _watch( int fd, on_ready_t on_ready );
+        void _on_wakeup();
+        void _on_signal();
+
+    private:
+
+        int                         _epoll   { -1 };
+        int                         _wakeup  { -1 };    ///< `eventfd` for cross-thread wakeups.
+        int                         _signal  { -1 };    ///< `signalfd`, or -1 if not used.
+        on_signal_t                 _on_signal_ { nullptr };
+        bool                        _stopped { false }; ///< Accessed by the reactor thread only.
+        std::vector< on_ready_t >   _callbacks;         ///< Callbacks indexed by file descriptor.
+
+}; // class reactor_t
+
+/** Returns reference to the only instance of reactor. **/
+reactor_t & reactor();
+
+}; // namespace tapper
+
+#endif // _TAPPER_REACTOR_HPP_
+
+// end of file //
@@ -0,0 +1,164 @@
+/*
+    ---------------------------------------------------------------------- copyright and license ---
+
+    File: src/recording.cpp
+
+    Copyright 🄯 2014, 2016—2017, 2019—2023 Van de Bugger.
+
+    This file is part of Tapper.
+
+    Tapper is free software: you can redistribute it and/or modify it under the terms of the GNU
+    General Public License as published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    Tapper is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+    even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along with Tapper.  If not,
+    see <https://www.gnu.org/licenses/>.
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+
+    ---------------------------------------------------------------------- copyright and license ---
+*/
+
+/** @file
+    Recording and reading input event logs, implementation.
+**/
+
+#include "recording.hpp"
+
+#include <cstring>
+
+#include "string.hpp"
+
+namespace tapper {
+namespace recording {
+
+static char const  magic[]  = "TAPPERLG";
+static std::uint32_t constexpr version = 2;
+
+STATIC_ASSERT( sizeof( header_t ) == 16 );
+STATIC_ASSERT( sizeof( record_t ) == 16 );
+STATIC_ASSERT( sizeof( record_v1_t ) == 8 );
+STATIC_ASSERT( sizeof( header_t ) % alignof( record_t ) == 0 );
+STATIC_ASSERT( sizeof( magic ) == sizeof( header_t::magic ) + 1 );
+
+// -------------------------------------------------------------------------------------------------
+// recorder_t
+// -------------------------------------------------------------------------------------------------
+
+recorder_t::recorder_t(
+    string_t const & path
+):
+    OBJECT_T()
+{
+    // The log holds every key the user pressed, including passwords, so it is private.
+    _file.open( path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600 );
+    header_t header;
+    std::memcpy( header.magic, magic, sizeof( header.magic ) );
+    header.version     = version;
+    header.record_size = sizeof( record_t );
+    _file.write( & header, sizeof( header ) );
+}; // ctor
+
+recorder_t::~recorder_t(
+) {
+    CATCH_ALL( flush() );
+}; // dtor
+
+void
+recorder_t::write(
+    listener_t::event_t const & event
+) {
+    if ( _count == buffer_size ) {
+        flush();
+    };
+    auto & record = _buffer[ _count ];
+    record.time      = event.time;
+    record.key       = std::uint16_t( event.key.code() );
+    record.state     = event.state == key_state_t::pressed ? 1 : 0;
+    record.reserved0 = 0;
+    record.device    = event.device;
+    std::memset( record.reserved, 0, sizeof( record.reserved ) );
+    ++ _count;
+}; // write
+
+void
+recorder_t::flush(
+) {
+    if ( _count > 0 ) {
+        _file.write( _buffer, _count * sizeof( record_t ) );
+        _count = 0;
+    };
+}; // flush
+
+// -------------------------------------------------------------------------------------------------
+// reader_t
+// -------------------------------------------------------------------------------------------------
+
+reader_t::reader_t(
+    string_t const & path
+):
+    OBJECT_T()
+{
+    _file.open( path, O_RDONLY | O_CLOEXEC );
+    _mapping.map( _file );
+    auto const data = static_cast< char const * >( _mapping.data() );
+    auto const size = _mapping.size();
+    auto const header = reinterpret_cast< header_t const * >( data );
+    if (
+        size < sizeof( header_t )
+        or std::memcmp( header->magic, magic, sizeof( header->magic ) ) != 0
+    ) {
+        ERR( "File " << q( path ) << " is not an input event log." );
+    };
+    size_t record_size = 0;
+    if ( header->version == version and header->record_size == sizeof( record_t ) ) {
+        _records = reinterpret_cast< record_t const * >( data + sizeof( header_t ) );
+        record_size = sizeof( record_t );
+    } else if ( header->version == 1 and header->record_size == sizeof( record_v1_t ) ) {
+        _records_v1 = reinterpret_cast< record_v1_t const * >( data + sizeof( header_t ) );
+        record_size = sizeof( record_v1_t );
+    } else {
+        ERR( "Input event log " << q( path ) << " has unsupported version." );
+    };
+    if ( ( size - sizeof( header_t ) ) % record_size != 0 ) {
+        WRN( "Input event log " << q( path ) << " is truncated." );
+    };
+    _size = ( size - sizeof( header_t ) ) / record_size;
+}; // ctor
+
+size_t
+reader_t::size(
+) const {
+    return _size;
+}; // size
+
+listener_t::event_t
+reader_t::event(
+    size_t index
+) const {
+    assert( index < _size );
+    if ( _records_v1 ) {
+        auto const & record = _records_v1[ index ];
+        return {
+            .time  = stamp_t( record.time ) * 1000,
+            .key   = key_t( record.key ),
+            .state = record.state ? key_state_t::pressed : key_state_t::released,
+        };
+    };
+    auto const & record = _records[ index ];
+    return {
+        .time   = stamp_t( record.time ),
+        .key    = key_t( record.key ),
+        .state  = record.state ? key_state_t::pressed : key_state_t::released,
+        .device = record.device,
+    };
+}; // event
+
+}; // namespace recording
+}; // namespace tapper
+
+// end of file //
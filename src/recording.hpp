@@ -0,0 +1,158 @@
+/*
+    ---------------------------------------------------------------------- copyright and license ---
+
+    File: src/recording.hpp
+
+    Copyright 🄯 2014, 2016—2017, 2019—2023 Van de Bugger.
+
+    This file is part of Tapper.
+
+    Tapper is free software: you can redistribute it and/or modify it under the terms of the GNU
+    General Public License as published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    Tapper is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+    even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along with Tapper.  If not,
+    see <https://www.gnu.org/licenses/>.
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+
+    ---------------------------------------------------------------------- copyright and license ---
+*/
+
+/** @file
+    Recording and reading input event logs, interface.
+
+    @sa recording.cpp
+**/
+
+#ifndef _TAPPER_RECORDING_HPP_
+#define _TAPPER_RECORDING_HPP_
+
+#include "base.hpp"
+
+#include <cstdint>
+
+#include "listener.hpp"
+#include "posix.hpp"
+
+namespace tapper {
+/**
+    Input event logs.
+
+    A log is a binary file: a 16-byte header followed by 16-byte records, one record per
+    `listener_t::event_t`. Records have fixed size and natural alignment, so a log can be mapped
+    into memory and used as is, without parsing. Integers are stored in the host byte order; a log
+    recorded on a host with different byte order is rejected as a log of unsupported version.
+
+    Logs of version 1 have 8-byte records with 32-bit event time in milliseconds. Such logs are
+    still read, but not written. Early logs of version 2 have zero device indices, so all their
+    events come from unknown device. A record with zero key reports removal of the device.
+**/
+namespace recording {
+
+    // ---------------------------------------------------------------------------------------------
+    // error_t
+    // ---------------------------------------------------------------------------------------------
+
+    class error_t: public std::runtime_error {
+        public:
+            using std::runtime_error::runtime_error;
+    }; // class error_t
+
+    // ---------------------------------------------------------------------------------------------
+    // File format
+    // ---------------------------------------------------------------------------------------------
+
+    struct header_t {
+        char          magic[ 8 ];       ///< `"TAPPERLG"`.
+        std::uint32_t version;          ///< Format version, currently 2.
+        std::uint32_t record_size;      ///< Size of a record, in bytes.
+    };
+
+    struct record_t {
+        std::uint64_t time;             ///< `event_t::time`, in microseconds.
+        std::uint16_t key;              ///< `event_t::key` code.
+        std::uint8_t  state;            ///< `event_t::state`: 0 — released, 1 — pressed.
+        std::uint8_t  reserved0;        ///< Zero.
+        std::uint16_t device;           ///< `event_t::device`.
+        std::uint8_t  reserved[ 2 ];    ///< Zeros.
+    };
+
+    /** Record of version 1 log. **/
+    struct record_v1_t {
+        std::uint32_t time;             ///< `event_t::time`, in milliseconds.
+        std::uint16_t key;              ///< `event_t::key` code.
+        std::uint8_t  state;            ///< `event_t::state`: 0 — released, 1 — pressed.
+        std::uint8_t  reserved;         ///< Zero.
+    };
+
+    // ---------------------------------------------------------------------------------------------
+    // recorder_t
+    // ---------------------------------------------------------------------------------------------
+
+    /**
+        Writes input events to a log. Events are collected in a fixed buffer, which is written
+        to the file when it is full, when `flush()` is called, and on destruction. Thus, recording
+        an event usually costs a copy of 16 bytes, with no system calls and no memory allocation.
+    **/
+    class recorder_t: public object_t {
+
+        public:
+
+            /** Creates (or truncates) the file and writes the log header. **/
+            explicit recorder_t( string_t const & path );
+            ~recorder_t();
+
+            void write( listener_t::event_t const & event );
+            void flush();
+
+        private:
+
+            static size_t constexpr buffer_size = 512;
+
+            posix::file_t   _file;
+            record_t        _buffer[ buffer_size ];
+            size_t          _count { 0 };       ///< Number of records in the buffer.
+
+    }; // class recorder_t
+
+    // ---------------------------------------------------------------------------------------------
+    // reader_t
+    // ---------------------------------------------------------------------------------------------
+
+    /**
+        Maps a log into memory and provides random access to its events.
+    **/
+    class reader_t: public object_t {
+
+        public:
+
+            /** Opens and maps the log. Throws `error_t` if the file is not a valid log. **/
+            explicit reader_t( string_t const & path );
+
+            /** Returns number of events in the log. **/
+            size_t              size() const;
+
+            /** Returns `index`-th event. `index` must be less than `size()`. **/
+            listener_t::event_t event( size_t index ) const;
+
+        private:
+
+            posix::file_t       _file;
+            posix::mapping_t    _mapping;
+            record_t const *    _records { nullptr };
+            record_v1_t const * _records_v1 { nullptr };    ///< Records of version 1 log.
+            size_t              _size { 0 };
+
+    }; // class reader_t
+
+}; // namespace recording
+}; // namespace tapper
+
+#endif // _TAPPER_RECORDING_HPP_
+
+// end of file //
@@ -100,6 +100,7 @@ static bell_to_str_t const bell_to_str {
     { settings_t::bell_t::unset,        "unset",    },
     { settings_t::bell_t::disabled,     "disabled", },
     { settings_t::bell_t::enabled,      "enabled",  },
+    { settings_t::bell_t::always,       "always",   },
 };
 
 static listener_to_str_t const listener_to_str {
@@ -107,6 +108,8 @@ static listener_to_str_t const listener_to_str {
     { settings_t::listener_t::Auto,     "auto",     },
     { settings_t::listener_t::libinput, "libinput", },
     { settings_t::listener_t::xrecord,  "xrecord",  },
+    { settings_t::listener_t::evdev,    "evdev",    },
+    { settings_t::listener_t::xi2,      "xi2",      },
 };
 
 static layouter_to_str_t const layouter_to_str {
@@ -162,6 +165,7 @@ settings_t::reset(
         g_settings->reset( "emitter" );
         g_settings->reset( "bell" );
         g_settings->reset( "assignments" );
+        g_settings->reset( "chords" );
         // Make sure changes are really applied:
         g_settings_sync(); // glibmm does not have such a function, let's call gio directly.
     #else
@@ -179,6 +183,7 @@ settings_t::reset(
     using g_key_t         = int_t;
     using g_actions_t     = string_t;
     using g_assignments_t = std::map< g_key_t, g_actions_t >;
+    using g_chords_t      = std::map< string_t, g_actions_t >;  ///< Chords are `29+97` strings.
     using g_settings_t    = Glib::RefPtr< Gio::Settings >;
 
     /**
@@ -244,6 +249,37 @@ settings_t::reset(
         return result;
     };
 
+    /** Loads chord assignments from GSettings and adds them to `assignments`. **/
+    static
+    void
+    load_chords(
+        g_settings_t &      settings,
+        string_t const &    name,           ///< Key name.
+        assignments_t &     assignments     ///< Assignments to add chords to.
+    ) {
+        using error_t = val_error_t;
+        try {
+            Glib::Variant< g_chords_t > variant;
+            settings->get_value( name, variant );
+            for ( auto const & g_chord: variant.get() ) {
+                auto const trigger = val< trigger_t >( g_chord.first );
+                for ( auto const key: trigger.keys() ) {
+                    try {
+                        key_t::range_t().check( key );
+                    } catch ( error_t const & ex ) {
+                        ERR( "Bad key " << q( str( key ) ) << ": " << ex.what() );
+                    };
+                };
+                if ( not trigger.is_chord() ) {
+                    ERR( "Bad chord " << q( g_chord.first ) << ": a single key." );
+                };
+                assignments[ trigger ] = val< actions_t >( g_chord.second );
+            };
+        } catch ( error_t const & ex ) {
+            ERR( "Bad " << name << ": " << ex.what() );
+        };
+    };
+
     /**
         Saves enum value to GSettings. If value less than zero, resets GSettings key to default
         value. (By convention, all `settings_t` enums has `unset` constant with value `-1`. Saving
@@ -271,11 +307,29 @@ settings_t::reset(
     ) {
         g_assignments_t g_assignments;
         for ( auto const & assignment: assignments ) {
-            g_assignments[ assignment.first.code() ] = str( assignment.second );
+            if ( not assignment.first.is_chord() ) {
+                g_assignments[ assignment.first.key().code() ] = str( assignment.second );
+            };
         };
         settings->set_value( name, Glib::Variant< g_assignments_t >::create( g_assignments ) );
     };
 
+    /** Saves chord assignments to GSettings. **/
+    void
+    save_chords(
+        g_settings_t &          settings,
+        string_t const &        name,       ///< Key name.
+        assignments_t const &   assignments ///< Assignments to save chords of.
+    ) {
+        g_chords_t g_chords;
+        for ( auto const & assignment: assignments ) {
+            if ( assignment.first.is_chord() ) {
+                g_chords[ str( assignment.first ) ] = str( assignment.second );
+            };
+        };
+        settings->set_value( name, Glib::Variant< g_chords_t >::create( g_chords ) );
+    };
+
 #endif // WITH_GLIB
 
 /** Load settings from GSettings database. **/
@@ -292,6 +346,7 @@ settings_t::load(
             r.emitter     = load_enum< emitter_t  >( g_settings, "emitter"  );
             r.bell        = load_enum< bell_t     >( g_settings, "bell"     );
             r.assignments = load_assignments( g_settings, "assignments" );
+            load_chords( g_settings, "chords", r.assignments );
             DBG( "Settings loaded: " << r );
         } catch ( error_t const & ex ) {
             ERR( "Bad settings: " << ex.what() );
@@ -315,6 +370,7 @@ settings_t::save(
         save_enum( g_settings, "bell",     int( bell     ) );
         // Assignments:
         save_assignments( g_settings, "assignments", assignments );
+        save_chords( g_settings, "chords", assignments );
         // Make sure changes are really applied:
         g_settings_sync(); // glibmm does not have such a function, let's call gio directly.
         DBG( "Settings saved: " << * this );
@@ -47,12 +47,13 @@ namespace tapper {
 **/
 struct settings_t {
 
-    /** Bell status: disabled or enabled. **/
+    /** Bell status: disabled, enabled, or always. **/
     enum class bell_t {
         unset = -1,     ///< Bell status is not set yet.
         disabled,       ///< Layout activation will *not* be accompanied by a bell.
         enabled,        ///< Layout activation will be accompanied by a bell.
-        max = enabled,
+        always,         ///< Like `enabled`, but ring even if the layout is already active.
+        max = always,
     };
 
     /**
@@ -64,7 +65,9 @@ struct settings_t {
         Auto,           // `auto` is a C++ keyword.
         libinput,
         xrecord,
-        max = xrecord,
+        evdev,
+        xi2,
+        max = xi2,
     };
 
     /**
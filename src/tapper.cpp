@@ -29,8 +29,39 @@
 
 #include "tapper.hpp"
 
+#include "flight.hpp"
+#include "metrics.hpp"
+#include "string.hpp"
+
 namespace tapper {
 
+/**
+    Returns keys which may break a tap: if such a key is pressed while an assigned key is held
+    down, releasing the assigned key is not a tap. These are keys of the main keyboard block,
+    cursor keys, and mouse buttons, i. e. keys which are usually pressed together with modifiers.
+    Multimedia keys, power buttons, etc, are not included: devices which have only such keys are
+    not worth listening to.
+**/
+static
+keys_t
+tap_breakers(
+) {
+    using range_t = t::range_t< key_t::rep_t >;
+    static range_t const ranges[] = {
+        range_t(   1,  88 ),                        // KEY_ESC … KEY_F12.
+        range_t(  96, 111 ),                        // KEY_KPENTER … KEY_DELETE.
+        range_t( 125, 127 ),                        // KEY_LEFTMETA … KEY_COMPOSE.
+        range_t( key_t::btn_min, key_t::btn_max ),  // Mouse buttons.
+    };
+    keys_t keys;
+    for ( auto const & range: ranges ) {
+        for ( auto code = range.min; code <= range.max; ++ code ) {
+            keys.insert( key_t( code ) );
+        };
+    };
+    return keys;
+};
+
 // -------------------------------------------------------------------------------------------------
 // tapper_t
 // -------------------------------------------------------------------------------------------------
@@ -44,9 +75,9 @@ tapper_t::tapper_t(
     _listener( listener ),
     _layouter( layouter ),
     _emitter( emitter ),
+    _executor( layouter, emitter ),
     _repeat_delay( _layouter.repeat_delay() ),
-    _key_range( _listener.key_range() ),
-    _key_state( uint_t( _key_range.max ) + 1, false )
+    _key_range( _listener.key_range() )
 {
     if ( _repeat_delay == 0 ) {
         _repeat_delay = 500;
@@ -62,89 +93,266 @@ tapper_t::~tapper_t(
 void
 tapper_t::start(
     assignments_t const & assignments,
-    bool                  bell,
+    settings_t::bell_t    bell,
     bool                  show_taps
 ) {
-    _assignments = assignments;
     _show_taps = show_taps;
-    keys_t keys;
-    for ( auto const & assignment: _assignments ) {
+    _compile( assignments );
+    strings_t names( key_count );
+    for ( auto code = _key_range.min; code <= _key_range.max; ++ code ) {
+        names[ code ] = _listener.key_name( key_t( code ) );
+    };
+    metrics().listener( _listener.type(), names );
+    keys_t    keys;
+    layouts_t layouts;
+    for ( auto const & assignment: assignments ) {
         for ( auto const action: assignment.second ) {
             if ( action.type() != action_t::type_t::activate_layout ) {
                 keys.insert( action.key() );
+            } else {
+                layouts.insert( action.layout() );
             };
         };
     };
     _emitter.start( keys );
     _layouter.start(
         bell,
-        [ this ]( bool active ) { _active = active; }
+        layouts,
+        [ this ]( bool active ) { _active = active; metrics().session( active ); }
         /*
             If user session is not active, deactivate tapper as well, and activate tapper when the
             user session becomes active.
         */
     );
-    _listener.start( std::bind( & tapper_t::_on_event, this, std::placeholders::_1 ) );
+    _executor.start();
+    /*
+        Let the listener ignore devices which can produce neither assigned keys nor keys which
+        break taps. In "show taps" mode the user wants to discover keys, so all the devices are
+        interesting.
+    */
+    keys_t interesting;
+    if ( not _show_taps ) {
+        interesting = tap_breakers();
+        for ( auto const & assignment: assignments ) {
+            auto const & keys = assignment.first.keys();
+            interesting.insert( keys.begin(), keys.end() );
+        };
+    };
+    _listener.start(
+        listener_t::on_events_t::make< tapper_t, & tapper_t::_on_events >( this ),
+        interesting
+    );
 }; // start
 
 void
 tapper_t::stop(
 ) {
     _listener.stop();
+    if ( _recorder ) {
+        _recorder->flush();
+    };
+    _executor.stop();
     _layouter.stop();
     _emitter.stop();
+    if ( _show_taps ) {
+        for ( auto const & line: latency().report() ) {
+            OUT( line );
+        };
+    };
 }; // stop
 
 void
-tapper_t::_on_event(
-    event_t const & event
+tapper_t::record(
+    string_t const & path
+) {
+    _recorder.reset( new recording::recorder_t( path ) );
+}; // record
+
+void
+tapper_t::_compile(
+    assignments_t const & assignments
+) {
+    _programs.fill( program_t() );
+    _chords.clear();
+    _chord_keys.reset();
+    _program_keys.clear();
+    /*
+        Collect all the emitted keys first: programs point into `_program_keys`, so the vector
+        must not be reallocated after the first program is compiled.
+    */
+    for ( auto const & assignment: assignments ) {
+        for ( auto const & action: assignment.second ) {
+            if ( action.type() == action_t::type_t::emit_key_tap ) {
+                _program_keys.push_back( action.key() );
+            };
+        };
+    };
+    key_t const * keys = _program_keys.data();
+    for ( auto const & assignment: assignments ) {
+        auto const & trigger = assignment.first;
+        program_t program;
+        program.keys = keys;
+        size_t layouts = 0;
+        for ( auto const & action: assignment.second ) {
+            switch ( action.type() ) {
+                case action_t::type_t::none: {
+                } break;
+                case action_t::type_t::activate_layout: {
+                    /*
+                        A program activates one layout: intermediate activations would be skipped
+                        by the executor anyway, so only the last layout is kept.
+                    */
+                    program.layout = action.layout();
+                    ++ layouts;
+                } break;
+                case action_t::type_t::emit_key_tap: {
+                    ++ program.size;
+                } break;
+            };
+        };
+        if ( layouts > 1 ) {
+            WRN(
+                "Assignment of " << trigger.str() << " activates " << layouts << " layouts, "
+                "only the last one is activated."
+            );
+        };
+        keys += program.size;
+        if ( trigger.is_chord() ) {
+            state_t mask;
+            for ( auto const key: trigger.keys() ) {
+                mask.set( key.code() );
+            };
+            _chords[ mask ] = program;
+            _chord_keys |= mask;
+        } else {
+            _programs[ trigger.key().code() ] = program;
+        };
+    };
+}; // _compile
+
+/**
+    Handles a batch of events read by the listener at one wakeup. The clock is read once per
+    batch: all the events of the batch entered the tapper at the same time.
+**/
+void
+tapper_t::_on_events(
+    event_t const * events,
+    size_t          count
 ) {
     TRACE();
+    stamp_t const entry = latency_t::now();
+    metrics().events( count );
+    for ( size_t i = 0; i < count; ++ i ) {
+        _on_event( events[ i ], entry );
+    };
+}; // _on_events
+
+void
+tapper_t::_on_event(
+    event_t const & event,
+    stamp_t         entry
+) {
+    if ( _recorder ) {
+        _recorder->write( event );
+    };
+    if ( event.key.code() == key_t::none and event.device != 0 ) {
+        _on_removed( event.device );
+        return;
+    };
+    switch ( _listener.devices().policy( event.device ) ) {
+        case listener_t::device_policy_t::normal: {
+        } break;
+        case listener_t::device_policy_t::state_only: {
+            _on_state_only( event );
+            return;
+        };
+        case listener_t::device_policy_t::ignore: {
+            return;
+        };
+    };
+    stamp_t const kernel = latency_t::event_stamp( event.time, entry );
+    latency().record( latency_t::stage_t::listener, kernel, entry );
+    flight().record(
+        flight_t::kind_t::event, kernel ? kernel : entry, entry, event.key.code(),
+        std::uint8_t( event.state )
+    );
     if ( _key_range.includes( event.key.code() ) ) {
+        auto & key_state = _key_states[ event.device < devices_t::capacity ? event.device : 0 ];
         if ( event.state == key_state_t::pressed ) {
-            if ( _key_state[ int_t( event.key.code() ) ] ) {
-                DBG( _pressed_keys << "↓ ~" << event.key );
+            if ( key_state[ event.key.code() ] ) {
+                DBG( key_state.count() << "↓ ~" << event.key );
                 if ( event.key == _last_key ) {
                     /*
                         Look like key press is autorepeating. Do I have autorepeat timeout for
-                        free? Nope. libinput does not report autorepeating at all. XRecord does,
-                        but it also could be a key on *another* keyboard. It is not very common,
-                        but real case.
+                        free? Nope. libinput does not report autorepeating at all. XRecord and
+                        evdev do, but it also could be a key on *another* keyboard. It is not very
+                        common, but real case.
                     */
                 }; // if
                 /*
-                    No need in updating keyboard state -- we already know the key is pressed.
-                    Number of pressed keys is not changed too. But let us reset the last pressed
-                    key -- if autorepeating takes place this is not a tap.
+                    No need in updating keyboard state -- we already know the key is pressed. But
+                    let us reset the last pressed key -- if autorepeating takes place this is not a
+                    tap (nor a chord).
                 */
-                _last_key = key_t();
+                _last_key    = key_t();
+                _peak_broken = true;
             } else {
                 // Update keyboard state:
-                DBG( _pressed_keys << "↓ +" << event.key );
-                _key_state[ event.key.code() ] = true;
-                _pressed_keys += 1;
+                DBG( key_state.count() << "↓ +" << event.key );
+                if ( key_state.none() or event.device != _peak_device ) {
+                    _peak.reset();
+                    _peak_device = event.device;
+                    _peak_at     = event.time;
+                    _peak_broken = false;
+                };
+                _peak.set( event.key.code() );
+                key_state.set( event.key.code() );
                 _last_key      = event.key;
+                _last_device   = event.device;
                 _pressed_at    = event.time;
             }; // if
         } else {
-            DBG( _pressed_keys << "↓ -" << event.key );
+            DBG( key_state.count() << "↓ -" << event.key );
             /*
-                This check is a must because unconditional decreasing `_pressed_keys` may cause
-                wrong result. For example, if the program started from the command line, the first
-                received event will likely be releasing of Enter key.
+                Note that the key may be not pressed. For example, if the program started from the
+                command line, the first received event will likely be releasing of Enter key.
             */
-            if ( _key_state[ event.key.code() ] ) {
-                _key_state[ event.key.code() ] = false;
-                assert( _pressed_keys > 0 );
-                -- _pressed_keys;
-            };
+            key_state.reset( event.key.code() );
+            bool const last = event.key == _last_key and event.device == _last_device;
+            bool const alone = key_state.none() and _held_state_only == 0;
+            bool chord = false;
             if (
-                event.key == _last_key
-                and _pressed_keys == 0
-                and event.time - _pressed_at <= _repeat_delay
+                alone
+                and not _peak_broken
+                and event.device == _peak_device
+                and event.time - _peak_at <= stamp_t( _repeat_delay ) * 1000
+                and not _chords.empty()
+                and ( _peak & ~ _chord_keys ).none()
+            ) {
+                auto const it = _chords.find( _peak );
+                if ( it != _chords.end() ) {
+                    DBG( "⇵" << _peak.count() << " keys" );
+                    _on_chord( it->first, it->second, event.key, kernel, entry );
+                    chord = true;
+                };
+            };
+            if ( key_state.none() and event.device == _peak_device ) {
+                _peak_broken = true;
+            };
+            if ( chord ) {
+                // The chord is tapped, the release of its last key is not a tap.
+            } else if (
+                last
+                and alone
+                and event.time - _pressed_at <= stamp_t( _repeat_delay ) * 1000
             ) {
                 DBG( "⇵" << event.key );
-                _on_tap( event.key );
+                _on_tap( event.key, kernel, entry );
+            } else if ( last ) {
+                auto const reason = alone ? flight_t::skip_t::held : flight_t::skip_t::chord;
+                flight().record(
+                    flight_t::kind_t::skip, entry, entry, event.key.code(), std::uint8_t( reason )
+                );
             }; // if
             _last_key = key_t();
         }; // if
@@ -155,11 +363,100 @@ tapper_t::_on_event(
     }; // if
 };
 
+/**
+    Handles an event of a `state_only` device: only keyboard state of the device is updated, the
+    event does not make or break a tap, and is not counted in latency statistics.
+**/
+void
+tapper_t::_on_state_only(
+    event_t const & event
+) {
+    if ( not _key_range.includes( event.key.code() ) or event.device >= devices_t::capacity ) {
+        return;
+    };
+    auto & key_state = _key_states[ event.device ];
+    bool const pressed = event.state == key_state_t::pressed;
+    if ( key_state[ event.key.code() ] != pressed ) {
+        key_state.flip( event.key.code() );
+        if ( pressed ) {
+            ++ _held_state_only;
+        } else {
+            -- _held_state_only;
+        };
+    };
+}; // _on_state_only
+
+/**
+    Forgets keyboard state of the removed device. The device index may be reused by a new device,
+    which should not inherit keys held on the removed one. The device policy is still available:
+    the listener unregisters the device after the handler sees the removal.
+**/
+void
+tapper_t::_on_removed(
+    device_t device
+) {
+    if ( device >= devices_t::capacity ) {
+        return;
+    };
+    auto & key_state = _key_states[ device ];
+    DBG( "Device #" << uint_t( device ) << " removed, " << key_state.count() << " keys held." );
+    if ( _listener.devices().policy( device ) == listener_t::device_policy_t::state_only ) {
+        _held_state_only -= key_state.count();
+    };
+    key_state.reset();
+    if ( _last_device == device ) {
+        _last_key = key_t();
+    };
+    if ( _peak_device == device ) {
+        _peak_broken = true;
+    };
+}; // _on_removed
+
+/**
+    Like `_on_tap()`, but for a chord. `key` is the key released last, it is recorded by the
+    flight recorder.
+**/
+void
+tapper_t::_on_chord(
+    state_t const &     chord,
+    program_t const &   program,
+    key_t               key,
+    stamp_t             event,
+    stamp_t             entry
+) {
+    TRACE();
+    stamp_t const detected = latency_t::now();
+    latency().record( latency_t::stage_t::detector, entry, detected );
+    flight().record( flight_t::kind_t::chord, detected, detected, key.code(), _active );
+    if ( not _active ) {
+        return;
+    };
+    if ( _show_taps ) {
+        strings_t names;
+        for ( size_t code = 0; code < key_count; ++ code ) {
+            if ( chord[ code ] ) {
+                names.push_back( _listener.key_full_name( key_t( code ) ) );
+            };
+        };
+        OUT( "Keys " << join( "+", names ) << " tapped." );
+        return;
+    };
+    if ( program.layout.index != 0 or program.size != 0 ) {
+        _executor.execute( program, event );
+    };
+}; // _on_chord
+
 void
 tapper_t::_on_tap(
-    key_t  key
+    key_t   key,
+    stamp_t event,
+    stamp_t entry
 ) {
     TRACE();
+    stamp_t const detected = latency_t::now();
+    latency().record( latency_t::stage_t::detector, entry, detected );
+    metrics().tap( key );
+    flight().record( flight_t::kind_t::tap, detected, detected, key.code(), _active );
     if ( not _active ) {
         return;
     };
@@ -167,24 +464,9 @@ tapper_t::_on_tap(
         OUT( "Key " << _listener.key_full_name( key ) << " tapped." );
         return;
     };
-    auto it = _assignments.find( key );
-    if ( it != _assignments.end() ) {
-        for ( auto const & action: it->second ) {
-            DBG( "Executing action " << action << "…" );
-            switch ( action.type() ) {
-                case action_t::type_t::none: {
-                } break;
-                case action_t::type_t::activate_layout: {
-                    _layouter.activate( action.layout() );
-                } break;
-                case action_t::type_t::emit_key_tap: {
-                    _emitter.emit( {
-                        { action.key(), key_state_t::pressed  },
-                        { action.key(), key_state_t::released },
-                    } );
-                } break;
-            };
-        };
+    auto const & program = _programs[ key.code() ];
+    if ( program.layout.index != 0 or program.size != 0 ) {
+        _executor.execute( program, event );
     };
 };
 
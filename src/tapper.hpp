@@ -34,11 +34,17 @@
 
 #include "base.hpp"
 
+#include <array>
 #include <atomic>
+#include <bitset>
+#include <unordered_map>
 
 #include "emitter.hpp"
+#include "executor.hpp"
+#include "latency.hpp"
 #include "layouter.hpp"
 #include "listener.hpp"
+#include "recording.hpp"
 #include "settings.hpp"
 #include "types.hpp"
 
@@ -53,7 +59,8 @@ namespace tapper {
 
     The tapper looks at keyboard events (provided by a listener) detects taps, if an assigned key
     is tapped, tapper executes corresponding series of actions — activates keyboard layouts (with
-    help from a layouter) and/or emulates keystrokes (with help from an emitter).
+    help from a layouter) and/or emulates keystrokes (with help from an emitter). Actions are
+    executed asynchronously by an executor, so a slow layouter does not delay input processing.
 
     A layouter may notify the tapper when the user session becomes active or inactive (currently
     only the GNOME layouter can do this). If the user session is inactive, the tapper continues to
@@ -61,6 +68,20 @@ namespace tapper {
     Detecting the inactive user session is important only for the libinput listers, though, since
     the XRecord listener do not receive input events from another session anyway.
 
+    If the listener tells input devices apart, keyboard state is kept per device: keys held on one
+    device do not prevent taps on another one, though a key press on any device still breaks a tap
+    in progress. Devices with `state_only` policy never make or break taps, only their keyboard
+    state is tracked, and a key held on such a device prevents taps (the device acts as a set of
+    modifiers). Events of ignored devices are dropped. When a device is removed, its keyboard state
+    is forgotten, so keys held on an unplugged device do not prevent taps forever.
+
+    Besides single keys, chords can be assigned: a chord is tapped when all its keys are pressed on
+    one device and then released within the repeat delay, with no other keys pressed in between.
+    Keys pressed since the device had no keys pressed are collected in the "peak" key mask; when
+    the last key is released, the peak mask is looked up among precompiled chord masks, so the
+    matching cost does not depend on the number of chords. If a chord matches, the release of its
+    last pressed key is not a single-key tap.
+
     Usage:
 
     @code
@@ -92,36 +113,68 @@ class tapper_t: public object_t {
         /**
             Starts the tapper.
 
-            @param bell — If `true`, layout activation will be accompanied by a sound ("the bell
-            will ring"). If `false`, the bell will not ring. Note, that layoter is responsible for
-            sound, not tapper. Some layouts can't ring the bell.
+            @param bell — If `enabled`, layout activation will be accompanied by a sound ("the bell
+            will ring"). If `always`, the bell will ring even if the layout is already active. If
+            `disabled`, the bell will not ring. Note, that layoter is responsible for sound, not
+            tapper. Some layouts can't ring the bell.
 
             @param show_taps — If `true`, tapper will print a message to standard output stream
             "Key *code*:*name* tapped.". It is useful to discover key codes and names. If `false`,
-            tapper will not print such messages.
+            tapper will not print such messages. Latency statistics are printed when the tapper
+            stops.
         **/
-        void start( assignments_t const & assignments, bool bell = false, bool show_taps = false );
+        void start(
+            assignments_t const &   assignments,
+            settings_t::bell_t      bell        = settings_t::bell_t::disabled,
+            bool                    show_taps   = false
+        );
 
         /**
             Stops the tapper. Tapper, in turn, will stop listener, layouer and emitter.
         **/
         void stop();
 
+        /**
+            Records all the input events reported by the listener to the given file, see
+            `recording::recorder_t`. Should be called before `start()`.
+        **/
+        void record( string_t const & path );
+
     private:            // types
 
-        using event_t = listener_t::event_t;
+        using event_t   = listener_t::event_t;
+        using program_t = executor_t::program_t;
+        using devices_t = listener_t::devices_t;
+        using device_t  = listener_t::device_t;
+
+        /** Number of possible key codes, including `key_t::none`. **/
+        static size_t constexpr key_count = size_t( key_t::max ) + 1;
+
+        /** Keyboard state of a device. **/
+        using state_t = std::bitset< key_count >;
+
+        /** Chord programs by chord key masks. **/
+        using chords_t = std::unordered_map< state_t, program_t >;
 
     private:            // methods
 
-        void _on_event( event_t const & event );
-        void _on_tap( key_t key );
+        void _compile( assignments_t const & assignments );
+        void _on_events( event_t const * events, size_t count );
+        void _on_event( event_t const & event, stamp_t entry );
+        void _on_state_only( event_t const & event );
+        void _on_removed( device_t device );
+        void _on_tap( key_t key, stamp_t event, stamp_t entry );
+        void _on_chord(
+            state_t const & chord, program_t const & program, key_t key, stamp_t event,
+            stamp_t entry
+        );
 
     private:            // data
 
         listener_t &  _listener;
         layouter_t &  _layouter;
         emitter_t &   _emitter;
-        assignments_t _assignments;
+        executor_t    _executor;
         bool          _show_taps { false };
         time_t        _repeat_delay { 0 };
             // TODO: Update it?
@@ -129,17 +182,35 @@ class tapper_t: public object_t {
         key_t::range_t _key_range;
 
         /**
-            Keyboard state. It maps keys to boolean values. `true` means the corresponding key is
-            pressed now, `false` means the key is not pressed.
+            Assignments compiled into programs, indexed by key code. Keys without assignments have
+            empty programs. The table is filled by `_compile()` when the tapper starts and is not
+            changed after that, so a tap costs a single indexed load.
+        **/
+        std::array< program_t, key_count > _programs;
+
+        /** Chord assignments compiled into programs. Filled by `_compile()` as well. **/
+        chords_t _chords;
+
+        /**
+            Union of all the chord masks. A peak with a key out of this mask can't be a chord, so
+            most peaks are rejected by a few word-wide operations, without a lookup.
         **/
-        std::vector< bool > _key_state;
+        state_t _chord_keys;
 
         /**
-            Number of currently pressed keys. The number of currently pressed keys can be achieved
-            from `_key_state`, but scanning the `_key_state` is rather slow. Maintaining number of
-            pressed keys is simple and fast.
+            Keys emitted by all the programs. Programs point into this vector, so it must not be
+            changed after compilation.
         **/
-        uint_t _pressed_keys { 0 };
+        std::vector< key_t > _program_keys;
+
+        /**
+            Keyboard state, indexed by device. A bit is set if the corresponding key is pressed
+            now on the device. Number of pressed keys is the number of set bits.
+        **/
+        std::array< state_t, devices_t::capacity > _key_states;
+
+        /** Number of keys pressed now on all the `state_only` devices. **/
+        size_t _held_state_only { 0 };
 
         /**
             Key code of the last pressed key or 0. Used to detect taps: if code of released key
@@ -147,11 +218,32 @@ class tapper_t: public object_t {
         **/
         key_t _last_key;
 
+        /** Device of the last pressed key. Meaningful only if `_last_key` is not 0. **/
+        device_t _last_device { 0 };
+
         /**
             Time of the last key press event, which code was saved in `last_pressed_key`.
             Meaningful only if `last_pressed_key` is not 0.
         **/
-        time_t _pressed_at { 0 };
+        stamp_t _pressed_at { 0 };
+
+        /**
+            Keys pressed on `_peak_device` since the device had no keys pressed. When the last key
+            is released, the peak is a chord candidate.
+        **/
+        state_t _peak;
+
+        /** Device the peak was collected on. **/
+        device_t _peak_device { 0 };
+
+        /** Time of the first key press of the peak. **/
+        stamp_t _peak_at { 0 };
+
+        /**
+            `true` if the peak can't be a chord: a key was autorepeated, or the peak was already
+            checked.
+        **/
+        bool _peak_broken { true };
 
         /**
             `true`, if tapper is active, and `false` otherwise. If tapper is not active, it
@@ -163,6 +255,9 @@ class tapper_t: public object_t {
         **/
         std::atomic< bool > _active { true };
 
+        /** Input event recorder, if recording is requested. **/
+        ptr_t< recording::recorder_t > _recorder;
+
 }; // class tapper_t
 
 }; // namespace tapper
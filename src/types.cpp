@@ -220,6 +220,50 @@ has_any_key_emits(
     return it != actions.end();
 };
 
+// -------------------------------------------------------------------------------------------------
+// trigger_t
+// -------------------------------------------------------------------------------------------------
+
+string_t
+trigger_t::str(
+) const {
+    strings_t strings;
+    for ( auto const key: _keys ) {
+        strings.push_back( tapper::str( key ) );
+    };
+    return join( "+", strings );
+};
+
+template<>
+trigger_t
+val< trigger_t >(
+    string_t const & string
+) {
+    using error_t = val_error_t;
+    keys_t keys;
+    try {
+        for ( auto const & key: split( '+', string ) ) {
+            keys.insert( val< key_t >( trim( key ) ) );
+        };
+    } catch ( error_t const & ex ) {
+        ERR( "Bad trigger " << q( string ) << ": " << ex.what() );
+    };
+    if ( keys.empty() ) {
+        ERR( "Bad trigger " << q( string ) << ": no keys." );
+    };
+    return trigger_t( keys );
+};
+
+TEST(
+    ASSERT_EQ( str( trigger_t( key_t( 29 ) ) ), "29" );
+    ASSERT( not trigger_t( key_t( 29 ) ).is_chord() );
+    auto const chord = val< trigger_t >( "97 + 29" );
+    ASSERT( chord.is_chord() );
+    ASSERT_EQ( str( chord ), "29+97" );
+    ASSERT( val< trigger_t >( "29+29" ) == trigger_t( key_t( 29 ) ) );
+    ASSERT( trigger_t( key_t( 29 ) ) < chord );
+);
+
 // -------------------------------------------------------------------------------------------------
 // assignments_t
 // -------------------------------------------------------------------------------------------------
@@ -52,10 +52,16 @@ namespace tapper {
 /// @{
 
 /**
-    Integer type to represent event's time in milliseconds.
+    Integer type to represent time interval in milliseconds.
 **/
 using time_t = uint_t;
 
+/**
+    Monotonic time stamp in microseconds. Zero means "unknown". 64 bits do not wrap within any
+    reasonable uptime.
+**/
+using stamp_t = std::uint64_t;
+
 /**
     Layout index.
 **/
@@ -199,8 +205,54 @@ template<> actions_t val< actions_t >( string_t const & string );
 bool has_any_layout_activations( actions_t const & actions );
 bool has_any_key_emits( actions_t const & actions );
 
+/**
+    Tap trigger: either a single key, or a chord — a set of keys pressed together and released.
+    A trigger is implicitly constructed from a key, so single-key assignments look as before.
+**/
+class trigger_t {
+
+    public:
+
+        using myself_t = trigger_t;
+
+        trigger_t( key_t key ): _keys{ key } {};
+        explicit trigger_t( keys_t const & keys ): _keys( keys ) { assert( not keys.empty() ); };
+
+        /** Returns `true` if the trigger is a chord, i. e. includes more than one key. **/
+        bool is_chord() const { return _keys.size() > 1; };
+
+        /** Returns the key of a single-key trigger. Do not call it for a chord. **/
+        key_t key() const {
+            assert( not is_chord() );
+            return * _keys.begin();
+        };
+
+        /** Returns all the keys of the trigger. **/
+        keys_t const & keys() const { return _keys; };
+
+        bool operator <( myself_t const & that ) const { return _keys < that._keys; };
+        bool operator ==( myself_t const & that ) const { return _keys == that._keys; };
+
+        /** Key codes joined with `+`, e. g. `29+97`. **/
+        string_t str() const;
+
+    private:
+
+        keys_t _keys;
+
+}; // class trigger_t
+
+/** @ingroup val
+    Converts string to `trigger_t` value. It is reverse operation for `str( trigger_t )`.
+**/
+template<> trigger_t val< trigger_t >( string_t const & string );
+
+/** Set of triggers. **/
+using triggers_t = std::set< trigger_t >;
+using triggers_p = ptr_t< triggers_t >;
+
 /** Key assignments. **/
-using assignments_t = std::map< key_t, actions_t >;
+using assignments_t = std::map< trigger_t, actions_t >;
 
 /** @ingroup str
     Converts `assignments_t` value to string.
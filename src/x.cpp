@@ -30,12 +30,14 @@
 #include "x.hpp"
 
 #include <limits>
+#include <map>
 
 #include <unistd.h>
 
 #include <X11/extensions/XTest.h>
 
 #include "linux.hpp"
+#include "reactor.hpp"
 #include "string.hpp"
 #include "test.hpp"
 
@@ -50,34 +52,9 @@ str( Display * const & value ) {
 
 namespace x {
 
-static XErrorHandler _standard_error_handler = nullptr;
-
-static
-int
-error_handler(
-    Display *       display,
-    XErrorEvent *   event
-) {
-    #if 1
-        char error_text[ 1000 ];
-        XGetErrorText( event->display, event->error_code, error_text, sizeof( error_text ) );
-        // TODO: How to decode opcode?
-        // If I could decode opcode, I would not call standard error handler.
-        ERR(
-            "Display " << display << " reports error:\n"
-            "    Display connection : " << XConnectionNumber( event->display ) << "\n"
-            "    Request number     : " << event->serial << "\n"
-            "    Opcode             : " << event->request_code << "." << event->minor_code << "\n"
-            "    Error              : " << event->error_code << " (" << error_text << ")\n"
-        );
-    #endif
-    #if 1
-        if ( _standard_error_handler ) {
-            _standard_error_handler( display, event );
-        }; // if
-    #endif
-    return 0;
-}; // error_handler
+/** Open displays, to let the error handler find `display_t` by `Display *`. **/
+static std::map< Display *, display_t * > _displays;
+static std::mutex                         _displays_mutex;
 
 // -------------------------------------------------------------------------------------------------
 // key_t
@@ -267,7 +244,7 @@ init(
     if ( not ok ) {
         ERR( "Initializing X failed" );
     }; // if
-    _standard_error_handler = XSetErrorHandler( error_handler );
+    XSetErrorHandler( display_t::_error_handler );
     DBG( "error handler installed" );
 }; // init
 
@@ -280,10 +257,16 @@ display_t::display_t(
     OBJECT_T()
 {
     TRACE();
+    static std::once_flag inited;
+    std::call_once( inited, init );
     _rep = XOpenDisplay( nullptr );
     if ( not _rep ) {
         ERR( "Opening display " << q( XDisplayName( nullptr ) ) << " failed." );
     }; // if
+    {
+        std::lock_guard< std::mutex > lock( _displays_mutex );
+        _displays[ _rep ] = this;
+    }
     DBG(
         "opened, "
             << "name " << q( XDisplayString( _rep ) ) << ", "
@@ -295,6 +278,10 @@ display_t::~display_t(
 ) {
     TRACE();
     if ( _rep ) {
+        {
+            std::lock_guard< std::mutex > lock( _displays_mutex );
+            _displays.erase( _rep );
+        }
         XCloseDisplay( _rep );  /*
             XClose has `int` result. It is not documented, but sources are available and I see that
             `XCloseDisplay` always returns zero.
@@ -323,6 +310,8 @@ display_t::flush(
     if ( not ok ) {
         ERR( "Flushing display failed." );
     }; // if
+    XEventsQueued( _rep, QueuedAfterReading );  // Let Xlib read errors, if any.
+    check();
 }; // flush
 
 void
@@ -333,8 +322,73 @@ display_t::sync(
     if ( not ok ) {
         ERR( "Synchronizing display failed." );
     }; // if
+    check();
 }; // sync
 
+void
+display_t::check(
+) {
+    string_t error;
+    {
+        std::lock_guard< std::mutex > lock( _mutex );
+        std::swap( error, _error );
+    }
+    if ( not error.empty() ) {
+        ERR( error );
+    }; // if
+}; // check
+
+/**
+    Called by Xlib when the server reports an error. The handler must not throw, so it saves the
+    error to be thrown by `check()`. Errors which come before the saved one is checked are just
+    logged.
+**/
+int
+display_t::_error_handler(
+    Display *       display,
+    XErrorEvent *   event
+) {
+    char error_text[ 1000 ];
+    XGetErrorText( event->display, event->error_code, error_text, sizeof( error_text ) );
+    auto const error = STR(
+        "Display " << display << " reports error:\n"
+        "    Display connection : " << XConnectionNumber( event->display ) << "\n"
+        "    Request number     : " << event->serial << "\n"
+        "    Opcode             : "
+            << uint_t( event->request_code ) << "." << uint_t( event->minor_code ) << "\n"
+        "    Error              : " << uint_t( event->error_code ) << " (" << error_text << ")\n"
+    );
+    std::lock_guard< std::mutex > lock( _displays_mutex );
+    auto const it = _displays.find( display );
+    display_t * self = it != _displays.end() ? it->second : nullptr;
+    THIS( self );
+    if ( not self ) {
+        WRN( error );
+        return 0;
+    }; // if
+    std::lock_guard< std::mutex > self_lock( self->_mutex );
+    if ( self->_error.empty() ) {
+        self->_error = error;
+    } else {
+        WRN( error );
+    }; // if
+    return 0;
+}; // _error_handler
+
+display_s
+shared_display(
+) {
+    static std::weak_ptr< display_t > shared;
+    static std::mutex                 mutex;
+    std::lock_guard< std::mutex > lock( mutex );
+    auto display = shared.lock();
+    if ( not display ) {
+        display = std::make_shared< display_t >();
+        shared  = display;
+    }; // if
+    return display;
+}; // shared_display
+
 // -------------------------------------------------------------------------------------------------
 // atom_t
 // -------------------------------------------------------------------------------------------------
@@ -429,12 +483,13 @@ range_t::~range_t() {
 
 context_t::context_t(
     on_intercept_t      on_intercept,
+    on_processed_t      on_processed,
     int                 datum_flags,
     XRecordClientSpec   client
 ):
     OBJECT_T(),
     _on_intercept( on_intercept ),
-    _thread( _data )
+    _on_processed( on_processed )
 {
 
     TRACE();
@@ -519,7 +574,15 @@ context_t::enable(
     if ( _state != enabled ) {
         ERR( "Record context is not really enabled." );
     }; // if
-    _thread.start();
+    /*
+        Recorded data come over the data connection. The reactor calls `_process()` when the
+        connection is ready for reading; Xlib may have buffered some data already, so process them
+        now.
+    */
+    reactor().watch(
+        _data.connection(), reactor_t::on_ready_t::make< context_t, & context_t::_process >( this )
+    );
+    _process();
 }; // enable
 
 void
@@ -551,7 +614,12 @@ context_t::disable(
                 ERR( "Disabling record context failed." );
             }; // if
             _ctrl.sync();   // Sync is a must.
-            _thread.join();
+            reactor().unwatch( _data.connection() );
+            /*
+                Syncing the data connection processes the rest of the recorded data, up to
+                `XRecordEndOfData`.
+            */
+            _data.sync();
             if ( _state != disabled ) {
                 ERR( "Record context is not really disabled." );
             }; // if
@@ -571,7 +639,7 @@ context_t::interceptor(
     XRecordInterceptData *  data
 ) {
     /*
-        (This code is executed by (non-initial) thread.)
+        (This code is executed by the reactor thread.)
         Xlib is a C library, it does not work with exception. If an exception leaked from this code,
         Xlib leaves an internal mutex locked, and program will hang. So we have to catch all the
         exceptions here.
@@ -596,26 +664,30 @@ context_t::interceptor(
             } break;
         }; // switch
     );
-    if ( not what.empty() ) {
-        context->_thread._what = what;
-        CATCH_ALL( posix::signal::kill( getpid(), SIGTERM ) );
+    if ( not what.empty() and context->_what.empty() ) {
+        context->_what = what;      // `_process()` will rethrow it.
     };
 }; // interceptor
 
-context_t::thread_t::thread_t(
-    display_t & display
-):
-    parent_t( "xctx" ),
-    _display( display )
-{
-}; // ctor
-
+/**
+    Processes recorded data which are already received. Called by the reactor when the data
+    connection is ready for reading. The interceptor can't throw through Xlib, so an error occurred
+    in the interceptor is thrown here.
+**/
 void
-context_t::thread_t::body(
+context_t::_process(
 ) {
-    TRACE();
-    _display.sync();
-}; // body
+    XRecordProcessReplies( _data );
+    if ( _on_processed ) {
+        _on_processed();
+    };
+    if ( not _what.empty() ) {
+        auto what = _what;
+        _what.clear();
+        ERR( what );
+    };
+    _data.check();
+}; // _process
 
 }; // namespace record
 
@@ -774,8 +846,10 @@ kb_t::kb_t(
     {
         int major = XkbMajorVersion;
         int minor = XkbMinorVersion;
-        int dummy1, dummy2, dummy3;
-        Bool ok = XkbQueryExtension( _display, & dummy1, & dummy2, & dummy3, & major, & minor );
+        int dummy1, dummy2;
+        Bool ok = XkbQueryExtension(
+            _display, & dummy1, & _event_base, & dummy2, & major, & minor
+        );
         if ( not ok ) {
             ERR(
                 "X keyboard extension: "
@@ -817,6 +891,60 @@ kb_t::lock_group(
     DBG( "Group " << ( group + 1 ) << " locked." );
 }; // lock_group
 
+/**
+    Returns the currently locked group. It is a round trip to the server, so the function is
+    intended to learn the initial state; further changes are reported by `XkbStateNotify` events,
+    see `select_group_events()`.
+**/
+uint_t
+kb_t::locked_group(
+) {
+    XkbStateRec state;
+    Status status = XkbGetState( _display, XkbUseCoreKbd, & state );
+    if ( status != Success ) {
+        ERR( "Getting keyboard state failed." );
+    }; // if
+    return state.locked_group;
+}; // locked_group
+
+/**
+    Asks the server to send `XkbStateNotify` events when the locked group of the core keyboard
+    changes, whoever changes it.
+**/
+void
+kb_t::select_group_events(
+) {
+    Bool ok = XkbSelectEventDetails(
+        _display, XkbUseCoreKbd, XkbStateNotify, XkbGroupLockMask, XkbGroupLockMask
+    );
+    if ( not ok ) {
+        ERR( "Selecting keyboard state events failed." );
+    }; // if
+}; // select_group_events
+
+/**
+    If the event is an `XkbStateNotify` event reporting a locked group change, stores the new
+    locked group in `group` and returns `true`. Otherwise returns `false`.
+**/
+bool
+kb_t::group_event(
+    XEvent const &  event,
+    uint_t &        group
+) const {
+    if ( event.type != _event_base + XkbEventCode ) {
+        return false;
+    }; // if
+    auto const & xkb = reinterpret_cast< XkbEvent const & >( event );
+    if (
+        xkb.any.xkb_type != XkbStateNotify
+        or not ( xkb.state.changed & XkbGroupLockMask )
+    ) {
+        return false;
+    }; // if
+    group = xkb.state.locked_group;
+    return true;
+}; // group_event
+
 void
 kb_t::bell(
 ) {
@@ -833,6 +961,155 @@ kb_t::desc(
     return desc_p( new desc_t( * this, which ) );
 }; // desc
 
+// -------------------------------------------------------------------------------------------------
+// keymap_t
+// -------------------------------------------------------------------------------------------------
+
+keymap_t::keymap_t(
+    display_t & display
+):
+    OBJECT_T(),
+    _display( display )
+{
+}; // ctor
+
+linux::key_t::range_t
+keymap_t::key_range(
+) {
+    if ( not _key_range ) {
+        /*
+            Get Xkb key range.
+        */
+        auto xkb_range = _kb_desc().key_range();
+        // Convert Xkb key range to Linux key range:
+        auto range = linux::key_t::range_t(
+            key_t( xkb_range.min ).linux().code(),
+            key_t( xkb_range.max ).linux().code()
+        );
+        DBG( "X key range: " << range << " (keys only)." );
+        /*
+            Extend key range with button codes. X button codes are sequential from `btn_t::min` to
+            `btn_t::max`, but corresponding Linux key codes may or may not be sequential, so
+            range `range_t( btn_t( btn_t::min ).linux(), btn_t( btn_t::max ).linux() )` may be
+            invalid. Let's add buttons one-by-one.
+        */
+        for ( size_t code = btn_t::min; code <= btn_t::max; ++ code ) {
+            auto key = btn_t( code ).linux();
+            if ( key.code() ) {
+                range += key.code();
+            };
+        };
+        DBG( "X key range: " << range << " (keys and buttons)." );
+        assert( range.is_valid() );
+        _key_range.reset( new linux::key_t::range_t( range ) );
+    };
+    return * _key_range.get();
+}; // key_range
+
+linux::keys_t
+keymap_t::keys(
+) {
+    linux::keys_t keys;
+    for ( auto const & it: _key2name() ) {
+        keys.insert( it.first );
+    };
+    return keys;
+}; // keys
+
+linux::key_t
+keymap_t::key(
+    string_t const & name
+) {
+    auto const & map = _name2key();
+    auto it = map.find( uc( name ) );
+    if ( it == map.end() ) {
+        return linux::key_t();
+    };
+    return it->second;
+}; // key
+
+string_t
+keymap_t::key_name(
+    linux::key_t key
+) {
+    key_range().check( key );
+    auto const & map = _key2name();
+    auto it = map.find( key );
+    if ( it == map.end() ) {
+        return "";
+    };
+    return it->second;
+}; // key_name
+
+keymap_t::key2name_t const &
+keymap_t::_key2name(
+) {
+    if ( not _key2name_rep ) {
+        key2name_t map;
+        auto const names = _kb_desc().key_names();
+        for ( size_t i = 0, end = names.size(); i < end; ++ i ) {
+            auto const & name = names[ i ];
+            if ( not name.empty() ) {
+                auto key = key_t( i ).linux();
+                map.insert( { key, name } );
+                // Indices are unique, so there is no need to check that insertion was successful.
+            };
+        };
+        for ( auto code = btn_t::min; code <= btn_t::max; ++ code ) {
+            auto key = btn_t( code ).linux();
+            if ( key.code() ) {
+                auto name = STR( "BTN" << code );
+                auto ok = map.insert( { key, name } ).second;
+                assert( ok );   // Just in case.
+                static_cast< void >( ok );
+            };
+        };
+        _key2name_rep.reset( new key2name_t( std::move( map ) ) );
+    };
+    return * _key2name_rep.get();
+}; // _key2name
+
+keymap_t::name2key_t const &
+keymap_t::_name2key(
+) {
+    if ( not _name2key_rep ) {
+        name2key_t map;
+        for ( auto const & it: _key2name() ) {
+            auto ok = map.insert( { it.second, it.first } ).second;
+            if ( not ok ) {
+                auto name = it.second;
+                auto k1   = map[ it.second ];
+                auto k2   = it.first;
+                WRN(
+                    "X Window System reported non-unique key name " << q( name ) << " "
+                        "for keys " << k1 << " and " << k2 << "; "
+                        "the first code will be used for this key name."
+                );
+            };
+        };
+        _name2key_rep.reset( new name2key_t( map ) );
+    };
+    return * _name2key_rep.get();
+}; // _name2key
+
+kb_t &
+keymap_t::_kb(
+) {
+    if ( not _kb_rep ) {
+        _kb_rep.reset( new kb_t( _display ) );
+    };
+    return * _kb_rep.get();
+}; // _kb
+
+kb_t::desc_t &
+keymap_t::_kb_desc(
+) {
+    if ( not _kb_desc_rep ) {
+        _kb_desc_rep = _kb().desc();
+    };
+    return * _kb_desc_rep.get();
+}; // _kb_desc
+
 }; // namespace x
 }; // namespace tapper
 
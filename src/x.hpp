@@ -35,6 +35,9 @@
 #include "base.hpp"
 
 #include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <stdexcept>        // std::runtime_error
 
 #include <X11/Xlib.h>
@@ -162,8 +165,8 @@ namespace x {
     };
 
     /**
-        Initializes the X Window System library. Call it in the beginning, before creating the
-        first thread.
+        Initializes the X Window System library: enables Xlib thread support and installs the error
+        handler. It is called by the first `display_t` constructor.
     **/
     void init();
 
@@ -184,6 +187,12 @@ namespace x {
     /**
         `Display *` wrapper. Calls `XOpenDisplay` in constructor, and makes sure `XCloseDisplay` is
         called in destructor.
+
+        Errors are reported by the X server asynchronously. Xlib is a C library, an exception must
+        not be thrown through it, so the error handler just saves the first error of the display,
+        and `check()` (called by `flush()` and `sync()`) throws it. Thus, requests which do not
+        have replies can be sent without a round trip: an error caused by such a request is thrown
+        by a later `flush()`.
     **/
     class display_t: public object_t {
 
@@ -196,16 +205,42 @@ namespace x {
 
             int connection() const;
 
+            /**
+                Sends buffered requests to the server, reads (without blocking) whatever the server
+                has sent already, then calls `check()`.
+            **/
             void flush();
+
+            /** Waits until the server processes all the requests, then calls `check()`. **/
             void sync( bool discard = false );
 
+            /** Throws `error_t` if the server reported an error since the last check. **/
+            void check();
+
         private:
 
-            Display * _rep = nullptr;
+            friend void init();
+
+            static int _error_handler( Display * display, XErrorEvent * event );
+
+        private:
+
+            Display *   _rep = nullptr;
+            std::mutex  _mutex;         ///< Guards `_error`.
+            string_t    _error;         ///< The first error reported by the server, if any.
 
     }; // class display_t
 
     using display_p = ptr_t< display_t >;
+    using display_s = std::shared_ptr< display_t >;
+
+    /**
+        Returns the display connection shared by the Xkb layouter and the XTest emitter, which
+        saves a socket. The layouter and the emitter run in different executor threads, but Xlib
+        serializes access to the connection, see `init()`. The connection is closed when the last
+        user releases it.
+    **/
+    display_s shared_display();
 
     // ---------------------------------------------------------------------------------------------
     // atom_t
@@ -279,10 +314,16 @@ namespace x {
             public:
 
                 using on_intercept_t = std::function< void( XRecordInterceptData const * ) >;
+                using on_processed_t = std::function< void() >;
 
+                /**
+                    `on_intercept` is called on every recorded protocol element, `on_processed` is
+                    called when all the data received so far are processed.
+                **/
                 explicit context_t(
                     on_intercept_t    on_intercept,
-                    int               datum_flags = 0,
+                    on_processed_t    on_processed = nullptr,
+                    int               datum_flags  = 0,
                     XRecordClientSpec client      = XRecordAllClients
                 );
                 virtual ~context_t();
@@ -296,16 +337,7 @@ namespace x {
 
                 static void interceptor( XPointer closure, XRecordInterceptData * data );
 
-                class thread_t: public posix::thread_t {
-                    using parent_t = posix::thread_t;
-                    friend class context_t;
-                    public:
-                        explicit thread_t( display_t & display );
-                    protected:
-                        virtual void body() override;
-                    private:
-                        display_t & _display;
-                }; // thread_t
+                void _process();
 
             private:
 
@@ -316,11 +348,12 @@ namespace x {
                 }; // enum state_t
 
                 on_intercept_t  _on_intercept;
+                on_processed_t  _on_processed;
                 state_t         _state  { inited };
                 XRecordContext  _handle { None };
                 display_t       _ctrl;
                 display_t       _data;
-                thread_t        _thread;
+                string_t        _what;      ///< Error occurred in the interceptor.
 
         }; // class context_t
 
@@ -388,17 +421,75 @@ namespace x {
             display_t &       display();
             autorepeat_rate_t autorepeat_rate();
             void              lock_group( uint_t group );
+            uint_t            locked_group();
+            void              select_group_events();
+            bool              group_event( XEvent const & event, uint_t & group ) const;
             void              bell();
             desc_p            desc( uint_t which = XkbAllComponentsMask );
 
         private:
 
             display_t &     _display;
+            int             _event_base { 0 };     ///< First Xkb event code.
 
     }; // class kb_t
 
     using kb_p = ptr_t< kb_t >;
 
+    // ---------------------------------------------------------------------------------------------
+    // keymap_t
+    // ---------------------------------------------------------------------------------------------
+
+    /**
+        Names of X keys and mouse buttons, indexed by Linux key codes, as X listeners report them.
+        Keys are named by Xkb, buttons are named `BTN1`, `BTN2`, etc. The keyboard description is
+        requested from the server when names or the key range are needed for the first time.
+    **/
+    class keymap_t: public object_t {
+
+        public:
+
+            using key2name_t = std::map< linux::key_t, string_t >;
+            using name2key_t = std::map< string_t, linux::key_t >;
+
+        public:
+
+            explicit keymap_t( display_t & display );
+
+            /** Returns range of Linux key codes of X keys and buttons. **/
+            linux::key_t::range_t key_range();
+
+            /** Returns keys which have names. **/
+            linux::keys_t keys();
+
+            /** Returns key by the name (case-insensitive), or `key_t::none` if not found. **/
+            linux::key_t key( string_t const & name );
+
+            /**
+                Returns name of the key, or empty string if the key has no name. Throws if the key
+                is out of `key_range()`.
+            **/
+            string_t key_name( linux::key_t key );
+
+        private:
+
+            key2name_t const & _key2name();
+            name2key_t const & _name2key();
+
+            kb_t &          _kb();
+            kb_t::desc_t &  _kb_desc();
+
+        private:
+
+            display_t &                     _display;
+            kb_p                            _kb_rep;
+            kb_t::desc_p                    _kb_desc_rep;
+            linux::key_t::range_p           _key_range;
+            ptr_t< key2name_t >             _key2name_rep;
+            ptr_t< name2key_t >             _name2key_rep;
+
+    }; // class keymap_t
+
 }; // namespace x
 }; // namespace tapper
 
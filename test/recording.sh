@@ -0,0 +1,85 @@
+#   ---------------------------------------------------------------------- copyright and license ---
+#
+#   File: test/recording.sh
+#
+#   Copyright 🄯 2014, 2016—2017, 2019—2023 Van de Bugger.
+#
+#   This file is part of Tapper.
+#
+#   Tapper is free software: you can redistribute it and/or modify it under the terms of the GNU
+#   General Public License as published by the Free Software Foundation, either version 3 of the
+#   License, or (at your option) any later version.
+#
+#   Tapper is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+#   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+#   General Public License for more details.
+#
+#   You should have received a copy of the GNU General Public License along with Tapper.  If not,
+#   see <https://www.gnu.org/licenses/>.
+#
+#   SPDX-License-Identifier: GPL-3.0-or-later
+#
+#   ---------------------------------------------------------------------- copyright and license ---
+
+#   Functions writing input event logs, sourced by tests after `$PROLOGUE`. Input event log format
+#   is described in `src/recording.hpp`. Integers are in the host byte order, the functions write
+#   logs for little-endian hosts, so a test is skipped on a big-endian one.
+
+[[ $( printf '\1\0' | od -An -tu2 | tr -d ' ' ) == 1 ]] || \
+    skip "The test can be run only on a little-endian host."
+
+#   ------------------------------------------------------------------------------------------------
+#   Name:
+#       header — print binary header of version 2 log
+#   Usage:
+#       header
+#
+header() {
+    printf 'TAPPERLG\x02\x00\x00\x00\x10\x00\x00\x00'
+}
+
+#   ------------------------------------------------------------------------------------------------
+#   Name:
+#       record — print binary record of version 2 log
+#   Usage:
+#       record time key state [device]
+#   Description:
+#       Prints time (64-bit), key (16-bit), state (8-bit), reserved (8-bit), device (16-bit),
+#       reserved (16-bit). Time is given in milliseconds, but written in microseconds. Device is
+#       optional, 0 by default. Key 0 means the device is removed.
+#
+record() {
+    local time=$(( $1 * 1000 )) key=$2 state=$3 device=${4:-0} shift
+    for (( shift = 0; shift < 64; shift += 8 )); do
+        printf "\\x$( printf %02x $(( ( time >> shift ) & 0xFF )) )"
+    done
+    printf "\\x$( printf %02x $((   key          & 0xFF )) )"
+    printf "\\x$( printf %02x $(( ( key  >> 8  ) & 0xFF )) )"
+    printf "\\x$( printf %02x $state )"
+    printf '\x00'
+    printf "\\x$( printf %02x $((   device         & 0xFF )) )"
+    printf "\\x$( printf %02x $(( ( device >> 8  ) & 0xFF )) )"
+    printf '\x00\x00'
+}
+
+#   ------------------------------------------------------------------------------------------------
+#   Name:
+#       record_v1 — print binary record of version 1 log
+#   Usage:
+#       record_v1 time key state
+#   Description:
+#       Prints time (32-bit, milliseconds), key (16-bit), state (8-bit), reserved (8-bit).
+#
+record_v1() {
+    local time=$1 key=$2 state=$3
+    printf "\\x$( printf %02x $((   time         & 0xFF )) )"
+    printf "\\x$( printf %02x $(( ( time >> 8  ) & 0xFF )) )"
+    printf "\\x$( printf %02x $(( ( time >> 16 ) & 0xFF )) )"
+    printf "\\x$( printf %02x $(( ( time >> 24 ) & 0xFF )) )"
+    printf "\\x$( printf %02x $((   key          & 0xFF )) )"
+    printf "\\x$( printf %02x $(( ( key  >> 8  ) & 0xFF )) )"
+    printf "\\x$( printf %02x $state )"
+    printf '\x00'
+}
+
+# end of file #